@@ -0,0 +1,298 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fxaa.h"
+#include "math.h"
+#include "ppm.h"
+#include "profiler.h"
+#include "quantize.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+// 여러 AA 설정을 한 번에 렌더해 설정마다 파일을 쓰는 비교 모드.
+// 샘플 집합이 포개지는 설정은 가장 큰 집합을 한 번만 평가하고 앞부분 합으로 나머지를 만든다.
+//   MSAA 1~8: MSAA_SAMPLES 의 앞 N 개를 쓰므로 MSAA 8 한 번으로 모두 나온다.
+//   NONE/FXAA: FXAA 는 NONE 결과에 후처리만 더한다.
+// SSAA 격자는 칸 중심에 놓여 레벨끼리 포개지지 않고, 패턴도 레벨에 맞춰 파라미터(Voronoi 는 사이트까지)를 바꾸므로
+// SSAA, MSAA 9 이상, ANALYTIC, ADAPTIVE 는 각자 평가한다. 대신 모든 설정을 같은 타일 순회에서 함께 렌더한다.
+// 모든 출력은 같은 설정으로 따로 렌더한 결과와 같다.
+
+struct AAVariant
+{
+    EAAType type = EAAType::MSAA;
+    int level = 1;
+};
+
+// 파일 이름에 붙는 "_MSAA_4" 꼴 이름. 단일 렌더의 기본 파일 이름과 같다.
+static std::string get_aa_variant_suffix(const AAVariant& variant)
+{
+    const char* name = "NONE";
+    switch (variant.type) {
+        case EAAType::SSAA: name = "SSAA"; break;
+        case EAAType::MSAA: name = "MSAA"; break;
+        case EAAType::FXAA: name = "FXAA"; break;
+        case EAAType::ANALYTIC: name = "ANALYTIC"; break;
+        case EAAType::ADAPTIVE: name = "ADAPTIVE"; break;
+        default: break;
+    }
+    return std::string("_") + name + "_" + std::to_string(variant.level);
+}
+
+// "none,fxaa,msaa2,msaa4,ssaa3,analytic,adaptive4" 를 읽는다. 레벨을 생략하면 msaa/ssaa/adaptive 는 2, 나머지는 1.
+static bool parse_aa_variants(const std::string& text, std::vector<AAVariant>& variants, std::string& error)
+{
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        const size_t digits = item.find_first_of("0123456789");
+        const std::string name = item.substr(0, digits);
+        AAVariant variant;
+        int defaultLevel = 1;
+        if (name == "none") {
+            variant.type = EAAType::NONE;
+        } else if (name == "fxaa") {
+            variant.type = EAAType::FXAA;
+        } else if (name == "analytic") {
+            variant.type = EAAType::ANALYTIC;
+        } else if (name == "msaa") {
+            variant.type = EAAType::MSAA;
+            defaultLevel = 2;
+        } else if (name == "ssaa") {
+            variant.type = EAAType::SSAA;
+            defaultLevel = 2;
+        } else if (name == "adaptive") {
+            variant.type = EAAType::ADAPTIVE;
+            defaultLevel = 2;
+        } else {
+            error = "unknown AA setting: " + item;
+            return false;
+        }
+        variant.level = (digits == std::string::npos) ? defaultLevel : clamp(std::atoi(item.c_str() + digits), 1, MAX_AA_LEVEL);
+        if (variant.type == EAAType::NONE || variant.type == EAAType::FXAA || variant.type == EAAType::ANALYTIC) {
+            variant.level = 1;
+        }
+        variants.push_back(variant);
+    }
+    if (variants.empty()) {
+        error = "no AA settings";
+        return false;
+    }
+    return true;
+}
+
+// MSAA 1~8 을 한 번에: 픽셀마다 MSAA_SAMPLES 앞 maxLevel 개를 평가하고,
+// 단일 MSAA 렌더와 같은 순서로 누적하다가 레벨 k 에 이르면 그 평균을 targets[k] 에 쓴다.
+template<typename Pattern>
+static void render_msaa_prefix_tile(const RenderTile& tile, const vec2i& outputSize, const Pattern& pattern, int maxLevel, const std::vector<const RenderTarget*>& targets)
+{
+    const int width = tile.max.x - tile.min.x;
+    const int rowSamples = width * maxLevel;
+    std::vector<float> u(rowSamples);
+    std::vector<float> v(rowSamples);
+    std::vector<vec3f> colors(rowSamples);
+    std::vector<float> values(rowSamples);
+    std::vector<int> indices(rowSamples);
+    std::vector<vec3f> accumulated(width);
+    std::vector<vec3f> resolved(width);
+
+    for (int y = tile.min.y; y < tile.max.y; y++) {
+        int count = 0;
+        for (int x = tile.min.x; x < tile.max.x; x++) {
+            for (int i = 0; i < maxLevel; i++) {
+                u[count] = (static_cast<float>(x) + 0.5f + MSAA_SAMPLES[i].x) / outputSize.x;
+                v[count] = (static_cast<float>(y) + 0.5f + MSAA_SAMPLES[i].y) / outputSize.y;
+                count++;
+            }
+        }
+        SampleBatch batch;
+        batch.u = u.data();
+        batch.v = v.data();
+        batch.count = count;
+        batch.colors = colors.data();
+        batch.values = values.data();
+        batch.indices = indices.data();
+        pattern.EvaluateBatch(batch);
+
+        std::fill(accumulated.begin(), accumulated.end(), vec3f::Zero);
+        for (int level = 1; level <= maxLevel; level++) {
+            for (int i = 0; i < width; i++) {
+                accumulated[i] += colors[static_cast<size_t>(i) * maxLevel + level - 1];
+            }
+            if (targets[level] == nullptr) {
+                continue;
+            }
+            for (int i = 0; i < width; i++) {
+                resolved[i] = accumulated[i] / static_cast<float>(level);
+            }
+            targets[level]->StoreRow(tile.min.x, y, resolved.data(), width);
+        }
+    }
+}
+
+template<typename Pattern>
+using RenderCompareTileFunc = void (*)(const RenderTile&, const vec2i&, const Pattern&, const RenderTarget&, RenderSampleStats&);
+
+template<EAAType AA, int Level, typename Pattern>
+static void render_compare_tile(const RenderTile& tile, const vec2i& outputSize, const Pattern& pattern, const RenderTarget& target, RenderSampleStats& stats)
+{
+    const RenderTile image = {{0, 0}, outputSize};
+    if constexpr (AA == EAAType::ADAPTIVE) {
+        render_pattern_adaptive_tile<Level>(tile, outputSize, image, pattern, target, stats);
+    } else {
+        render_pattern_tile<AA, Level>(tile, outputSize, image, pattern, target);
+        stats.sampleCount += static_cast<int64_t>(tile.max.x - tile.min.x) * (tile.max.y - tile.min.y) * SamplerTraits<AA, Level>::SampleCount;
+    }
+}
+
+template<EAAType AA, typename Pattern, size_t... LevelIndex>
+constexpr std::array<RenderCompareTileFunc<Pattern>, sizeof...(LevelIndex)> make_render_compare_table(std::index_sequence<LevelIndex...>)
+{
+    return {&render_compare_tile<AA, static_cast<int>(LevelIndex) + 1, Pattern>...};
+}
+
+template<typename Pattern>
+static RenderCompareTileFunc<Pattern> get_render_compare_tile_func(const AAVariant& variant)
+{
+    static constexpr auto SSAATable = make_render_compare_table<EAAType::SSAA, Pattern>(std::make_index_sequence<MAX_AA_LEVEL>());
+    static constexpr auto MSAATable = make_render_compare_table<EAAType::MSAA, Pattern>(std::make_index_sequence<MAX_AA_LEVEL>());
+    static constexpr auto AdaptiveTable = make_render_compare_table<EAAType::ADAPTIVE, Pattern>(std::make_index_sequence<MAX_AA_LEVEL>());
+    switch (variant.type) {
+        case EAAType::SSAA: return SSAATable[variant.level - 1];
+        case EAAType::MSAA: return MSAATable[variant.level - 1];
+        case EAAType::ADAPTIVE: return AdaptiveTable[variant.level - 1];
+        default: return &render_compare_tile<EAAType::NONE, 1, Pattern>;
+    }
+}
+
+// 설정마다 baseFilename 에 get_aa_variant_suffix 를 붙인 파일을 쓴다.
+// makePattern(AAType, AALevel) 은 그 설정의 단일 렌더에 쓰는 것과 같은 패턴을 std::unique_ptr 로 돌려준다.
+// sharedStats 에는 실제로 평가한 샘플 수를, separateStats 에는 따로 렌더했을 때의 샘플 수를 더한다.
+template<typename Pattern, typename MakePattern>
+static bool render_aa_comparison(const std::string& baseFilename, const vec2i& outputSize, const std::vector<AAVariant>& variants, const MakePattern& makePattern,
+    const PixelEncoder& encoder, RenderSampleStats* sharedStats = nullptr, RenderSampleStats* separateStats = nullptr)
+{
+    const size_t imageBytes = static_cast<size_t>(outputSize.x) * outputSize.y * encoder.GetBytesPerPixel();
+    const int64_t pixelCount = static_cast<int64_t>(outputSize.x) * outputSize.y;
+    std::vector<std::vector<unsigned char>> outputs(variants.size());
+    std::vector<RenderTarget> targets(variants.size());
+    for (size_t i = 0; i < variants.size(); ++i) {
+        outputs[i].resize(imageBytes);
+        profile_track_buffer(static_cast<int64_t>(imageBytes));
+        targets[i] = make_encoded_target(outputs[i].data(), outputSize.x, encoder);
+    }
+
+    // 포개지는 샘플 집합끼리 묶는다. 같은 레벨을 두 번 요청하면 같은 결과를 한 번 더 쓴다.
+    int msaaMaxLevel = 0;
+    std::vector<const RenderTarget*> msaaTargets(9, nullptr);
+    std::vector<vec3f> noneImage;
+    bool needNone = false;
+    bool needFXAA = false;
+    struct SeparateVariant
+    {
+        RenderCompareTileFunc<Pattern> renderTile;
+        std::unique_ptr<Pattern> pattern;
+        size_t output;
+    };
+    std::vector<SeparateVariant> separates;
+    std::vector<size_t> duplicates;  // msaaTargets 에 이미 같은 레벨이 있는 출력
+    for (size_t i = 0; i < variants.size(); ++i) {
+        const AAVariant& variant = variants[i];
+        if (variant.type == EAAType::MSAA && variant.level <= 8) {
+            if (msaaTargets[variant.level] != nullptr) {
+                duplicates.push_back(i);
+                continue;
+            }
+            msaaMaxLevel = std::max(msaaMaxLevel, variant.level);
+            msaaTargets[variant.level] = &targets[i];
+        } else if (variant.type == EAAType::NONE || variant.type == EAAType::FXAA) {
+            needNone = true;
+            needFXAA = needFXAA || variant.type == EAAType::FXAA;
+        } else {
+            separates.push_back({get_render_compare_tile_func<Pattern>(variant), makePattern(variant.type, variant.level), i});
+        }
+    }
+
+    std::unique_ptr<Pattern> msaaPattern = (msaaMaxLevel > 0) ? makePattern(EAAType::MSAA, msaaMaxLevel) : nullptr;
+    std::unique_ptr<Pattern> nonePattern = needNone ? makePattern(EAAType::NONE, 1) : nullptr;
+    if (needNone) {
+        noneImage.resize(static_cast<size_t>(pixelCount));
+    }
+    const RenderTarget noneTarget = make_float_target(noneImage.data(), outputSize.x);
+
+    std::vector<std::atomic<int64_t>> separateSamples(separates.size());
+    {
+        ProfileStage profileStage("render");
+        parallel_for_tiles(RenderTile{{0, 0}, outputSize}, [&](const RenderTile& tile) {
+            if (msaaPattern) {
+                render_msaa_prefix_tile(tile, outputSize, *msaaPattern, msaaMaxLevel, msaaTargets);
+            }
+            if (nonePattern) {
+                RenderSampleStats tileStats;
+                render_compare_tile<EAAType::NONE, 1>(tile, outputSize, *nonePattern, noneTarget, tileStats);
+            }
+            for (size_t s = 0; s < separates.size(); ++s) {
+                RenderSampleStats tileStats;
+                separates[s].renderTile(tile, outputSize, *separates[s].pattern, targets[separates[s].output], tileStats);
+                separateSamples[s].fetch_add(tileStats.sampleCount, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // NONE 과 FXAA 는 float 이미지에서 만든다.
+    for (size_t i = 0; i < variants.size(); ++i) {
+        if (variants[i].type == EAAType::NONE) {
+            encoder.EncodeRow(noneImage.data(), noneImage.size(), outputs[i].data());
+        }
+    }
+    if (needFXAA) {
+        const std::vector<vec3f> fxaaImage = apply_fxaa(outputSize, noneImage);
+        for (size_t i = 0; i < variants.size(); ++i) {
+            if (variants[i].type == EAAType::FXAA) {
+                encoder.EncodeRow(fxaaImage.data(), fxaaImage.size(), outputs[i].data());
+            }
+        }
+    }
+    for (const size_t i : duplicates) {
+        outputs[i] = outputs[msaaTargets[variants[i].level] - targets.data()];
+    }
+
+    // 샘플 수: 공유한 집합은 한 번, 따로 렌더했다면 설정마다.
+    int64_t sharedSampleCount = pixelCount * (msaaMaxLevel + (needNone ? 1 : 0));
+    int64_t separateSampleCount = 0;
+    for (size_t s = 0; s < separates.size(); ++s) {
+        sharedSampleCount += separateSamples[s].load();
+        separateSampleCount += separateSamples[s].load();
+    }
+    for (const AAVariant& variant : variants) {
+        if (variant.type == EAAType::MSAA && variant.level <= 8) {
+            separateSampleCount += pixelCount * variant.level;
+        } else if (variant.type == EAAType::NONE || variant.type == EAAType::FXAA) {
+            separateSampleCount += pixelCount;
+        }
+    }
+    profile_add_counter(EProfileCounter::SAMPLES, sharedSampleCount);
+    if (sharedStats) {
+        sharedStats->pixelCount += pixelCount * static_cast<int64_t>(variants.size());
+        sharedStats->sampleCount += sharedSampleCount;
+    }
+    if (separateStats) {
+        separateStats->pixelCount += pixelCount * static_cast<int64_t>(variants.size());
+        separateStats->sampleCount += separateSampleCount;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < variants.size(); ++i) {
+        const std::string filename = insert_filename_suffix(baseFilename, get_aa_variant_suffix(variants[i]));
+        ok = ExportPPM(filename.c_str(), EPPMFormat::P3_BINARY, outputSize.x, outputSize.y, outputs[i].data(), encoder.GetMaxValue()) && ok;
+        profile_release_buffer(static_cast<int64_t>(imageBytes));
+    }
+    return ok;
+}
@@ -0,0 +1,258 @@
+#include "basicaa.h"
+
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <variant>
+
+#include "fxaa.h"
+#include "math.h"
+#include "pattern.h"
+#include "pattern_graph.h"
+#include "quantize.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+// basicaa.h 의 구현. 내부 헤더의 렌더 드라이버를 그대로 쓰므로 결과는 basicAA 실행 파일과 같다.
+
+static_assert(BASICAA_AA_ADAPTIVE == static_cast<int>(EAAType::ADAPTIVE) && BASICAA_AA_ANALYTIC == static_cast<int>(EAAType::ANALYTIC), "BASICAA_AA_* follows EAAType");
+static_assert(BASICAA_FORMAT_RGB16 == static_cast<int>(EPixelFormat::RGB16) && BASICAA_FORMAT_RGB_F32 == static_cast<int>(EPixelFormat::RGB_F32), "BASICAA_FORMAT_* follows EPixelFormat");
+static_assert(BASICAA_ENCODING_GAMMA == static_cast<int>(EColorEncoding::GAMMA), "BASICAA_ENCODING_* follows EColorEncoding");
+static_assert(BASICAA_SIMD_AVX512 == static_cast<int>(ESimdLevel::AVX512), "BASICAA_SIMD_* follows ESimdLevel");
+
+using LibraryPatternVariant = std::variant<std::unique_ptr<UVPattern>, std::unique_ptr<CheckerboardPattern>, std::unique_ptr<CirclePattern>,
+                                           std::unique_ptr<VoronoiPattern>, std::unique_ptr<CompositePattern>>;
+
+// 렌더러가 다시 쓰는 패턴. key 는 패턴 문자열과 이미지 크기, AA 설정이다.
+struct LibraryPattern
+{
+    std::string key;
+    LibraryPatternVariant pattern;
+};
+
+struct LibraryEncoder
+{
+    int format = BASICAA_FORMAT_RGB8;
+    int encoding = BASICAA_ENCODING_LINEAR;
+    float gamma = 0.0f;
+    PixelEncoder encoder;
+};
+
+// 패턴과 인코더는 만든 뒤로 바뀌지 않으므로 렌더마다 shared_ptr 로 나눠 쥐고 잠금 없이 쓴다.
+struct BasicAARenderer
+{
+    std::mutex mutex;
+    std::shared_ptr<const LibraryPattern> pattern;
+    std::shared_ptr<const LibraryEncoder> encoder;
+};
+
+// 변환, 색, 블렌드, 마스크가 없는 레이어 하나는 합성하지 않고 그 패턴을 바로 쓴다(결과는 같고 대칭 렌더를 쓸 수 있다).
+static bool is_plain_pattern_layer(const PatternLayerDesc& layer)
+{
+    return layer.source != ELayerSource::SOLID && !layer.HasTransform() && !layer.hidden && layer.mask < 0 && layer.blend == EBlendMode::NORMAL && layer.opacity == 1.0f
+        && layer.color.x == 1.0f && layer.color.y == 1.0f && layer.color.z == 1.0f;
+}
+
+static std::shared_ptr<const LibraryPattern> make_library_pattern(const std::string& key, const PatternGraphDesc& graph, const vec2i& outputSize, const EAAType AAType, const int AALevel)
+{
+    auto library = std::make_shared<LibraryPattern>();
+    library->key = key;
+
+    if (graph.layers.size() > 1 || !is_plain_pattern_layer(graph.layers[0])) {
+        library->pattern = std::make_unique<CompositePattern>(outputSize, AAType, AALevel, graph);
+        return library;
+    }
+    const PatternLayerDesc& layer = graph.layers[0];
+    switch (layer.source) {
+        case ELayerSource::CHECKERBOARD:
+            library->pattern = std::make_unique<CheckerboardPattern>(outputSize, AAType, AALevel, layer.checkerboardAngle, vec2f{0.5f, 0.5f}, layer.checkerboardTileSize);
+            break;
+        case ELayerSource::CIRCLE:
+            library->pattern = std::make_unique<CirclePattern>(outputSize, AAType, AALevel, layer.circleThickness, layer.circleGap);
+            break;
+        case ELayerSource::VORONOI:
+            library->pattern = std::make_unique<VoronoiPattern>(outputSize, AAType, AALevel, layer.voronoiSiteCount, layer.voronoiLookup);
+            break;
+        default:
+            library->pattern = std::make_unique<UVPattern>(outputSize);
+            break;
+    }
+    return library;
+}
+
+// 인코더 테이블(16비트 sRGB 면 65536칸)은 형식과 인코딩이 바뀔 때만 다시 만든다.
+static std::shared_ptr<const LibraryEncoder> get_library_encoder(BasicAARenderer& renderer, int format, int encoding, float gamma)
+{
+    {
+        std::lock_guard<std::mutex> lock(renderer.mutex);
+        const std::shared_ptr<const LibraryEncoder>& cached = renderer.encoder;
+        if (cached && cached->format == format && cached->encoding == encoding && (encoding != BASICAA_ENCODING_GAMMA || cached->gamma == gamma)) {
+            return cached;
+        }
+    }
+    auto library = std::make_shared<LibraryEncoder>();
+    library->format = format;
+    library->encoding = encoding;
+    library->gamma = gamma;
+    library->encoder = PixelEncoder(format == BASICAA_FORMAT_RGB16 ? EPixelFormat::RGB16 : EPixelFormat::RGB8, static_cast<EColorEncoding>(encoding), gamma);
+
+    std::lock_guard<std::mutex> lock(renderer.mutex);
+    renderer.encoder = library;
+    return library;
+}
+
+static int render_library_image(BasicAARenderer& renderer, const BasicAARenderDesc& desc, const BasicAAImage& image, BasicAARenderStats* stats)
+{
+    if (desc.width <= 0 || desc.height <= 0 || desc.aaType < BASICAA_AA_NONE || desc.aaType > BASICAA_AA_ADAPTIVE) {
+        return BASICAA_ERROR_INVALID_ARGUMENT;
+    }
+    if (desc.encoding < BASICAA_ENCODING_LINEAR || desc.encoding > BASICAA_ENCODING_GAMMA || (desc.encoding == BASICAA_ENCODING_GAMMA && !(desc.gamma > 0.0f))) {
+        return BASICAA_ERROR_INVALID_ARGUMENT;
+    }
+    const vec2i outputSize = {desc.width, desc.height};
+    const EAAType AAType = static_cast<EAAType>(desc.aaType);
+    const int AALevel = clamp(desc.aaLevel, 1, MAX_AA_LEVEL);
+
+    // 실행 파일의 --roi 와 같이 이미지 안으로 자른다.
+    RenderTile roi = {{0, 0}, outputSize};
+    if (desc.roiWidth != 0 || desc.roiHeight != 0) {
+        roi.min = {clamp(desc.roiX, 0, outputSize.x), clamp(desc.roiY, 0, outputSize.y)};
+        roi.max = {clamp(desc.roiX + desc.roiWidth, roi.min.x, outputSize.x), clamp(desc.roiY + desc.roiHeight, roi.min.y, outputSize.y)};
+        if (roi.max.x == roi.min.x || roi.max.y == roi.min.y) {
+            return BASICAA_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    if (!image.data || image.format < BASICAA_FORMAT_RGB_F32 || image.format > BASICAA_FORMAT_RGB16) {
+        return BASICAA_ERROR_INVALID_IMAGE;
+    }
+    const EPixelFormat format = static_cast<EPixelFormat>(image.format);
+    if (image.rowStride < static_cast<size_t>(roi.max.x - roi.min.x) * get_bytes_per_pixel(format)) {
+        return BASICAA_ERROR_INVALID_IMAGE;
+    }
+
+    const std::string patternText = desc.pattern ? desc.pattern : "voronoi";
+    const std::string key = patternText + "|" + std::to_string(outputSize.x) + "x" + std::to_string(outputSize.y) + "|" + std::to_string(desc.aaType) + "|" + std::to_string(AALevel);
+    std::shared_ptr<const LibraryPattern> pattern;
+    {
+        std::lock_guard<std::mutex> lock(renderer.mutex);
+        if (renderer.pattern && renderer.pattern->key == key) {
+            pattern = renderer.pattern;
+        }
+    }
+    if (!pattern) {
+        PatternGraphDesc graph;
+        std::string error;
+        if (!parse_pattern_graph(patternText, graph, error)) {
+            return BASICAA_ERROR_INVALID_PATTERN;
+        }
+        pattern = make_library_pattern(key, graph, outputSize, AAType, AALevel);
+        std::lock_guard<std::mutex> lock(renderer.mutex);
+        renderer.pattern = pattern;
+    }
+
+    RenderTarget target;
+    target.data = image.data;
+    target.rowStride = image.rowStride;
+    target.format = format;
+    std::shared_ptr<const LibraryEncoder> encoder;
+    if (format != EPixelFormat::RGB_F32) {
+        encoder = get_library_encoder(renderer, image.format, desc.encoding, desc.gamma);
+        target.encoder = &encoder->encoder;
+    }
+
+    RenderSampleStats sampleStats;
+    std::visit([&](const auto& instance) {
+        if (AAType == EAAType::FXAA) {
+            render_pattern_fxaa_region(outputSize, *instance, roi, target, &sampleStats);
+        } else {
+            render_pattern_region(outputSize, AAType, AALevel, *instance, roi, target, &sampleStats);
+        }
+    }, pattern->pattern);
+
+    if (stats) {
+        stats->pixelCount = sampleStats.pixelCount;
+        stats->sampleCount = sampleStats.sampleCount;
+        stats->refinedPixelCount = sampleStats.refinedPixelCount;
+    }
+    return BASICAA_OK;
+}
+
+extern "C" {
+
+BASICAA_API int basicaa_get_api_version(void)
+{
+    return BASICAA_API_VERSION;
+}
+
+BASICAA_API void basicaa_configure(const BasicAAConfig* config)
+{
+    if (!config) {
+        return;
+    }
+    SetThreadCount(config->threadCount);
+    SetSimdLevel(static_cast<ESimdLevel>(clamp(config->simdLevel, static_cast<int>(BASICAA_SIMD_AUTO), static_cast<int>(BASICAA_SIMD_AVX512))));
+    SetPatternSymmetryEnabled(config->useSymmetry != 0);
+}
+
+BASICAA_API BasicAARenderer* basicaa_create_renderer(void)
+{
+    // 스레드 풀은 처음 쓸 때 만들어지므로, 렌더러가 동시에 렌더를 시작하기 전에 여기서 한 번 만들어 둔다.
+    static std::once_flag poolOnce;
+    std::call_once(poolOnce, []() { GetThreadPool(); });
+    return new (std::nothrow) BasicAARenderer;
+}
+
+BASICAA_API void basicaa_destroy_renderer(BasicAARenderer* renderer)
+{
+    delete renderer;
+}
+
+BASICAA_API void basicaa_default_render_desc(BasicAARenderDesc* desc)
+{
+    if (!desc) {
+        return;
+    }
+    desc->width = 1920;
+    desc->height = 1080;
+    desc->aaType = BASICAA_AA_MSAA;
+    desc->aaLevel = 2;
+    desc->pattern = "voronoi";
+    desc->roiX = 0;
+    desc->roiY = 0;
+    desc->roiWidth = 0;
+    desc->roiHeight = 0;
+    desc->encoding = BASICAA_ENCODING_LINEAR;
+    desc->gamma = 2.2f;
+}
+
+BASICAA_API int basicaa_render(BasicAARenderer* renderer, const BasicAARenderDesc* desc, const BasicAAImage* image, BasicAARenderStats* stats)
+{
+    if (!renderer || !desc) {
+        return BASICAA_ERROR_INVALID_ARGUMENT;
+    }
+    if (!image) {
+        return BASICAA_ERROR_INVALID_IMAGE;
+    }
+    // 워커 스레드에서 난 할당 실패도 스레드 풀이 모든 작업을 거둔 뒤 이 스레드로 다시 던진다.
+    try {
+        return render_library_image(*renderer, *desc, *image, stats);
+    } catch (const std::bad_alloc&) {
+        return BASICAA_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+BASICAA_API const char* basicaa_status_string(int status)
+{
+    switch (status) {
+        case BASICAA_OK: return "ok";
+        case BASICAA_ERROR_INVALID_ARGUMENT: return "invalid size, AA setting or region";
+        case BASICAA_ERROR_INVALID_PATTERN: return "invalid pattern description";
+        case BASICAA_ERROR_INVALID_IMAGE: return "invalid image buffer, format or row stride";
+        case BASICAA_ERROR_OUT_OF_MEMORY: return "out of memory";
+        default: return "unknown status";
+    }
+}
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+// basicAA 라이브러리의 공개 API. 다른 프로그램에 넣어 쓸 때는 이 헤더만 포함하고 basicAA 라이브러리를 링크한다.
+// C ABI 라서 컴파일러나 표준 라이브러리가 달라도 쓸 수 있고, 내부 헤더가 바뀌어도 구조체와 함수는 그대로다.
+// 렌더는 호출한 쪽이 준 버퍼(행 간격, 픽셀 형식 지정)에 바로 쓰고 이미지 버퍼를 따로 만들지 않는다.
+//
+//   BasicAARenderer* renderer = basicaa_create_renderer();
+//   BasicAARenderDesc desc;
+//   basicaa_default_render_desc(&desc);
+//   desc.pattern = "checkerboard angle=30";
+//   BasicAAImage image = {pixels, 1920 * 3, BASICAA_FORMAT_RGB8};
+//   int status = basicaa_render(renderer, &desc, &image, NULL);
+//   basicaa_destroy_renderer(renderer);
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BASICAA_API_VERSION 1
+
+#if defined(BASICAA_SHARED)
+#if defined(_WIN32)
+#if defined(BASICAA_BUILDING_LIBRARY)
+#define BASICAA_API __declspec(dllexport)
+#else
+#define BASICAA_API __declspec(dllimport)
+#endif
+#else
+#define BASICAA_API __attribute__((visibility("default")))
+#endif
+#else
+#define BASICAA_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// AA 종류. 값은 pattern_plugin_api.h 의 aaType 과 같다.
+enum {
+    BASICAA_AA_NONE = 0,
+    BASICAA_AA_SSAA = 1,
+    BASICAA_AA_MSAA = 2,
+    BASICAA_AA_FXAA = 3,
+    BASICAA_AA_ANALYTIC = 4,
+    BASICAA_AA_ADAPTIVE = 5
+};
+
+enum {
+    BASICAA_FORMAT_RGB_F32 = 0,     // 픽셀당 float 3개, 선형
+    BASICAA_FORMAT_RGB8 = 1,        // 채널당 1바이트
+    BASICAA_FORMAT_RGB16 = 2        // 채널당 2바이트, PPM 과 같은 빅엔디언
+};
+
+enum {
+    BASICAA_ENCODING_LINEAR = 0,
+    BASICAA_ENCODING_SRGB = 1,
+    BASICAA_ENCODING_GAMMA = 2
+};
+
+enum {
+    BASICAA_SIMD_AUTO = 0,
+    BASICAA_SIMD_SCALAR = 1,
+    BASICAA_SIMD_AVX2 = 2,
+    BASICAA_SIMD_AVX512 = 3
+};
+
+enum {
+    BASICAA_OK = 0,
+    BASICAA_ERROR_INVALID_ARGUMENT = 1,     // 크기, AA, ROI 가 잘못됐다
+    BASICAA_ERROR_INVALID_PATTERN = 2,      // pattern 문자열을 읽지 못했다
+    BASICAA_ERROR_INVALID_IMAGE = 3,        // 버퍼가 없거나 행 간격이 ROI 폭보다 작다
+    BASICAA_ERROR_OUT_OF_MEMORY = 4
+};
+
+// 프로세스 전체 설정. 렌더하기 전에 한 번 부른다(렌더 중에 부르면 안 된다).
+typedef struct BasicAAConfig
+{
+    int threadCount;    // 0 이하이면 하드웨어 스레드 수
+    int simdLevel;      // BASICAA_SIMD_*
+    int useSymmetry;    // 0 이면 대칭/주기 패턴도 모든 픽셀을 평가한다(결과는 같다)
+} BasicAAConfig;
+
+// 렌더할 이미지. 좌표는 전체 이미지(width x height) 기준이다.
+typedef struct BasicAARenderDesc
+{
+    int width;
+    int height;
+    int aaType;         // BASICAA_AA_*
+    int aaLevel;        // 1~16
+    // --layers 와 같은 형식. "voronoi sites=500", "checkerboard angle=30 tile=40" 처럼 레이어 하나면
+    // 합성 없이 그 패턴을 그대로 쓰고, "voronoi; circle hidden=1; solid color=0,0,0 mask=1" 처럼 여러 개면 합성한다.
+    const char* pattern;
+    // 렌더할 영역. roiWidth 나 roiHeight 가 0 이면 전체 이미지. 버퍼는 이 영역 크기다.
+    int roiX;
+    int roiY;
+    int roiWidth;
+    int roiHeight;
+    int encoding;       // BASICAA_ENCODING_*, RGB8/RGB16 에만 쓴다
+    float gamma;        // BASICAA_ENCODING_GAMMA 의 지수
+} BasicAARenderDesc;
+
+// 결과를 쓸 버퍼. data 는 ROI 왼쪽 위 픽셀, rowStride 는 바이트 단위 행 간격.
+typedef struct BasicAAImage
+{
+    void* data;
+    size_t rowStride;
+    int format;         // BASICAA_FORMAT_*
+} BasicAAImage;
+
+// 렌더 한 번에 평가한 샘플 수.
+typedef struct BasicAARenderStats
+{
+    int64_t pixelCount;
+    int64_t sampleCount;
+    int64_t refinedPixelCount;  // ADAPTIVE 에서 세분한 픽셀 수
+} BasicAARenderStats;
+
+typedef struct BasicAARenderer BasicAARenderer;
+
+BASICAA_API int basicaa_get_api_version(void);
+BASICAA_API void basicaa_configure(const BasicAAConfig* config);
+
+// 렌더러는 마지막으로 쓴 패턴(Voronoi 격자 포함)과 색 인코더를 들고 있다가, 설정이 같으면 다음 렌더에 다시 쓴다.
+// 렌더러 하나를 여러 스레드에서 동시에 써도 된다.
+BASICAA_API BasicAARenderer* basicaa_create_renderer(void);
+BASICAA_API void basicaa_destroy_renderer(BasicAARenderer* renderer);
+
+// 기본값: 1920x1080, MSAA 2, "voronoi", 전체 이미지, 선형 인코딩.
+BASICAA_API void basicaa_default_render_desc(BasicAARenderDesc* desc);
+
+// desc 의 이미지를 image 에 렌더한다. 결과는 basicAA 실행 파일이 같은 옵션으로 쓰는 픽셀과 같다.
+// stats 가 NULL 이 아니면 샘플 수를 쓴다. BASICAA_OK 또는 BASICAA_ERROR_* 를 반환한다.
+BASICAA_API int basicaa_render(BasicAARenderer* renderer, const BasicAARenderDesc* desc, const BasicAAImage* image, BasicAARenderStats* stats);
+
+BASICAA_API const char* basicaa_status_string(int status);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,666 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "incremental_render.h"
+#include "ppm.h"
+#include "pattern.h"
+
+// 패턴 생성, FXAA, 양자화, PPM 내보내기를 단계별로 따로 재는 벤치마크.
+// 해상도 × 패턴 × AA 종류/수준 × 보로노이 사이트 수 × 스레드 수 행렬을 돌며,
+// 워밍업 뒤 반복 측정한 시간의 중앙값으로 Mpix/s, Msamples/s 를 계산한다.
+// 결과는 JSON 으로 저장할 수 있고, 저장해 둔 JSON 을 기준선으로 주면 느려진 항목을 찾아 실패 코드로 끝난다.
+
+struct BenchAA
+{
+    EAAType type;
+    int level;
+};
+
+struct BenchOptions
+{
+    std::vector<vec2i> sizes = {{640, 360}, {1920, 1080}, {3840, 2160}};
+    std::vector<BenchAA> aaModes = {
+        {EAAType::NONE, 1}, {EAAType::SSAA, 2}, {EAAType::SSAA, 4}, {EAAType::MSAA, 4},
+        {EAAType::MSAA, 8}, {EAAType::FXAA, 1}, {EAAType::ANALYTIC, 1}, {EAAType::ADAPTIVE, 4}};
+    std::vector<std::string> patterns = {"uv", "checkerboard", "circle", "voronoi"};
+    std::vector<int> siteCounts = {100, 1000};
+    std::vector<int> threadCounts;
+    std::vector<std::string> stages = {"generate", "fxaa", "quantize", "export", "edit"};
+    std::string filter;
+    int warmup = 1;
+    int repeat = 5;
+    std::string jsonFile;
+    std::string baselineFile;
+    double tolerance = 0.10;
+};
+
+struct BenchResult
+{
+    std::string name;
+    std::string stage;
+    std::string pattern;
+    std::string aa;
+    int aaLevel = 0;
+    vec2i size = {0, 0};
+    int sites = 0;
+    int threads = 1;
+    int64_t pixels = 0;
+    int64_t samples = 0;
+    double meanMs = 0.0;
+    double medianMs = 0.0;
+    double minMs = 0.0;
+    double stddevMs = 0.0;
+
+    double MegaPixelsPerSecond() const { return medianMs > 0.0 ? pixels / (medianMs * 1e3) : 0.0; }
+    double MegaSamplesPerSecond() const { return medianMs > 0.0 ? samples / (medianMs * 1e3) : 0.0; }
+};
+
+// 보통 실행 파일(main.cpp)과 같은 패턴 설정.
+constexpr float BENCH_CHECKERBOARD_ANGLE = 40.0f;
+constexpr vec2f BENCH_CHECKERBOARD_PIVOT = {0.5f, 0.5f};
+constexpr float BENCH_CHECKERBOARD_TILE_SIZE = 50.f;
+constexpr float BENCH_CIRCLE_THICKNESS = 12.f;
+constexpr float BENCH_CIRCLE_GAP = 7.f;
+
+static const char* aa_type_name(EAAType type)
+{
+    switch (type) {
+        case EAAType::SSAA: return "ssaa";
+        case EAAType::MSAA: return "msaa";
+        case EAAType::FXAA: return "fxaa";
+        case EAAType::ANALYTIC: return "analytic";
+        case EAAType::ADAPTIVE: return "adaptive";
+        default: return "none";
+    }
+}
+
+static bool parse_aa_type(const std::string& text, EAAType& type)
+{
+    for (EAAType candidate : {EAAType::NONE, EAAType::SSAA, EAAType::MSAA, EAAType::FXAA, EAAType::ANALYTIC, EAAType::ADAPTIVE}) {
+        if (text == aa_type_name(candidate)) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::vector<std::string> split_list(const std::string& text)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// 해석적 AA 는 체커보드와 원에만 있으므로 다른 패턴에서는 건너뛴다.
+static bool is_supported_combination(const std::string& pattern, const BenchAA& aa)
+{
+    return aa.type != EAAType::ANALYTIC || pattern == "checkerboard" || pattern == "circle";
+}
+
+// 이름에 맞는 패턴 펑터를 만들어 func(pattern) 을 부른다.
+template<typename Func>
+static void with_pattern(const std::string& name, const vec2i& size, const BenchAA& aa, int sites, Func&& func)
+{
+    if (name == "uv") {
+        func(UVPattern(size));
+    } else if (name == "checkerboard") {
+        func(CheckerboardPattern(size, aa.type, aa.level, BENCH_CHECKERBOARD_ANGLE, BENCH_CHECKERBOARD_PIVOT, BENCH_CHECKERBOARD_TILE_SIZE));
+    } else if (name == "circle") {
+        func(CirclePattern(size, aa.type, aa.level, BENCH_CIRCLE_THICKNESS, BENCH_CIRCLE_GAP));
+    } else {
+        const VoronoiPattern pattern(size, aa.type, aa.level, sites, EVoronoiLookup::GRID);
+        func(pattern);
+    }
+}
+
+static std::vector<vec3f> generate_pattern_data(const std::string& name, const vec2i& size, const BenchAA& aa, int sites)
+{
+    if (name == "uv") {
+        return generate_uv_pattern_data(size, aa.type, aa.level);
+    } else if (name == "checkerboard") {
+        return generate_checkerboard_pattern_data(size, aa.type, aa.level, BENCH_CHECKERBOARD_ANGLE, BENCH_CHECKERBOARD_PIVOT, BENCH_CHECKERBOARD_TILE_SIZE);
+    } else if (name == "circle") {
+        return generate_circle_pattern_data(size, aa.type, aa.level, BENCH_CIRCLE_THICKNESS, BENCH_CIRCLE_GAP);
+    }
+    return generate_voronoi_pattern_data(size, aa.type, aa.level, sites);
+}
+
+static std::string make_result_name(const BenchResult& result)
+{
+    std::string name = result.stage + "/" + result.pattern;
+    if (!result.aa.empty()) {
+        name += "/" + result.aa + std::to_string(result.aaLevel);
+    }
+    if (result.sites > 0) {
+        name += "/s" + std::to_string(result.sites);
+    }
+    name += "/" + std::to_string(result.size.x) + "x" + std::to_string(result.size.y);
+    name += "/t" + std::to_string(result.threads);
+    return name;
+}
+
+// 워밍업 뒤 run 을 반복 실행하고 시간 통계를 result 에 채운다.
+static void measure(const BenchOptions& options, const std::function<void()>& run, BenchResult& result)
+{
+    for (int i = 0; i < options.warmup; ++i) {
+        run();
+    }
+
+    std::vector<double> times;
+    for (int i = 0; i < options.repeat; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    const size_t count = times.size();
+    double sum = 0.0;
+    for (double time : times) {
+        sum += time;
+    }
+    result.meanMs = sum / count;
+    result.medianMs = (count % 2 == 1) ? times[count / 2] : 0.5 * (times[count / 2 - 1] + times[count / 2]);
+    result.minMs = times.front();
+    double squares = 0.0;
+    for (double time : times) {
+        squares += (time - result.meanMs) * (time - result.meanMs);
+    }
+    result.stddevMs = (count > 1) ? std::sqrt(squares / (count - 1)) : 0.0;
+}
+
+class BenchRunner
+{
+public:
+    explicit BenchRunner(const BenchOptions& options)
+        : options(options)
+    {
+    }
+
+    void Run()
+    {
+        for (size_t t = 0; t < options.threadCounts.size(); ++t) {
+            const int threads = options.threadCounts[t];
+            SetThreadCount(threads);
+            for (const vec2i& size : options.sizes) {
+                if (HasStage("generate")) {
+                    RunGenerate(size, threads);
+                }
+                if (HasStage("fxaa")) {
+                    RunFXAA(size, threads);
+                }
+                // 양자화와 내보내기는 한 스레드에서 돌므로 스레드 수마다 반복하지 않는다.
+                if (t == 0 && HasStage("quantize")) {
+                    RunQuantize(size);
+                }
+                if (t == 0 && HasStage("export")) {
+                    RunExport(size);
+                }
+                if (HasStage("edit")) {
+                    RunEdit(size, threads);
+                }
+            }
+        }
+    }
+
+    const std::vector<BenchResult>& GetResults() const { return results; }
+
+private:
+    bool HasStage(const std::string& stage) const
+    {
+        return std::find(options.stages.begin(), options.stages.end(), stage) != options.stages.end();
+    }
+
+    bool Accept(BenchResult& result) const
+    {
+        result.name = make_result_name(result);
+        return options.filter.empty() || result.name.find(options.filter) != std::string::npos;
+    }
+
+    void Report(const BenchResult& result)
+    {
+        const double variation = result.meanMs > 0.0 ? 100.0 * result.stddevMs / result.meanMs : 0.0;
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-48s median %9.3f ms  min %9.3f ms  +-%5.1f%%  %9.1f Mpix/s", result.name.c_str(), result.medianMs, result.minMs, variation, result.MegaPixelsPerSecond());
+        std::cout << line;
+        if (result.samples > 0) {
+            std::snprintf(line, sizeof(line), "  %10.1f Msamples/s", result.MegaSamplesPerSecond());
+            std::cout << line;
+        }
+        std::cout << std::endl;
+        results.push_back(result);
+    }
+
+    void RunGenerate(const vec2i& size, int threads)
+    {
+        for (const std::string& pattern : options.patterns) {
+            for (const BenchAA& aa : options.aaModes) {
+                if (!is_supported_combination(pattern, aa)) {
+                    continue;
+                }
+                const std::vector<int> sites = (pattern == "voronoi") ? options.siteCounts : std::vector<int>{0};
+                for (int siteCount : sites) {
+                    BenchResult result;
+                    result.stage = "generate";
+                    result.pattern = pattern;
+                    result.aa = aa_type_name(aa.type);
+                    result.aaLevel = aa.level;
+                    result.size = size;
+                    result.sites = siteCount;
+                    result.threads = threads;
+                    if (!Accept(result)) {
+                        continue;
+                    }
+
+                    // 샘플 수는 측정 밖에서 한 번 렌더해 센다(ADAPTIVE 는 내용에 따라 달라진다).
+                    RenderSampleStats stats;
+                    with_pattern(pattern, size, aa, siteCount, [&](const auto& patternFunctor) {
+                        render_pattern(size, aa.type, aa.level, patternFunctor, &stats);
+                    });
+                    result.pixels = stats.pixelCount;
+                    result.samples = stats.sampleCount;
+
+                    measure(options, [&]() { generate_pattern_data(pattern, size, aa, siteCount); }, result);
+                    Report(result);
+                }
+            }
+        }
+    }
+
+    void RunFXAA(const vec2i& size, int threads)
+    {
+        for (const std::string& pattern : options.patterns) {
+            BenchResult result;
+            result.stage = "fxaa";
+            result.pattern = pattern;
+            result.size = size;
+            result.threads = threads;
+            result.pixels = static_cast<int64_t>(size.x) * size.y;
+            if (!Accept(result)) {
+                continue;
+            }
+
+            const std::vector<vec3f> pixels = generate_pattern_data(pattern, size, {EAAType::FXAA, 1}, options.siteCounts.front());
+            measure(options, [&]() { apply_fxaa(size, pixels); }, result);
+            Report(result);
+        }
+    }
+
+    void RunQuantize(const vec2i& size)
+    {
+        struct QuantizeCase
+        {
+            const char* name;
+            PixelEncoder encoder;
+        };
+        const QuantizeCase cases[] = {
+            {"linear8", PixelEncoder(EPixelFormat::RGB8, EColorEncoding::LINEAR)},
+            {"srgb8", PixelEncoder(EPixelFormat::RGB8, EColorEncoding::SRGB)},
+            {"linear16", PixelEncoder(EPixelFormat::RGB16, EColorEncoding::LINEAR)},
+            {"srgb16", PixelEncoder(EPixelFormat::RGB16, EColorEncoding::SRGB)},
+        };
+
+        const std::vector<vec3f> pixels = generate_uv_pattern_data(size, EAAType::NONE, 1);
+        for (const QuantizeCase& quantizeCase : cases) {
+            BenchResult result;
+            result.stage = "quantize";
+            result.pattern = quantizeCase.name;
+            result.size = size;
+            result.pixels = static_cast<int64_t>(pixels.size());
+            if (!Accept(result)) {
+                continue;
+            }
+
+            std::vector<unsigned char> data(pixels.size() * quantizeCase.encoder.GetBytesPerPixel());
+            measure(options, [&]() { quantize_pixels(pixels.data(), pixels.size(), quantizeCase.encoder, data.data()); }, result);
+            Report(result);
+        }
+    }
+
+    void RunExport(const vec2i& size)
+    {
+        struct ExportCase
+        {
+            const char* name;
+            EPPMFormat format;
+            EPixelFormat pixelFormat;
+        };
+        const ExportCase cases[] = {
+            {"p6_8bit", EPPMFormat::P3_BINARY, EPixelFormat::RGB8},
+            {"p6_16bit", EPPMFormat::P3_BINARY, EPixelFormat::RGB16},
+            {"p3_8bit", EPPMFormat::P3_ASCII, EPixelFormat::RGB8},
+            {"p3_16bit", EPPMFormat::P3_ASCII, EPixelFormat::RGB16},
+        };
+
+        const std::vector<vec3f> pixels = generate_uv_pattern_data(size, EAAType::NONE, 1);
+        const std::string fileName = (std::filesystem::temp_directory_path() / "basicAA_bench.ppm").string();
+        for (const ExportCase& exportCase : cases) {
+            BenchResult result;
+            result.stage = "export";
+            result.pattern = exportCase.name;
+            result.size = size;
+            result.pixels = static_cast<int64_t>(pixels.size());
+            if (!Accept(result)) {
+                continue;
+            }
+
+            const PixelEncoder encoder(exportCase.pixelFormat);
+            std::vector<unsigned char> data(pixels.size() * encoder.GetBytesPerPixel());
+            quantize_pixels(pixels.data(), pixels.size(), encoder, data.data());
+            bool written = true;
+            measure(options, [&]() {
+                written = ExportPPM(fileName.c_str(), exportCase.format, size.x, size.y, data.data(), encoder.GetMaxValue()) && written;
+            }, result);
+            if (!written) {
+                std::cerr << "Failed to write " << fileName << ": " << get_ppm_error() << std::endl;
+            }
+            Report(result);
+        }
+        std::error_code error;
+        std::filesystem::remove(fileName, error);
+    }
+
+    // 보로노이 사이트 하나를 옮길 때 IncrementalVoronoiRender 가 바뀐 셀만 다시 렌더하는 시간.
+    // 측정이 끝나면 같은 사이트로 처음부터 렌더한 결과와 비교해 다르면 알린다.
+    void RunEdit(const vec2i& size, int threads)
+    {
+        if (std::find(options.patterns.begin(), options.patterns.end(), "voronoi") == options.patterns.end()) {
+            return;
+        }
+        for (const BenchAA& aa : options.aaModes) {
+            if (!is_supported_combination("voronoi", aa)) {
+                continue;
+            }
+            for (int siteCount : options.siteCounts) {
+                BenchResult result;
+                result.stage = "edit";
+                result.pattern = "voronoi";
+                result.aa = aa_type_name(aa.type);
+                result.aaLevel = aa.level;
+                result.size = size;
+                result.sites = siteCount;
+                result.threads = threads;
+                result.pixels = static_cast<int64_t>(size.x) * size.y;
+                if (!Accept(result)) {
+                    continue;
+                }
+
+                const vec2i patternSize = get_voronoi_pattern_size(size, aa.type, aa.level);
+                IncrementalVoronoiRender editor(size, aa.type, aa.level, generate_voronoi_sites(patternSize, siteCount), EVoronoiLookup::GRID);
+                editor.Render();
+
+                int edit = 0;
+                measure(options, [&]() {
+                    // 사이트를 정해진 순서로 골라 가까운 곳으로 옮긴다.
+                    const int index = (edit * 7919) % siteCount;
+                    const vec2f& site = editor.GetSites()[index];
+                    const vec2f position = {clamp(site.x + static_cast<float>((edit * 37) % 61 - 30), 0.0f, static_cast<float>(patternSize.x - 1)),
+                                            clamp(site.y + static_cast<float>((edit * 53) % 61 - 30), 0.0f, static_cast<float>(patternSize.y - 1))};
+                    editor.MoveSite(index, position);
+                    edit++;
+                }, result);
+                Report(result);
+
+                RetainedRender reference(size, aa.type, aa.level);
+                const VoronoiPattern pattern(size, aa.type, aa.level, editor.GetSites(), EVoronoiLookup::GRID);
+                reference.Render(pattern);
+                if (std::memcmp(reference.GetPixels().data(), editor.GetRender().GetPixels().data(), reference.GetPixels().size() * sizeof(vec3f)) != 0) {
+                    std::cerr << result.name << ": incremental result differs from a full render" << std::endl;
+                }
+            }
+        }
+    }
+
+    const BenchOptions& options;
+    std::vector<BenchResult> results;
+};
+
+static bool write_json(const std::string& fileName, const BenchOptions& options, const std::vector<BenchResult>& results)
+{
+    std::ofstream file(fileName);
+    if (!file) {
+        return false;
+    }
+
+    file << "{\n";
+    file << "  \"version\": 1,\n";
+    file << "  \"simd\": \"" << GetPatternKernels().name << "\",\n";
+    file << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    file << "  \"warmup\": " << options.warmup << ",\n";
+    file << "  \"repetitions\": " << options.repeat << ",\n";
+    file << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        char numbers[512];
+        std::snprintf(numbers, sizeof(numbers),
+            "\"pixels\": %lld, \"samples\": %lld, \"mean_ms\": %.6f, \"median_ms\": %.6f, \"min_ms\": %.6f, \"stddev_ms\": %.6f, \"mpix_per_s\": %.3f, \"msamples_per_s\": %.3f",
+            static_cast<long long>(result.pixels), static_cast<long long>(result.samples), result.meanMs, result.medianMs, result.minMs, result.stddevMs,
+            result.MegaPixelsPerSecond(), result.MegaSamplesPerSecond());
+        file << "    {\"name\": \"" << result.name << "\", \"stage\": \"" << result.stage << "\", \"pattern\": \"" << result.pattern
+             << "\", \"aa\": \"" << result.aa << "\", \"aa_level\": " << result.aaLevel << ", \"width\": " << result.size.x
+             << ", \"height\": " << result.size.y << ", \"sites\": " << result.sites << ", \"threads\": " << result.threads << ", "
+             << numbers << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n";
+    file << "}\n";
+    return static_cast<bool>(file);
+}
+
+// write_json 이 쓴 파일에서 항목 이름별 median_ms 를 읽는다. 한 항목이 한 줄인 형식만 읽는다.
+static bool read_baseline(const std::string& fileName, std::map<std::string, double>& medians)
+{
+    std::ifstream file(fileName);
+    if (!file) {
+        return false;
+    }
+
+    const std::string nameKey = "\"name\": \"";
+    const std::string medianKey = "\"median_ms\": ";
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t namePos = line.find(nameKey);
+        const size_t medianPos = line.find(medianKey);
+        if (namePos == std::string::npos || medianPos == std::string::npos) {
+            continue;
+        }
+        const size_t nameStart = namePos + nameKey.size();
+        const size_t nameEnd = line.find('"', nameStart);
+        if (nameEnd == std::string::npos) {
+            continue;
+        }
+        medians[line.substr(nameStart, nameEnd - nameStart)] = std::strtod(line.c_str() + medianPos + medianKey.size(), nullptr);
+    }
+    return true;
+}
+
+// 기준선보다 tolerance 넘게 느려진 항목 수를 반환한다.
+static int compare_with_baseline(const std::vector<BenchResult>& results, const std::map<std::string, double>& baseline, double tolerance)
+{
+    int regressions = 0;
+    int compared = 0;
+    std::cout << std::endl << "Baseline comparison (tolerance " << tolerance * 100.0 << "%):" << std::endl;
+    for (const BenchResult& result : results) {
+        const auto found = baseline.find(result.name);
+        if (found == baseline.end() || found->second <= 0.0) {
+            continue;
+        }
+        ++compared;
+        const double ratio = result.medianMs / found->second;
+        const char* verdict = nullptr;
+        if (ratio > 1.0 + tolerance) {
+            verdict = "REGRESSION";
+            ++regressions;
+        } else if (ratio < 1.0 - tolerance) {
+            verdict = "improved";
+        }
+        if (verdict != nullptr) {
+            char line[256];
+            std::snprintf(line, sizeof(line), "  %-48s %9.3f ms -> %9.3f ms (%+.1f%%) %s", result.name.c_str(), found->second, result.medianMs, (ratio - 1.0) * 100.0, verdict);
+            std::cout << line << std::endl;
+        }
+    }
+    std::cout << "  " << compared << " compared, " << regressions << " regressions" << std::endl;
+    return regressions;
+}
+
+static void print_usage(const char* program)
+{
+    std::cout << "Usage: " << program << " [--quick] [--sizes WxH,...] [--aa type:level,...] [--patterns uv,checkerboard,circle,voronoi] [--sites N,...] [--threads N,...] [--stages generate,fxaa,quantize,export,edit] [--filter TEXT] [--warmup N] [--repeat N] [--simd auto|scalar|avx2|avx512] [--json FILE] [--baseline FILE] [--tolerance PERCENT]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --quick:      Small matrix (two small sizes, four AA modes, all hardware threads)" << std::endl;
+    std::cout << "  --sizes:      Output sizes (default: 640x360,1920x1080,3840x2160)" << std::endl;
+    std::cout << "  --aa:         AA modes as type:level (default: none:1,ssaa:2,ssaa:4,msaa:4,msaa:8,fxaa:1,analytic:1,adaptive:4)" << std::endl;
+    std::cout << "  --patterns:   Patterns to generate and filter with FXAA (default: all)" << std::endl;
+    std::cout << "  --sites:      Voronoi site counts (default: 100,1000)" << std::endl;
+    std::cout << "  --threads:    Worker thread counts, 0 = all hardware threads (default: 1 and all hardware threads)" << std::endl;
+    std::cout << "  --stages:     Stages to time; edit moves one Voronoi site in a retained render (default: all)" << std::endl;
+    std::cout << "  --filter:     Only run benchmarks whose name contains TEXT" << std::endl;
+    std::cout << "  --warmup N:   Untimed runs before measuring (default: 1)" << std::endl;
+    std::cout << "  --repeat N:   Timed runs; the median is reported (default: 5)" << std::endl;
+    std::cout << "  --simd:       Pattern kernel instruction set (default: auto)" << std::endl;
+    std::cout << "  --json:       Write results as JSON" << std::endl;
+    std::cout << "  --baseline:   Compare medians with a JSON file written by --json; exits with 2 on regressions" << std::endl;
+    std::cout << "  --tolerance:  Allowed slowdown against the baseline in percent (default: 10)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    ESimdLevel SimdLevel = ESimdLevel::AUTO;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "help" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg == "--quick") {
+            options.sizes = {{320, 180}, {640, 360}};
+            options.aaModes = {{EAAType::NONE, 1}, {EAAType::SSAA, 4}, {EAAType::MSAA, 4}, {EAAType::FXAA, 1}};
+            options.siteCounts = {100};
+            options.threadCounts = {0};
+        } else if (arg == "--sizes" && hasValue) {
+            options.sizes.clear();
+            for (const std::string& item : split_list(argv[++i])) {
+                int width = 0;
+                int height = 0;
+                if (std::sscanf(item.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+                    options.sizes.push_back({width, height});
+                }
+            }
+        } else if (arg == "--aa" && hasValue) {
+            options.aaModes.clear();
+            for (const std::string& item : split_list(argv[++i])) {
+                const size_t colon = item.find(':');
+                BenchAA aa = {EAAType::NONE, 1};
+                if (parse_aa_type(item.substr(0, colon), aa.type)) {
+                    aa.level = (colon == std::string::npos) ? 1 : clamp(std::atoi(item.c_str() + colon + 1), 1, MAX_AA_LEVEL);
+                    options.aaModes.push_back(aa);
+                }
+            }
+        } else if (arg == "--patterns" && hasValue) {
+            options.patterns = split_list(argv[++i]);
+        } else if (arg == "--sites" && hasValue) {
+            options.siteCounts.clear();
+            for (const std::string& item : split_list(argv[++i])) {
+                options.siteCounts.push_back(std::max(std::atoi(item.c_str()), 1));
+            }
+        } else if (arg == "--threads" && hasValue) {
+            options.threadCounts.clear();
+            for (const std::string& item : split_list(argv[++i])) {
+                options.threadCounts.push_back(std::max(std::atoi(item.c_str()), 0));
+            }
+        } else if (arg == "--stages" && hasValue) {
+            options.stages = split_list(argv[++i]);
+        } else if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--warmup" && hasValue) {
+            options.warmup = std::max(std::atoi(argv[++i]), 0);
+        } else if (arg == "--repeat" && hasValue) {
+            options.repeat = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--simd" && hasValue) {
+            const std::string simdStr = argv[++i];
+            if (simdStr == "scalar") {
+                SimdLevel = ESimdLevel::SCALAR;
+            } else if (simdStr == "avx2") {
+                SimdLevel = ESimdLevel::AVX2;
+            } else if (simdStr == "avx512") {
+                SimdLevel = ESimdLevel::AVX512;
+            } else {
+                SimdLevel = ESimdLevel::AUTO;
+            }
+        } else if (arg == "--json" && hasValue) {
+            options.jsonFile = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            options.baselineFile = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            options.tolerance = std::max(std::atof(argv[++i]), 0.0) / 100.0;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // 0 은 하드웨어 스레드 수다. 같은 수를 두 번 재지 않도록 실제 스레드 수로 바꿔 중복을 없앤다.
+    const int hardwareThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    if (options.threadCounts.empty()) {
+        options.threadCounts = {1, 0};
+    }
+    std::vector<int> threadCounts;
+    for (int threads : options.threadCounts) {
+        threads = (threads <= 0) ? hardwareThreads : threads;
+        if (std::find(threadCounts.begin(), threadCounts.end(), threads) == threadCounts.end()) {
+            threadCounts.push_back(threads);
+        }
+    }
+    options.threadCounts = threadCounts;
+    if (options.siteCounts.empty()) {
+        options.siteCounts = {100};
+    }
+
+    SetSimdLevel(SimdLevel);
+    std::cout << "simd " << GetPatternKernels().name << ", " << hardwareThreads << " hardware threads, warmup " << options.warmup
+              << ", repeat " << options.repeat << std::endl;
+
+    BenchRunner runner(options);
+    runner.Run();
+
+    if (!options.jsonFile.empty() && !write_json(options.jsonFile, options, runner.GetResults())) {
+        std::cerr << "Failed to write " << options.jsonFile << std::endl;
+        return 1;
+    }
+
+    if (!options.baselineFile.empty()) {
+        std::map<std::string, double> baseline;
+        if (!read_baseline(options.baselineFile, baseline)) {
+            std::cerr << "Failed to read " << options.baselineFile << std::endl;
+            return 1;
+        }
+        if (compare_with_baseline(runner.GetResults(), baseline, options.tolerance) > 0) {
+            return 2;
+        }
+    }
+
+    return 0;
+}
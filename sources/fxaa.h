@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "math.h"
+#include "pattern_simd.h"
+#include "profiler.h"
+#include "quantize.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+// FXAA 가 출력 픽셀 하나를 만들 때 읽는 입력 범위(끝점 탐색 9픽셀 + 여유). 위아래, 좌우 모두 같다.
+constexpr int FXAA_HALO_ROWS = 10;
+constexpr int FXAA_HALO_COLUMNS = FXAA_HALO_ROWS;
+
+// FXAA 를 한 번에 처리하는 출력 행 수. 휘도 버퍼는 이 행 수와 위아래 halo 만큼만 둔다.
+constexpr int FXAA_BAND_ROWS = 64;
+
+// 출력 영역 region 에 FXAA 를 적용해 target 에 쓴다(target 은 region.min 픽셀을 가리킨다).
+// pixels 는 전체 이미지 중 [pixelsFirstRow, pixelsFirstRow + pixelsRowCount) 행만 담은 전체 폭 버퍼이며,
+// 출력 영역의 위아래 FXAA_HALO_ROWS 행, 좌우 FXAA_HALO_COLUMNS 열(이미지 안쪽만)이 채워져 있어야 한다.
+// FXAA_BAND_ROWS 행씩 밴드와 halo 의 휘도를 SIMD 로 계산해 두고, 밴드를 타일로 나눠 스레드 풀에서 처리한다.
+// 휘도 버퍼는 밴드 크기라서 캐시에 머물고, 세로 끝점 탐색도 그 안에서 끝난다.
+// 이웃 픽셀은 이미지 가장자리로 당겨 읽고 끝점 탐색은 이미지 경계에서 멈추므로 테두리 픽셀도 처리한다.
+static void apply_fxaa_region(const vec2i& outputSize, const vec3f* pixels, int pixelsFirstRow, int pixelsRowCount, const RenderTile& region, const RenderTarget& target)
+{
+    const int minX = region.min.x;
+    const int maxX = region.max.x;
+    const int minY = region.min.y;
+    const int maxY = region.max.y;
+    constexpr float edgeThreshold = 0.001f;
+    ProfileStage profileStage("fxaa");
+    const PatternKernels& kernels = GetPatternKernels();
+    // 전체 이미지 좌표로 접근한다.
+    const vec3f* imagePixels = pixels - static_cast<ptrdiff_t>(pixelsFirstRow) * outputSize.x;
+    const int pixelsLastRow = pixelsFirstRow + pixelsRowCount;
+    const int lumaMinX = std::max(minX - FXAA_HALO_COLUMNS, 0);
+    const int lumaMaxX = std::min(maxX + FXAA_HALO_COLUMNS, outputSize.x);
+
+    // 휘도 행은 좌우로 한 칸씩 더 두고 가장자리 값을 복사해 둔다. 그래서 x - 1, x + 1 은 항상 그대로 읽는다.
+    const int lumaStride = outputSize.x + 2;
+    // 버퍼는 호출 스레드 것을 재사용한다. 작업 스레드에서는 이 참조로만 접근한다.
+    thread_local std::vector<float> lumaBandStorage;
+    std::vector<float>& lumaBand = lumaBandStorage;
+    // 버퍼 첫 행부터 휘도가 계산돼 있는 행 범위.
+    int lumaBandFirstRow = 0;
+    int lumaBandLastRow = 0;
+
+    for (int bandMinY = minY; bandMinY < maxY; bandMinY += FXAA_BAND_ROWS) {
+        const int bandMaxY = std::min(bandMinY + FXAA_BAND_ROWS, maxY);
+        const int lumaFirstRow = std::max(bandMinY - FXAA_HALO_ROWS, pixelsFirstRow);
+        const int lumaLastRow = std::min(bandMaxY + FXAA_HALO_ROWS, pixelsLastRow);
+
+        // 앞 밴드와 겹치는 halo 행의 휘도는 버퍼 앞으로 옮겨 다시 계산하지 않는다.
+        int computeFirstRow = lumaFirstRow;
+        if (lumaFirstRow >= lumaBandFirstRow && lumaFirstRow < lumaBandLastRow) {
+            const auto keepBegin = lumaBand.begin() + static_cast<ptrdiff_t>(lumaFirstRow - lumaBandFirstRow) * lumaStride;
+            std::copy(keepBegin, lumaBand.begin() + static_cast<ptrdiff_t>(lumaBandLastRow - lumaBandFirstRow) * lumaStride, lumaBand.begin());
+            computeFirstRow = lumaBandLastRow;
+        }
+        lumaBand.resize(static_cast<size_t>(lumaStride) * (lumaLastRow - lumaFirstRow));
+        lumaBandFirstRow = lumaFirstRow;
+        lumaBandLastRow = lumaLastRow;
+
+        parallel_for_tiles(RenderTile{{lumaMinX, computeFirstRow}, {lumaMaxX, lumaLastRow}}, [&](const RenderTile& tile) {
+            for (int y = tile.min.y; y < tile.max.y; ++y) {
+                float* lumaRow = lumaBand.data() + static_cast<size_t>(y - lumaFirstRow) * lumaStride + 1;
+                kernels.luma(imagePixels + static_cast<size_t>(y) * outputSize.x + tile.min.x, tile.max.x - tile.min.x, lumaRow + tile.min.x);
+                if (tile.min.x == 0) {
+                    lumaRow[-1] = lumaRow[0];
+                }
+                if (tile.max.x == outputSize.x) {
+                    lumaRow[outputSize.x] = lumaRow[outputSize.x - 1];
+                }
+            }
+        });
+
+        // rowX[x] 가 이미지 x 열의 휘도가 되도록 맞춘 행 포인터. 이미지 밖 행은 가장자리 행으로 당긴다.
+        auto lumaRow = [&](int row) {
+            return lumaBand.data() + static_cast<size_t>(clamp(row, 0, outputSize.y - 1) - lumaFirstRow) * lumaStride + 1;
+        };
+
+        parallel_for_tiles(RenderTile{{minX, bandMinY}, {maxX, bandMaxY}}, [&](const RenderTile& tile) {
+            const int tileWidth = tile.max.x - tile.min.x;
+            thread_local std::vector<FXAABlend> blends;
+            thread_local std::vector<vec3f> colors;
+            blends.resize(tileWidth);
+            colors.resize(tileWidth);
+            int64_t edgePixelCount = 0;
+
+            for (int y = tile.min.y; y < tile.max.y; ++y) {
+                FXAARowParams row;
+                row.north = lumaRow(y - 1) + tile.min.x;
+                row.center = lumaRow(y) + tile.min.x;
+                row.south = lumaRow(y + 1) + tile.min.x;
+                // 세로 끝점 탐색은 이미지 경계에서 멈춘다.
+                for (int j = 1; j <= 9; ++j) {
+                    row.forwardRows[j - 1] = (y + j < outputSize.y) ? lumaRow(y + j) + tile.min.x : row.center;
+                    row.backwardRows[j - 1] = (y - j >= 0) ? lumaRow(y - j) + tile.min.x : row.center;
+                }
+                row.column = tile.min.x;
+                row.imageWidth = outputSize.x;
+                row.threshold = edgeThreshold;
+
+                // 대비가 없는 픽셀은 SIMD 커널이 8/16개씩 걸러 내고, 색이 바뀌는 픽셀만 돌려받는다.
+                int blendCount = 0;
+                edgePixelCount += kernels.fxaaRow(row, tileWidth, blends.data(), blendCount);
+
+                // 바뀐 픽셀이 없으면 행을 그대로 쓴다. 있으면 복사해 뒤쪽(왼쪽 또는 위) 이웃과 섞는다.
+                const vec3f* rowPixels = imagePixels + static_cast<size_t>(y) * outputSize.x + tile.min.x;
+                if (blendCount == 0) {
+                    target.StoreRow(tile.min.x - minX, y - minY, rowPixels, tileWidth);
+                    continue;
+                }
+                std::copy(rowPixels, rowPixels + tileWidth, colors.begin());
+                for (int k = 0; k < blendCount; ++k) {
+                    const int i = blends[k].index;
+                    const vec3f& neighbor = blends[k].vertical ? rowPixels[i - outputSize.x] : rowPixels[i - 1];
+                    colors[i] = (colors[i] + neighbor) * 0.5f;
+                }
+                target.StoreRow(tile.min.x - minX, y - minY, colors.data(), tileWidth);
+            }
+            profile_add_counter(EProfileCounter::FXAA_EDGE_PIXELS, edgePixelCount);
+        });
+    }
+}
+
+// 출력 행 [minY, maxY) 에 FXAA 를 적용해 target 에 쓴다(target 은 (0, minY) 픽셀을 가리킨다).
+static void apply_fxaa_rows(const vec2i& outputSize, const vec3f* pixels, int pixelsFirstRow, int pixelsRowCount, int minY, int maxY, const RenderTarget& target)
+{
+    apply_fxaa_region(outputSize, pixels, pixelsFirstRow, pixelsRowCount, RenderTile{{0, minY}, {outputSize.x, maxY}}, target);
+}
+
+// 출력 행 [minY, maxY) 을 float 버퍼 out 에 쓴다.
+static void apply_fxaa_rows(const vec2i& outputSize, const vec3f* pixels, int pixelsFirstRow, int pixelsRowCount, int minY, int maxY, vec3f* out)
+{
+    apply_fxaa_rows(outputSize, pixels, pixelsFirstRow, pixelsRowCount, minY, maxY, make_float_target(out, outputSize.x));
+}
+
+inline std::vector<vec3f> apply_fxaa(const vec2i& outputSize, const std::vector<vec3f>& pixels)
+{
+    std::vector<vec3f> edgePixels(static_cast<size_t>(outputSize.x) * outputSize.y);
+    apply_fxaa_rows(outputSize, pixels.data(), 0, outputSize.y, 0, outputSize.y, edgePixels.data());
+    return edgePixels;
+}
+
+// 패턴을 가로 밴드 단위로 렌더하면서 FXAA 를 적용한다. 밴드는 위에서 아래로 차례로 요청해야 한다.
+// 렌더된 float 행은 밴드와 위아래 FXAA_HALO_ROWS 행을 담는 창에만 두고, 앞 밴드와 겹치는 행은 앞으로 옮겨 다시 렌더하지 않는다.
+// 그래서 전체 크기의 float 이미지 없이 모든 행을 한 번씩만 렌더하며 결과는 apply_fxaa 와 같다.
+// 열 범위 [minX, maxX) 를 주면 그 열과 좌우 FXAA_HALO_COLUMNS 열만 렌더해 같은 위치의 전체 렌더 결과를 만든다.
+// 패턴 행은 PatternBandRenderer 로 렌더하므로 대칭 패턴은 rowCacheBytes 까지 앞 밴드의 행을 복사해 쓴다.
+template<typename Pattern>
+class FXAABandRenderer
+{
+public:
+    FXAABandRenderer(const vec2i& outputSize, const Pattern& pattern, int maxBandRows, RenderSampleStats* stats = nullptr, int minX = 0, int maxX = -1, size_t rowCacheBytes = 0)
+        : outputSize(outputSize)
+        , stats(stats)
+        , minX(clamp(minX, 0, outputSize.x))
+        , maxX((maxX < 0) ? outputSize.x : clamp(maxX, this->minX, outputSize.x))
+        , renderMinX(std::max(this->minX - FXAA_HALO_COLUMNS, 0))
+        , renderMaxX(std::min(this->maxX + FXAA_HALO_COLUMNS, outputSize.x))
+        , patternBands(outputSize, EAAType::FXAA, 1, pattern, RenderTile{{renderMinX, 0}, {renderMaxX, outputSize.y}}, rowCacheBytes)
+        , rowPixels(static_cast<size_t>(outputSize.x))
+        , window((maxBandRows + 2 * FXAA_HALO_ROWS) * rowPixels)
+    {
+        profile_track_buffer(static_cast<int64_t>(window.size() * sizeof(vec3f)));
+    }
+
+    ~FXAABandRenderer()
+    {
+        profile_release_buffer(static_cast<int64_t>(window.size() * sizeof(vec3f)));
+    }
+
+    FXAABandRenderer(const FXAABandRenderer&) = delete;
+    FXAABandRenderer& operator=(const FXAABandRenderer&) = delete;
+
+    // 출력 행 [bandMinY, bandMaxY) 를 target 에 쓴다(target 은 (minX, bandMinY) 픽셀을 가리킨다).
+    void RenderBand(int bandMinY, int bandMaxY, const RenderTarget& target)
+    {
+        const int needFirstRow = std::max(bandMinY - FXAA_HALO_ROWS, 0);
+        const int needLastRow = std::min(bandMaxY + FXAA_HALO_ROWS, outputSize.y);
+
+        const int keepFirstRow = std::max(needFirstRow, windowFirstRow);
+        const int keepLastRow = std::min(needLastRow, windowFirstRow + windowRowCount);
+        int renderFirstRow = needFirstRow;
+        if (keepLastRow > keepFirstRow) {
+            std::memmove(window.data(),
+                window.data() + (keepFirstRow - windowFirstRow) * rowPixels,
+                (keepLastRow - keepFirstRow) * rowPixels * sizeof(vec3f));
+            renderFirstRow = keepLastRow;
+        }
+        if (needLastRow > renderFirstRow) {
+            // 창의 행은 전체 폭이고, 그중 렌더할 열만 채운다.
+            vec3f* regionPixels = window.data() + (renderFirstRow - needFirstRow) * rowPixels + renderMinX;
+            RenderTarget regionTarget = make_float_target(regionPixels, outputSize.x);
+            patternBands.RenderBand(renderFirstRow, needLastRow, regionTarget, stats);
+        }
+        windowFirstRow = needFirstRow;
+        windowRowCount = needLastRow - needFirstRow;
+
+        apply_fxaa_region(outputSize, window.data(), windowFirstRow, windowRowCount, RenderTile{{minX, bandMinY}, {maxX, bandMaxY}}, target);
+    }
+
+private:
+    vec2i outputSize;
+    RenderSampleStats* stats;
+    int minX;
+    int maxX;
+    int renderMinX;
+    int renderMaxX;
+    PatternBandRenderer<Pattern> patternBands;
+    size_t rowPixels;
+    std::vector<vec3f> window;
+    int windowFirstRow = 0;
+    int windowRowCount = 0;
+};
+
+// 패턴을 렌더하고 FXAA 를 적용한 결과 중 region 을 target 에 쓴다(target 은 region.min 픽셀을 가리킨다).
+// 값은 전체 렌더의 같은 위치와 같다. 밴드 단위로 돌므로 float 픽셀은 FXAABandRenderer 의 창 크기만큼만 있다.
+template<typename Pattern>
+static void render_pattern_fxaa_region(const vec2i& outputSize, const Pattern& pattern, const RenderTile& region, const RenderTarget& target, RenderSampleStats* stats = nullptr)
+{
+    FXAABandRenderer<Pattern> bands(outputSize, pattern, FXAA_BAND_ROWS, stats, region.min.x, region.max.x, DEFAULT_BAND_ROW_CACHE_BYTES);
+    for (int bandMinY = region.min.y; bandMinY < region.max.y; bandMinY += FXAA_BAND_ROWS) {
+        RenderTarget bandTarget = target;
+        bandTarget.data = static_cast<unsigned char*>(target.data) + static_cast<size_t>(bandMinY - region.min.y) * target.rowStride;
+        bands.RenderBand(bandMinY, std::min(bandMinY + FXAA_BAND_ROWS, region.max.y), bandTarget);
+    }
+}
+
+template<typename Pattern>
+static void render_pattern_fxaa_to_target(const vec2i& outputSize, const Pattern& pattern, const RenderTarget& target, RenderSampleStats* stats = nullptr)
+{
+    render_pattern_fxaa_region(outputSize, pattern, RenderTile{{0, 0}, outputSize}, target, stats);
+}
+
+// 패턴을 렌더하고 FXAA 를 적용한 결과를 encoder 형식으로 바로 쓴다.
+// 반환한 버퍼는 render_pattern_encoded 와 같이 다 쓰고 나서 profile_release_buffer 로 알린다.
+// roi 를 주면 roi 크기의 이미지를 만든다.
+template<typename Pattern>
+static std::vector<unsigned char> render_pattern_fxaa_encoded(const vec2i& outputSize, const Pattern& pattern, const RenderTile& roi, const PixelEncoder& encoder, RenderSampleStats* stats = nullptr)
+{
+    const int width = roi.max.x - roi.min.x;
+    std::vector<unsigned char> data(static_cast<size_t>(width) * (roi.max.y - roi.min.y) * encoder.GetBytesPerPixel());
+    profile_track_buffer(static_cast<int64_t>(data.size()));
+    render_pattern_fxaa_region(outputSize, pattern, roi, make_encoded_target(data.data(), width, encoder), stats);
+    return data;
+}
+
+template<typename Pattern>
+static std::vector<unsigned char> render_pattern_fxaa_encoded(const vec2i& outputSize, const Pattern& pattern, const PixelEncoder& encoder, RenderSampleStats* stats = nullptr)
+{
+    return render_pattern_fxaa_encoded(outputSize, pattern, RenderTile{{0, 0}, outputSize}, encoder, stats);
+}
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fxaa.h"
+#include "pattern_simd.h"
+#include "ppm.h"
+#include "quantize.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+// 렌더 결과를 기준 이미지(보통 고배율 SSAA)와 비교하는 화질 지표.
+// 정수 픽셀 값끼리 비교하므로 파일로 쓴 결과와 그대로 맞는다. 16비트 이미지는 빅엔디언 샘플이다.
+// 오차 합은 행 묶음마다 스레드로 나누고, 8비트는 AVX2 로 32바이트씩 더한다(정수 연산이라 스칼라와 결과가 같다).
+// SSIM 은 휘도 평면에서 8x8 창을 4픽셀 간격으로 옮기며 구한 값의 평균이다.
+
+// 기준 이미지를 렌더할 때의 기본 SSAA 레벨.
+constexpr int DEFAULT_REFERENCE_SSAA_LEVEL = MAX_AA_LEVEL;
+
+constexpr int METRICS_ROWS_PER_TASK = 32;
+constexpr int SSIM_WINDOW = 8;
+constexpr int SSIM_STRIDE = 4;
+
+struct EncodedImage
+{
+    int width = 0;
+    int height = 0;
+    int maxValue = 255;
+    std::vector<unsigned char> data;
+
+    int GetBytesPerSample() const { return (maxValue > 255) ? 2 : 1; }
+};
+
+struct ImageMetrics
+{
+    double psnr = 0.0;        // dB, 같으면 무한대
+    double ssim = 0.0;
+    int maxError = 0;         // 채널 값 단위
+    double meanError = 0.0;   // 채널 값 단위 평균 절대 오차
+};
+
+// P6 파일 전체를 읽는다.
+static bool load_ppm_image(const char* filename, EncodedImage& image)
+{
+    FILE* file = open_file_stream(filename, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = read_ppm_header(file, image.width, image.height, image.maxValue);
+    if (ok) {
+        image.data.resize(static_cast<size_t>(image.width) * image.height * 3 * image.GetBytesPerSample());
+        ok = std::fread(image.data.data(), 1, image.data.size(), file) == image.data.size();
+    }
+    std::fclose(file);
+    return ok;
+}
+
+struct ErrorSums
+{
+    uint64_t squared = 0;
+    uint64_t absolute = 0;
+    uint32_t maxAbsolute = 0;
+
+    ErrorSums& operator+=(const ErrorSums& other)
+    {
+        squared += other.squared;
+        absolute += other.absolute;
+        maxAbsolute = std::max(maxAbsolute, other.maxAbsolute);
+        return *this;
+    }
+};
+
+static void error_sums8_scalar(const unsigned char* a, const unsigned char* b, size_t count, ErrorSums& sums)
+{
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t diff = static_cast<uint32_t>(std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+        sums.squared += diff * diff;
+        sums.absolute += diff;
+        sums.maxAbsolute = std::max(sums.maxAbsolute, diff);
+    }
+}
+
+static void error_sums16_scalar(const unsigned char* a, const unsigned char* b, size_t count, ErrorSums& sums)
+{
+    for (size_t i = 0; i < count; ++i) {
+        const int valueA = a[i * 2] << 8 | a[i * 2 + 1];
+        const int valueB = b[i * 2] << 8 | b[i * 2 + 1];
+        const uint64_t diff = static_cast<uint64_t>(std::abs(valueA - valueB));
+        sums.squared += diff * diff;
+        sums.absolute += diff;
+        sums.maxAbsolute = std::max(sums.maxAbsolute, static_cast<uint32_t>(diff));
+    }
+}
+
+#if PATTERN_SIMD_X86
+// 32바이트씩: |a-b| 는 포화 뺄셈 두 번의 OR, 절대 오차 합은 SAD, 제곱 합은 16비트로 펼쳐 madd.
+PATTERN_SIMD_TARGET_AVX2 static void error_sums8_avx2(const unsigned char* a, const unsigned char* b, size_t count, ErrorSums& sums)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i absolute = _mm256_setzero_si256();
+    __m256i squared = _mm256_setzero_si256();
+    __m256i maxAbsolute = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+        absolute = _mm256_add_epi64(absolute, _mm256_sad_epu8(va, vb));
+        maxAbsolute = _mm256_max_epu8(maxAbsolute, diff);
+        const __m256i low = _mm256_unpacklo_epi8(diff, zero);
+        const __m256i high = _mm256_unpackhi_epi8(diff, zero);
+        // 제곱 두 개의 합은 2 * 255^2 이하라 32비트 칸에 넣고 바로 64비트로 모은다.
+        const __m256i pairs = _mm256_add_epi32(_mm256_madd_epi16(low, low), _mm256_madd_epi16(high, high));
+        squared = _mm256_add_epi64(squared, _mm256_add_epi64(_mm256_unpacklo_epi32(pairs, zero), _mm256_unpackhi_epi32(pairs, zero)));
+    }
+
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), absolute);
+    sums.absolute += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), squared);
+    sums.squared += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    alignas(32) unsigned char maxLanes[32];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxLanes), maxAbsolute);
+    for (const unsigned char value : maxLanes) {
+        sums.maxAbsolute = std::max(sums.maxAbsolute, static_cast<uint32_t>(value));
+    }
+    error_sums8_scalar(a + i, b + i, count - i, sums);
+}
+#endif
+
+using ErrorSumsFunc = void (*)(const unsigned char*, const unsigned char*, size_t, ErrorSums&);
+
+// --simd 로 고른 수준을 따른다. AVX-512 를 고른 CPU 는 AVX2 도 지원한다.
+static ErrorSumsFunc get_error_sums_func(int bytesPerSample)
+{
+    if (bytesPerSample == 2) {
+        return error_sums16_scalar;
+    }
+#if PATTERN_SIMD_X86
+    if (GetPatternKernels().level != ESimdLevel::SCALAR) {
+        return error_sums8_avx2;
+    }
+#endif
+    return error_sums8_scalar;
+}
+
+// 휘도 평면(채널 값 단위, 정수 가중치 77/150/29 / 256).
+static std::vector<uint16_t> make_luma_plane(const EncodedImage& image)
+{
+    std::vector<uint16_t> luma(static_cast<size_t>(image.width) * image.height);
+    const int bytesPerSample = image.GetBytesPerSample();
+    const int taskCount = (image.height + METRICS_ROWS_PER_TASK - 1) / METRICS_ROWS_PER_TASK;
+    GetThreadPool().ParallelFor(taskCount, [&](int task) {
+        const size_t begin = static_cast<size_t>(task) * METRICS_ROWS_PER_TASK * image.width;
+        const size_t end = std::min(static_cast<size_t>(task + 1) * METRICS_ROWS_PER_TASK, static_cast<size_t>(image.height)) * image.width;
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t channels[3];
+            for (int c = 0; c < 3; ++c) {
+                const unsigned char* sample = image.data.data() + (i * 3 + c) * bytesPerSample;
+                channels[c] = (bytesPerSample == 2) ? (sample[0] << 8 | sample[1]) : sample[0];
+            }
+            luma[i] = static_cast<uint16_t>((77 * channels[0] + 150 * channels[1] + 29 * channels[2] + 128) >> 8);
+        }
+    });
+    return luma;
+}
+
+static double compute_ssim(const EncodedImage& a, const EncodedImage& b)
+{
+    const std::vector<uint16_t> lumaA = make_luma_plane(a);
+    const std::vector<uint16_t> lumaB = make_luma_plane(b);
+    const int width = a.width;
+    const int windowsX = (a.width >= SSIM_WINDOW) ? (a.width - SSIM_WINDOW) / SSIM_STRIDE + 1 : 0;
+    const int windowsY = (a.height >= SSIM_WINDOW) ? (a.height - SSIM_WINDOW) / SSIM_STRIDE + 1 : 0;
+    if (windowsX == 0 || windowsY == 0) {
+        return (lumaA == lumaB) ? 1.0 : 0.0;
+    }
+
+    const double range = static_cast<double>(a.maxValue);
+    const double c1 = (0.01 * range) * (0.01 * range);
+    const double c2 = (0.03 * range) * (0.03 * range);
+    constexpr double N = SSIM_WINDOW * SSIM_WINDOW;
+    std::vector<double> rowSums(windowsY, 0.0);
+    GetThreadPool().ParallelFor(windowsY, [&](int wy) {
+        double rowSum = 0.0;
+        for (int wx = 0; wx < windowsX; ++wx) {
+            uint64_t sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+            for (int y = 0; y < SSIM_WINDOW; ++y) {
+                const size_t offset = static_cast<size_t>(wy * SSIM_STRIDE + y) * width + wx * SSIM_STRIDE;
+                const uint16_t* rowA = lumaA.data() + offset;
+                const uint16_t* rowB = lumaB.data() + offset;
+                for (int x = 0; x < SSIM_WINDOW; ++x) {
+                    const uint64_t va = rowA[x];
+                    const uint64_t vb = rowB[x];
+                    sumA += va;
+                    sumB += vb;
+                    sumAA += va * va;
+                    sumBB += vb * vb;
+                    sumAB += va * vb;
+                }
+            }
+            const double meanA = sumA / N;
+            const double meanB = sumB / N;
+            const double varA = sumAA / N - meanA * meanA;
+            const double varB = sumBB / N - meanB * meanB;
+            const double covariance = sumAB / N - meanA * meanB;
+            rowSum += ((2.0 * meanA * meanB + c1) * (2.0 * covariance + c2)) / ((meanA * meanA + meanB * meanB + c1) * (varA + varB + c2));
+        }
+        rowSums[wy] = rowSum;
+    });
+    double total = 0.0;
+    for (const double rowSum : rowSums) {
+        total += rowSum;
+    }
+    return total / (static_cast<double>(windowsX) * windowsY);
+}
+
+// 크기와 최댓값이 같아야 한다. 다르면 false.
+static bool compute_image_metrics(const EncodedImage& image, const EncodedImage& reference, ImageMetrics& metrics)
+{
+    if (image.width != reference.width || image.height != reference.height || image.maxValue != reference.maxValue || image.data.size() != reference.data.size()) {
+        return false;
+    }
+
+    ProfileStage profileStage("metrics");
+    const int bytesPerSample = image.GetBytesPerSample();
+    const ErrorSumsFunc errorSums = get_error_sums_func(bytesPerSample);
+    const size_t rowSamples = static_cast<size_t>(image.width) * 3;
+    const int taskCount = (image.height + METRICS_ROWS_PER_TASK - 1) / METRICS_ROWS_PER_TASK;
+    std::vector<ErrorSums> taskSums(taskCount);
+    GetThreadPool().ParallelFor(taskCount, [&](int task) {
+        const int minY = task * METRICS_ROWS_PER_TASK;
+        const int maxY = std::min(minY + METRICS_ROWS_PER_TASK, image.height);
+        const size_t offset = static_cast<size_t>(minY) * rowSamples * bytesPerSample;
+        errorSums(image.data.data() + offset, reference.data.data() + offset, static_cast<size_t>(maxY - minY) * rowSamples, taskSums[task]);
+    });
+    ErrorSums sums;
+    for (const ErrorSums& taskSum : taskSums) {
+        sums += taskSum;
+    }
+
+    const double sampleCount = static_cast<double>(rowSamples) * image.height;
+    const double mse = static_cast<double>(sums.squared) / sampleCount;
+    metrics.psnr = (mse > 0.0) ? 10.0 * std::log10(static_cast<double>(image.maxValue) * image.maxValue / mse) : std::numeric_limits<double>::infinity();
+    metrics.meanError = static_cast<double>(sums.absolute) / sampleCount;
+    metrics.maxError = static_cast<int>(sums.maxAbsolute);
+    metrics.ssim = compute_ssim(image, reference);
+    return true;
+}
+
+// "ssaa16" 처럼 내부 SSAA 기준을 뜻하면 레벨, 아니면 0(파일 이름).
+static int parse_reference_ssaa_level(const std::string& text)
+{
+    if (text.size() > 4 && text.compare(0, 4, "ssaa") == 0 && text.find_first_not_of("0123456789", 4) == std::string::npos) {
+        return clamp(std::atoi(text.c_str() + 4), 1, MAX_AA_LEVEL);
+    }
+    return 0;
+}
+
+// roi 를 AAType/AALevel 로 렌더해 encoder 형식 이미지로 만든다. FXAA 도 단일 렌더와 같은 결과다.
+template<typename Pattern>
+static EncodedImage render_encoded_image(const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const RenderTile& roi, const PixelEncoder& encoder, RenderSampleStats* stats = nullptr)
+{
+    EncodedImage image;
+    image.width = roi.max.x - roi.min.x;
+    image.height = roi.max.y - roi.min.y;
+    image.maxValue = encoder.GetMaxValue();
+    if (AAType == EAAType::FXAA) {
+        image.data = render_pattern_fxaa_encoded(outputSize, pattern, roi, encoder, stats);
+    } else {
+        image.data = render_pattern_encoded(outputSize, AAType, AALevel, pattern, roi, encoder, stats);
+    }
+    profile_release_buffer(static_cast<int64_t>(image.data.size()));
+    return image;
+}
+
+struct AASelectionResult
+{
+    EAAType type = EAAType::NONE;
+    int level = 1;
+    ImageMetrics metrics;
+    double milliseconds = 0.0;
+    double samplesPerPixel = 0.0;
+};
+
+// 자동 선택에서 시도하는 설정. 싼 것부터.
+static std::vector<std::pair<EAAType, int>> get_aa_selection_candidates()
+{
+    return {
+        {EAAType::FXAA, 1}, {EAAType::ANALYTIC, 1},
+        {EAAType::MSAA, 1}, {EAAType::MSAA, 2}, {EAAType::MSAA, 4}, {EAAType::MSAA, 8}, {EAAType::MSAA, 16},
+        {EAAType::ADAPTIVE, 2}, {EAAType::ADAPTIVE, 4}, {EAAType::ADAPTIVE, 8},
+        {EAAType::SSAA, 2}, {EAAType::SSAA, 3}, {EAAType::SSAA, 4}, {EAAType::SSAA, 6}, {EAAType::SSAA, 8},
+    };
+}
+
+// 후보 설정을 하나씩 렌더해 reference 와 비교하고 results 에 담는다(렌더 시간 순).
+// 목표 PSNR 을 넘는 것 중 가장 빨리 렌더된 설정의 인덱스를 돌려주고, 없으면 -1.
+// makePattern(AAType, AALevel) 은 그 설정의 단일 렌더와 같은 패턴을 std::unique_ptr 로 돌려준다.
+template<typename MakePattern>
+static int select_aa_setting(const vec2i& outputSize, const RenderTile& roi, const MakePattern& makePattern, const PixelEncoder& encoder, const EncodedImage& reference,
+    double targetPsnr, std::vector<AASelectionResult>& results)
+{
+    const double pixelCount = static_cast<double>(roi.max.x - roi.min.x) * (roi.max.y - roi.min.y);
+    for (const auto& [type, level] : get_aa_selection_candidates()) {
+        const auto pattern = makePattern(type, level);
+        RenderSampleStats stats;
+        const auto start = std::chrono::steady_clock::now();
+        const EncodedImage image = render_encoded_image(outputSize, type, level, *pattern, roi, encoder, &stats);
+        AASelectionResult result;
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.type = type;
+        result.level = level;
+        result.samplesPerPixel = stats.sampleCount / pixelCount;
+        compute_image_metrics(image, reference, result.metrics);
+        results.push_back(result);
+    }
+
+    std::sort(results.begin(), results.end(), [](const AASelectionResult& a, const AASelectionResult& b) { return a.milliseconds < b.milliseconds; });
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].metrics.psnr >= targetPsnr) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "fxaa.h"
+#include "math.h"
+#include "pattern.h"
+#include "profiler.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+// 대화형 도구용 유지 렌더 상태. 이전 프레임버퍼를 들고 있다가 패턴이 바뀐 영역만 다시 렌더한다.
+// 영역 렌더는 전체 렌더의 같은 위치와 같은 값을 내므로(render_pattern_region), 바뀐 영역을 빠짐없이 주면
+// 결과는 처음부터 다시 렌더한 것과 비트 단위로 같다.
+
+static bool is_empty_tile(const RenderTile& tile)
+{
+    return tile.max.x <= tile.min.x || tile.max.y <= tile.min.y;
+}
+
+static RenderTile union_render_tiles(const RenderTile& a, const RenderTile& b)
+{
+    if (is_empty_tile(a)) {
+        return b;
+    }
+    if (is_empty_tile(b)) {
+        return a;
+    }
+    return {{std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y)}, {std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y)}};
+}
+
+static RenderTile clip_render_tile(const RenderTile& tile, const vec2i& outputSize)
+{
+    RenderTile clipped;
+    clipped.min = {clamp(tile.min.x, 0, outputSize.x), clamp(tile.min.y, 0, outputSize.y)};
+    clipped.max = {clamp(tile.max.x, clipped.min.x, outputSize.x), clamp(tile.max.y, clipped.min.y, outputSize.y)};
+    return clipped;
+}
+
+// 전체 크기 float 프레임버퍼. FXAA 면 FXAA 전 이미지도 따로 두고, 바뀐 영역과 그 FXAA_HALO 만 다시 거른다.
+class RetainedRender
+{
+public:
+    RetainedRender(const vec2i& outputSize, const EAAType AAType, const int AALevel)
+        : outputSize(outputSize)
+        , AAType(AAType)
+        , AALevel(AALevel)
+        , rendered(static_cast<size_t>(outputSize.x) * outputSize.y)
+    {
+        if (AAType == EAAType::FXAA) {
+            filtered.resize(rendered.size());
+        }
+    }
+
+    template<typename Pattern>
+    void Render(const Pattern& pattern, RenderSampleStats* stats = nullptr)
+    {
+        Update(pattern, RenderTile{{0, 0}, outputSize}, stats);
+    }
+
+    // dirty(전체 이미지 좌표) 안의 픽셀만 pattern 으로 다시 렌더한다.
+    // dirty 밖의 픽셀은 pattern 이 앞서 렌더한 패턴과 같은 값을 내야 한다.
+    template<typename Pattern>
+    void Update(const Pattern& pattern, const RenderTile& dirty, RenderSampleStats* stats = nullptr)
+    {
+        const RenderTile region = clip_render_tile(dirty, outputSize);
+        updatedRegion = region;
+        if (is_empty_tile(region)) {
+            return;
+        }
+
+        render_pattern_region(outputSize, AAType, AALevel, pattern, region, MakeTarget(rendered, region), stats);
+        if (AAType == EAAType::FXAA) {
+            // 바뀐 픽셀을 읽는 출력 픽셀은 halo 만큼 더 퍼져 있다.
+            RenderTile halo = {region.min - vec2i{FXAA_HALO_COLUMNS, FXAA_HALO_ROWS}, region.max + vec2i{FXAA_HALO_COLUMNS, FXAA_HALO_ROWS}};
+            updatedRegion = clip_render_tile(halo, outputSize);
+            ProfileStage profileStage("fxaa");
+            apply_fxaa_region(outputSize, rendered.data(), 0, outputSize.y, updatedRegion, MakeTarget(filtered, updatedRegion));
+        }
+    }
+
+    const vec2i& GetSize() const { return outputSize; }
+    EAAType GetAAType() const { return AAType; }
+    int GetAALevel() const { return AALevel; }
+
+    // 최종 이미지(FXAA 면 적용 후). 행 간격은 GetSize().x 픽셀이다.
+    const std::vector<vec3f>& GetPixels() const { return (AAType == EAAType::FXAA) ? filtered : rendered; }
+
+    // 마지막 Render/Update 로 값이 바뀌었을 수 있는 픽셀 영역. 화면에 다시 올릴 부분이다.
+    const RenderTile& GetUpdatedRegion() const { return updatedRegion; }
+
+private:
+    RenderTarget MakeTarget(std::vector<vec3f>& pixels, const RenderTile& region) const
+    {
+        return make_float_target(pixels.data() + static_cast<size_t>(region.min.y) * outputSize.x + region.min.x, outputSize.x);
+    }
+
+    vec2i outputSize;
+    EAAType AAType;
+    int AALevel;
+    std::vector<vec3f> rendered;
+    std::vector<vec3f> filtered;
+    RenderTile updatedRegion = {{0, 0}, {0, 0}};
+};
+
+// 사이트 index 의 Voronoi 셀을 패턴 영역 [0, patternSize] 로 자른 다각형의 바운딩 박스(패턴 좌표).
+// 다른 사이트마다 수직이등분선의 반평면으로 잘라 나간다. 같은 위치의 사이트는 건너뛰므로 박스는 실제 셀을 항상 포함한다.
+// 셀이 비면 false.
+static bool get_voronoi_cell_bounds(const std::vector<vec2f>& sites, int index, const vec2i& patternSize, double& minX, double& minY, double& maxX, double& maxY)
+{
+    struct ClipPoint
+    {
+        double x;
+        double y;
+    };
+    std::vector<ClipPoint> polygon = {{0.0, 0.0}, {static_cast<double>(patternSize.x), 0.0}, {static_cast<double>(patternSize.x), static_cast<double>(patternSize.y)}, {0.0, static_cast<double>(patternSize.y)}};
+    std::vector<ClipPoint> clipped;
+
+    const double siteX = sites[index].x;
+    const double siteY = sites[index].y;
+    for (size_t i = 0; i < sites.size() && !polygon.empty(); ++i) {
+        const double dirX = sites[i].x - siteX;
+        const double dirY = sites[i].y - siteY;
+        if (static_cast<int>(i) == index || (dirX == 0.0 && dirY == 0.0)) {
+            continue;
+        }
+        // (p - 중점) . dir <= 0 인 쪽이 index 에 더 가깝다.
+        const double midX = siteX + 0.5 * dirX;
+        const double midY = siteY + 0.5 * dirY;
+        auto side = [&](const ClipPoint& p) { return (p.x - midX) * dirX + (p.y - midY) * dirY; };
+
+        clipped.clear();
+        for (size_t k = 0; k < polygon.size(); ++k) {
+            const ClipPoint& a = polygon[k];
+            const ClipPoint& b = polygon[(k + 1) % polygon.size()];
+            const double sideA = side(a);
+            const double sideB = side(b);
+            if (sideA <= 0.0) {
+                clipped.push_back(a);
+            }
+            if ((sideA < 0.0 && sideB > 0.0) || (sideA > 0.0 && sideB < 0.0)) {
+                const double t = sideA / (sideA - sideB);
+                clipped.push_back({a.x + t * (b.x - a.x), a.y + t * (b.y - a.y)});
+            }
+        }
+        std::swap(polygon, clipped);
+    }
+    if (polygon.empty()) {
+        return false;
+    }
+
+    minX = maxX = polygon[0].x;
+    minY = maxY = polygon[0].y;
+    for (const ClipPoint& p : polygon) {
+        minX = std::min(minX, p.x);
+        maxX = std::max(maxX, p.x);
+        minY = std::min(minY, p.y);
+        maxY = std::max(maxY, p.y);
+    }
+    return true;
+}
+
+// Voronoi 사이트를 하나씩 옮기거나 더하거나 지울 때, 바뀐 셀이 덮는 픽셀만 다시 렌더한다.
+// 사이트를 옮기면 옛 셀(새 주인과 색이 바뀐다)과 새 셀, 더하면 새 셀, 지우면 옛 셀만 바뀐다.
+// 셀 박스는 float 거리 반올림과 AA 샘플 범위를 넉넉히 덮도록 픽셀 1개씩 넓힌다.
+// 동거리는 인덱스가 작은 사이트가 이기고, 지워도 남은 사이트의 순서는 그대로라 다른 픽셀의 결과는 변하지 않는다.
+class IncrementalVoronoiRender
+{
+public:
+    // sites 는 get_voronoi_pattern_size 해상도 기준 좌표.
+    IncrementalVoronoiRender(const vec2i& outputSize, const EAAType AAType, const int AALevel, std::vector<vec2f> sites, const EVoronoiLookup lookup)
+        : render(outputSize, AAType, AALevel)
+        , patternSize(get_voronoi_pattern_size(outputSize, AAType, AALevel))
+        , sites(std::move(sites))
+        , lookup(lookup)
+    {
+    }
+
+    void Render(RenderSampleStats* stats = nullptr)
+    {
+        Refresh(RenderTile{{0, 0}, render.GetSize()}, stats);
+    }
+
+    bool MoveSite(int index, const vec2f& position, RenderSampleStats* stats = nullptr)
+    {
+        if (index < 0 || index >= static_cast<int>(sites.size())) {
+            return false;
+        }
+        const RenderTile oldCell = GetCellPixels(index);
+        sites[index] = position;
+        Refresh(union_render_tiles(oldCell, GetCellPixels(index)), stats);
+        return true;
+    }
+
+    void AddSite(const vec2f& position, RenderSampleStats* stats = nullptr)
+    {
+        sites.push_back(position);
+        Refresh(GetCellPixels(static_cast<int>(sites.size()) - 1), stats);
+    }
+
+    // 마지막 사이트는 지울 수 없다.
+    bool RemoveSite(int index, RenderSampleStats* stats = nullptr)
+    {
+        if (index < 0 || index >= static_cast<int>(sites.size()) || sites.size() == 1) {
+            return false;
+        }
+        const RenderTile oldCell = GetCellPixels(index);
+        sites.erase(sites.begin() + index);
+        Refresh(oldCell, stats);
+        return true;
+    }
+
+    const std::vector<vec2f>& GetSites() const { return sites; }
+    const RetainedRender& GetRender() const { return render; }
+
+private:
+    // 사이트 index 의 셀에 샘플이 하나라도 닿을 수 있는 픽셀 사각형.
+    RenderTile GetCellPixels(int index) const
+    {
+        double minX = 0.0, minY = 0.0, maxX = 0.0, maxY = 0.0;
+        if (!get_voronoi_cell_bounds(sites, index, patternSize, minX, minY, maxX, maxY)) {
+            return {{0, 0}, {0, 0}};
+        }
+        const vec2i& outputSize = render.GetSize();
+        const double scaleX = static_cast<double>(outputSize.x) / patternSize.x;
+        const double scaleY = static_cast<double>(outputSize.y) / patternSize.y;
+        RenderTile pixels;
+        pixels.min = {static_cast<int>(std::floor(minX * scaleX)) - 2, static_cast<int>(std::floor(minY * scaleY)) - 2};
+        pixels.max = {static_cast<int>(std::floor(maxX * scaleX)) + 2, static_cast<int>(std::floor(maxY * scaleY)) + 2};
+        return clip_render_tile(pixels, outputSize);
+    }
+
+    void Refresh(const RenderTile& dirty, RenderSampleStats* stats)
+    {
+        const VoronoiPattern pattern(render.GetSize(), render.GetAAType(), render.GetAALevel(), sites, lookup);
+        render.Update(pattern, dirty, stats);
+    }
+
+    RetainedRender render;
+    vec2i patternSize;
+    std::vector<vec2f> sites;
+    EVoronoiLookup lookup;
+};
@@ -1,52 +1,286 @@
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
 
 #include <vector>
 #include <string>
 
+#include "basicaa.h"
 #include "ppm.h"
+#include "aa_compare.h"
+#include "image_metrics.h"
+#include "mipmap.h"
 #include "pattern.h"
+#include "pattern_graph.h"
+#include "pattern_plugin.h"
+#include "progressive_render.h"
+#include "render_cache.h"
+#include "render_server.h"
+#include "sequence_render.h"
+#include "shard_render.h"
+#include "stream_render.h"
 
 int main(int argc, char* argv[]) {
-    if (argc > 1 && (std::string(argv[1]) == "help" || std::string(argv[1]) == "--help")) {
-        std::cout << "Usage: " << argv[0] << " [width] [height] [aa_type] [aa_level] [pattern_type] [output_file]" << std::endl;
+    // --옵션 은 먼저 걸러내고, 나머지는 위치 인자로 취급한다.
+    int ThreadCount = 0;
+    int VoronoiSiteCount = 100;
+    EVoronoiLookup VoronoiLookup = EVoronoiLookup::GRID;
+    ESimdLevel SimdLevel = ESimdLevel::AUTO;
+    bool UseSymmetry = true;
+    bool Streaming = false;
+    int BandRows = DEFAULT_STREAM_BAND_ROWS;
+    EColorEncoding Encoding = EColorEncoding::LINEAR;
+    float Gamma = 2.2f;
+    int BitDepth = 8;
+    bool PrintStats = false;
+    bool HardwareCounters = false;
+    std::string TraceFile;
+    std::string ServeSocket;
+    int ServerQueueSize = DEFAULT_SERVER_QUEUE_SIZE;
+    int ServerWorkers = DEFAULT_SERVER_WORKERS;
+    SequenceSettings Sequence;
+    bool SequenceMode = false;
+    std::string CacheDirectory;
+    int64_t CacheMegabytes = DEFAULT_RENDER_CACHE_MEGABYTES;
+    bool HasRoi = false;
+    int RoiRect[4] = {0, 0, 0, 0};
+    int ShardCount = 1;
+    int MipLevels = 1;
+    EMipFilter MipFilter = EMipFilter::BOX;
+    std::string GraphText;
+    std::string GraphFile;
+    std::string PluginPath;
+    std::string PluginParams;
+    std::string CompareText;
+    std::string ReferenceText;
+    double AutoAATargetPsnr = 0.0;
+    bool Progressive = false;
+    double BudgetMilliseconds = 0.0;
+    bool SavePasses = false;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            ThreadCount = std::atoi(argv[++i]);
+        } else if (arg == "--sites" && i + 1 < argc) {
+            VoronoiSiteCount = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--voronoi" && i + 1 < argc) {
+            const std::string lookupStr = argv[++i];
+            if (lookupStr == "brute") {
+                VoronoiLookup = EVoronoiLookup::BRUTE_FORCE;
+            } else if (lookupStr == "grid") {
+                VoronoiLookup = EVoronoiLookup::GRID;
+            }
+        } else if (arg == "--no-symmetry") {
+            UseSymmetry = false;
+        } else if (arg == "--simd" && i + 1 < argc) {
+            const std::string simdStr = argv[++i];
+            if (simdStr == "scalar") {
+                SimdLevel = ESimdLevel::SCALAR;
+            } else if (simdStr == "avx2") {
+                SimdLevel = ESimdLevel::AVX2;
+            } else if (simdStr == "avx512") {
+                SimdLevel = ESimdLevel::AVX512;
+            } else {
+                SimdLevel = ESimdLevel::AUTO;
+            }
+        } else if (arg == "--stream") {
+            Streaming = true;
+        } else if (arg == "--band-rows" && i + 1 < argc) {
+            BandRows = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--encoding" && i + 1 < argc) {
+            const std::string encodingStr = argv[++i];
+            if (encodingStr == "linear") {
+                Encoding = EColorEncoding::LINEAR;
+            } else if (encodingStr == "srgb") {
+                Encoding = EColorEncoding::SRGB;
+            } else if (encodingStr == "gamma") {
+                Encoding = EColorEncoding::GAMMA;
+            }
+        } else if (arg == "--gamma" && i + 1 < argc) {
+            Gamma = static_cast<float>(std::atof(argv[++i]));
+            if (Gamma <= 0.0f) Gamma = 2.2f;
+        } else if (arg == "--bit-depth" && i + 1 < argc) {
+            BitDepth = (std::atoi(argv[++i]) == 16) ? 16 : 8;
+        } else if (arg == "--stats") {
+            PrintStats = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            TraceFile = argv[++i];
+        } else if (arg == "--perf-counters") {
+            HardwareCounters = true;
+        } else if (arg == "--serve" && i + 1 < argc) {
+            ServeSocket = argv[++i];
+        } else if (arg == "--queue" && i + 1 < argc) {
+            ServerQueueSize = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--server-workers" && i + 1 < argc) {
+            ServerWorkers = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--roi" && i + 1 < argc) {
+            HasRoi = std::sscanf(argv[++i], "%d,%d,%d,%d", &RoiRect[0], &RoiRect[1], &RoiRect[2], &RoiRect[3]) == 4;
+        } else if (arg == "--shards" && i + 1 < argc) {
+            ShardCount = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--compare" && i + 1 < argc) {
+            CompareText = argv[++i];
+        } else if (arg == "--reference" && i + 1 < argc) {
+            ReferenceText = argv[++i];
+        } else if (arg == "--auto-aa" && i + 1 < argc) {
+            AutoAATargetPsnr = std::max(std::atof(argv[++i]), 0.0);
+        } else if (arg == "--progressive") {
+            Progressive = true;
+        } else if (arg == "--budget-ms" && i + 1 < argc) {
+            BudgetMilliseconds = std::max(std::atof(argv[++i]), 0.0);
+            Progressive = true;
+        } else if (arg == "--save-passes") {
+            SavePasses = true;
+        } else if (arg == "--layers" && i + 1 < argc) {
+            GraphText = argv[++i];
+        } else if (arg == "--graph" && i + 1 < argc) {
+            GraphFile = argv[++i];
+        } else if (arg == "--plugin" && i + 1 < argc) {
+            PluginPath = argv[++i];
+        } else if (arg == "--plugin-params" && i + 1 < argc) {
+            PluginParams = argv[++i];
+        } else if (arg == "--mip-levels" && i + 1 < argc) {
+            MipLevels = std::max(std::atoi(argv[++i]), 0);
+        } else if (arg == "--mip-filter" && i + 1 < argc) {
+            const std::string filterStr = argv[++i];
+            if (filterStr == "box") {
+                MipFilter = EMipFilter::BOX;
+            } else if (filterStr == "lanczos") {
+                MipFilter = EMipFilter::LANCZOS3;
+            }
+        } else if (arg == "--cache" && i + 1 < argc) {
+            CacheDirectory = argv[++i];
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            CacheMegabytes = std::max(std::atoll(argv[++i]), 0ll);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            Sequence.frameCount = std::max(std::atoi(argv[++i]), 1);
+            SequenceMode = true;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            Sequence.framesPerSecond = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--sequence-format" && i + 1 < argc) {
+            const std::string formatStr = argv[++i];
+            if (formatStr == "ppm") {
+                Sequence.format = ESequenceFormat::PPM;
+            } else if (formatStr == "raw") {
+                Sequence.format = ESequenceFormat::RAW;
+            } else if (formatStr == "y4m") {
+                Sequence.format = ESequenceFormat::Y4M;
+            }
+        } else if (arg == "--angle" && i + 1 < argc) {
+            Sequence.checkerboardAngle = parse_param_range(argv[++i]);
+        } else if (arg == "--tile-size" && i + 1 < argc) {
+            Sequence.checkerboardTileSize = static_cast<float>(std::atof(argv[++i]));
+        } else if (arg == "--thickness" && i + 1 < argc) {
+            Sequence.circleThickness = parse_param_range(argv[++i]);
+        } else if (arg == "--gap" && i + 1 < argc) {
+            Sequence.circleGap = parse_param_range(argv[++i]);
+        } else if (arg == "--drift" && i + 1 < argc) {
+            Sequence.voronoiDrift = static_cast<float>(std::atof(argv[++i]));
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() > 0 && (args[0] == "help" || args[0] == "--help")) {
+        std::cout << "Usage: " << argv[0] << " [width] [height] [aa_type] [aa_level] [pattern_type] [output_file] [--threads N] [--sites N] [--voronoi brute|grid] [--simd auto|scalar|avx2|avx512] [--no-symmetry] [--stream] [--band-rows N] [--encoding linear|srgb|gamma] [--gamma G] [--bit-depth 8|16] [--stats] [--trace file.json] [--perf-counters] [--serve socket] [--queue N] [--server-workers N] [--frames N] [--fps N] [--sequence-format ppm|raw|y4m] [--angle A[:B]] [--tile-size S] [--thickness T[:T2]] [--gap G[:G2]] [--drift D] [--cache dir] [--cache-size MB] [--roi x,y,w,h] [--shards K] [--mip-levels N] [--mip-filter box|lanczos] [--layers \"layer; layer...\"] [--graph file] [--plugin file|builtin:name] [--plugin-params \"key=value ...\"] [--compare none,fxaa,msaa2,ssaa4,...] [--reference file.ppm|ssaaN] [--auto-aa PSNR] [--progressive] [--budget-ms MS] [--save-passes]" << std::endl;
         std::cout << "Options:" << std::endl;
         std::cout << "  width:        Output image width (default: 1920)" << std::endl;
         std::cout << "  height:       Output image height (default: 1080)" << std::endl;
-        std::cout << "  aa_type:      ssaa, msaa, fxaa (default: msaa)" << std::endl;
-        std::cout << "  aa_level:     1-8 (default: 2)" << std::endl;
+        std::cout << "  aa_type:      none, ssaa, msaa, fxaa, analytic, adaptive (default: msaa)" << std::endl;
+        std::cout << "  aa_level:     1-16 (default: 2)" << std::endl;
         std::cout << "  pattern_type: uv, checkerboard, circle, voronoi (default: voronoi)" << std::endl;
-        std::cout << "  output_file:  Optional output file name" << std::endl;
+        std::cout << "  output_file:  Optional output file name (\"-\" writes a --frames sequence to stdout)" << std::endl;
+        std::cout << "  --threads N:  Worker thread count (default: 0 = all hardware threads)" << std::endl;
+        std::cout << "  --sites N:    Voronoi site count (default: 100)" << std::endl;
+        std::cout << "  --voronoi:    Voronoi nearest-site lookup: brute, grid (default: grid)" << std::endl;
+        std::cout << "  --simd:       Pattern kernel instruction set: auto, scalar, avx2, avx512 (default: auto)" << std::endl;
+        std::cout << "  --no-symmetry: Evaluate every pixel of mirror-symmetric or periodic patterns instead of copying equal ones" << std::endl;
+        std::cout << "  --stream:     Render, quantize and write the image band by band with bounded memory" << std::endl;
+        std::cout << "  --band-rows:  Rows per band in --stream mode (default: " << DEFAULT_STREAM_BAND_ROWS << ")" << std::endl;
+        std::cout << "  --encoding:   Output transfer function: linear, srgb, gamma (default: linear)" << std::endl;
+        std::cout << "  --gamma G:    Exponent for --encoding gamma (default: 2.2)" << std::endl;
+        std::cout << "  --bit-depth:  Output bits per channel: 8 or 16 (default: 8)" << std::endl;
+        std::cout << "  --stats:      Print per-stage timings and counters after rendering" << std::endl;
+        std::cout << "  --trace F:    Write a Chrome trace-event timeline of stages and tiles to F" << std::endl;
+        std::cout << "  --perf-counters: Add hardware counters (perf_event_open) to --stats" << std::endl;
+        std::cout << "  --serve S:    Run as a render server on Unix socket S instead of rendering one image" << std::endl;
+        std::cout << "  --queue N:    Connections waiting in --serve mode before new ones are refused (default: " << DEFAULT_SERVER_QUEUE_SIZE << ")" << std::endl;
+        std::cout << "  --server-workers N: Connections served at once in --serve mode (default: " << DEFAULT_SERVER_WORKERS << ")" << std::endl;
+        std::cout << "  --frames N:   Render N frames into one stream, interpolating ranged parameters from the first to the last frame" << std::endl;
+        std::cout << "  --fps N:      Frame rate written to the y4m header (default: 30)" << std::endl;
+        std::cout << "  --sequence-format: Frame stream format: ppm (concatenated P6), raw (RGB), y4m (YUV 4:4:4, 8-bit) (default: ppm)" << std::endl;
+        std::cout << "  --angle A[:B]: Checkerboard rotation in degrees (default: 40)" << std::endl;
+        std::cout << "  --tile-size S: Checkerboard tile size in pixels (default: 50)" << std::endl;
+        std::cout << "  --thickness T[:T2]: Circle ring thickness in pixels (default: 12)" << std::endl;
+        std::cout << "  --gap G[:G2]: Gap between circle rings in pixels (default: 7)" << std::endl;
+        std::cout << "  --drift D:    Voronoi site movement per frame in pixels (default: 0)" << std::endl;
+        std::cout << "  --cache DIR:  Reuse finished images stored in DIR for identical render parameters" << std::endl;
+        std::cout << "  --cache-size MB: Size limit of the --cache directory; least recently used images are removed (default: " << DEFAULT_RENDER_CACHE_MEGABYTES << ")" << std::endl;
+        std::cout << "  --roi x,y,w,h: Render only this rectangle of the image, identical to the same pixels of a full render" << std::endl;
+        std::cout << "  --shards K:   Split the image into K bands rendered by K worker processes and merge them (default: 1)" << std::endl;
+        std::cout << "  --mip-levels N: Also write N-1 half-size levels (<name>_mip<k>.ppm) from the same render; 0 goes down to 1x1 (default: 1)" << std::endl;
+        std::cout << "  --mip-filter: Downsampling filter for --mip-levels: box, lanczos (default: box)" << std::endl;
+        std::cout << "  --layers L:   Render a composite of layers instead of pattern_type, e.g. \"voronoi; circle hidden=1; solid color=0,0,0 mask=1\"" << std::endl;
+        std::cout << "  --graph F:    Read the --layers description from file F (one layer per line, # comments)" << std::endl;
+        std::cout << "  --plugin P:   Render the pattern of plugin library P (or builtin:uv|checkerboard|circle|voronoi) instead of pattern_type" << std::endl;
+        std::cout << "  --plugin-params S: Parameter string passed to the --plugin pattern" << std::endl;
+        std::cout << "  --compare L:  Render every listed AA setting (none, fxaa, analytic, msaaN, ssaaN, adaptiveN) in one pass, one file each; MSAA 1-8 share one sample set" << std::endl;
+        std::cout << "  --reference R: Print PSNR, SSIM and max/mean error of the output against file R or an SSAA render ssaaN" << std::endl;
+        std::cout << "  --auto-aa P:  Render candidate AA settings and report the fastest one reaching P dB PSNR against --reference (default: ssaa" << DEFAULT_REFERENCE_SSAA_LEVEL << ")" << std::endl;
+        std::cout << "  --progressive: Render a coarse pass, then one sample per pixel, then the AA samples in growing passes; the last pass equals a normal render" << std::endl;
+        std::cout << "  --budget-ms MS: Progressive render that writes the best image reached within MS milliseconds" << std::endl;
+        std::cout << "  --save-passes: Also write every progressive pass to <name>_pass<k>.ppm" << std::endl;
         return 0;
     }
+
+    SetSimdLevel(SimdLevel);
+    SetPatternSymmetryEnabled(UseSymmetry);
+    // 꺼져 있으면 단계와 타일마다 bool 하나만 검사한다.
+    if (PrintStats || !TraceFile.empty()) {
+        GetProfiler().Enable(HardwareCounters);
+    }
+
+    if (!ServeSocket.empty()) {
+        SetThreadCount(ThreadCount);
+        return run_render_server(ServeSocket, ServerQueueSize, ServerWorkers) ? 0 : 1;
+    }
     
     vec2i OutputSize = {1920, 1080};
-    if (argc > 2) {
-        OutputSize.x = std::atoi(argv[1]);
-        OutputSize.y = std::atoi(argv[2]);
+    if (args.size() > 1) {
+        OutputSize.x = std::atoi(args[0].c_str());
+        OutputSize.y = std::atoi(args[1].c_str());
     }
 
     EAAType AAType = EAAType::MSAA;
-    if (argc > 3) {
-        std::string AATypeStr = argv[3];
-        if (AATypeStr == "ssaa") {
+    if (args.size() > 2) {
+        std::string AATypeStr = args[2];
+        if (AATypeStr == "none") {
+            AAType = EAAType::NONE;
+        } else if (AATypeStr == "ssaa") {
             AAType = EAAType::SSAA;
         } else if (AATypeStr == "msaa") {
             AAType = EAAType::MSAA;
         } else if (AATypeStr == "fxaa") {
             AAType = EAAType::FXAA;
+        } else if (AATypeStr == "analytic") {
+            AAType = EAAType::ANALYTIC;
+        } else if (AATypeStr == "adaptive") {
+            AAType = EAAType::ADAPTIVE;
         }
     }
 
     int AALevel = 2;
-    if (argc > 4) {
-        AALevel = std::atoi(argv[4]);
+    if (args.size() > 3) {
+        AALevel = std::atoi(args[3].c_str());
         if (AALevel < 1) AALevel = 1;
-        if (AALevel > 8) AALevel = 8;
+        if (AALevel > MAX_AA_LEVEL) AALevel = MAX_AA_LEVEL;
     }
 
     EPatternType patternType = EPatternType::VORONOI;
-    if (argc > 5) {
-        std::string patternTypeStr = argv[5];
+    if (args.size() > 4) {
+        std::string patternTypeStr = args[4];
         if (patternTypeStr == "uv") {
             patternType = EPatternType::UV;
         } else if (patternTypeStr == "checkerboard") {
@@ -62,52 +296,493 @@ int main(int argc, char* argv[]) {
     FileName += "_" + std::to_string(OutputSize.x) + "x" + std::to_string(OutputSize.y);
     
     switch (AAType) {
+        case EAAType::NONE: FileName += "_NONE"; break;
         case EAAType::SSAA: FileName += "_SSAA"; break;
         case EAAType::MSAA: FileName += "_MSAA"; break;
         case EAAType::FXAA: FileName += "_FXAA"; break;
+        case EAAType::ANALYTIC: FileName += "_ANALYTIC"; break;
+        case EAAType::ADAPTIVE: FileName += "_ADAPTIVE"; break;
         default: break;
     }
 
     FileName += "_" + std::to_string(AALevel);
-    FileName += ".ppm";
+    if (SequenceMode) {
+        FileName += "_" + std::to_string(Sequence.frameCount) + "f";
+        switch (Sequence.format) {
+            case ESequenceFormat::PPM: FileName += ".ppm"; break;
+            case ESequenceFormat::RAW: FileName += ".rgb"; break;
+            case ESequenceFormat::Y4M: FileName += ".y4m"; break;
+        }
+    } else {
+        FileName += ".ppm";
+    }
 
     std::string outputFile = FileName;
-    if (argc > 6) {
-        outputFile = argv[6];
+    if (args.size() > 5) {
+        outputFile = args[5];
+    }
+
+    // 출력 파일에 담을 영역. 좌표는 전체 이미지 기준이다.
+    RenderTile Roi = {{0, 0}, OutputSize};
+    if (HasRoi) {
+        Roi.min = {clamp(RoiRect[0], 0, OutputSize.x), clamp(RoiRect[1], 0, OutputSize.y)};
+        Roi.max = {clamp(RoiRect[0] + RoiRect[2], Roi.min.x, OutputSize.x), clamp(RoiRect[1] + RoiRect[3], Roi.min.y, OutputSize.y)};
+        if (Roi.max.x == Roi.min.x || Roi.max.y == Roi.min.y) {
+            std::cerr << "--roi does not overlap the image" << std::endl;
+            return 1;
+        }
     }
 
 
-    std::vector<vec3f> pixels;
+    // 합성 레이어가 주어지면 pattern_type 대신 합성 패턴을 그린다.
+    PatternGraphDesc Graph;
+    const bool GraphMode = !GraphText.empty() || !GraphFile.empty();
+    if (GraphMode) {
+        std::string error;
+        const bool parsed = GraphFile.empty() ? parse_pattern_graph(GraphText, Graph, error) : load_pattern_graph(GraphFile.c_str(), Graph, error);
+        if (!parsed) {
+            std::cerr << "Invalid pattern graph: " << error << std::endl;
+            return 1;
+        }
+        if (SequenceMode) {
+            std::cerr << "--frames does not support --layers/--graph" << std::endl;
+            return 1;
+        }
+    }
+
+    const char* VoronoiLookupName = (VoronoiLookup == EVoronoiLookup::BRUTE_FORCE) ? "brute" : "grid";
+
+    // 플러그인이 주어지면 pattern_type 대신 플러그인 패턴을 그린다.
+    // 내장 패턴은 명령줄의 패턴 옵션을 기본값으로 넘기고, --plugin-params 가 그 뒤에서 덮어쓴다.
+    PatternPluginLibrary PluginLibrary;
+    const bool PluginMode = !PluginPath.empty();
+    if (PluginMode) {
+        if (GraphMode || SequenceMode) {
+            std::cerr << "--plugin does not support --layers/--graph or --frames" << std::endl;
+            return 1;
+        }
+        std::string error;
+        if (!PluginLibrary.Open(PluginPath, error)) {
+            std::cerr << "Failed to load plugin: " << error << std::endl;
+            return 1;
+        }
+        if (PluginPath.rfind(BUILTIN_PATTERN_PLUGIN_PREFIX, 0) == 0) {
+            std::ostringstream defaults;
+            defaults.precision(9);
+            defaults << "angle=" << Sequence.checkerboardAngle.start << " tile=" << Sequence.checkerboardTileSize
+                     << " thickness=" << Sequence.circleThickness.start << " gap=" << Sequence.circleGap.start << " sites=" << VoronoiSiteCount
+                     << " voronoi=" << VoronoiLookupName;
+            PluginParams = defaults.str() + " " + PluginParams;
+        }
+        if (!PluginPattern(*PluginLibrary.GetPlugin(), OutputSize, AAType, AALevel, PluginParams).IsValid()) {
+            std::cerr << "Plugin " << PluginLibrary.GetPlugin()->name << " rejected parameters \"" << PluginParams << "\"" << std::endl;
+            return 1;
+        }
+    }
+
+    // 여러 AA 설정을 한 번에 렌더한다. 파일 이름은 설정마다 붙는다.
+    std::vector<AAVariant> CompareVariants;
+    const bool AutoAAMode = AutoAATargetPsnr > 0.0 && !SequenceMode;
+    const bool CompareMode = !CompareText.empty() && !SequenceMode && !AutoAAMode;
+    if (CompareMode) {
+        std::string error;
+        if (!parse_aa_variants(CompareText, CompareVariants, error)) {
+            std::cerr << "Invalid --compare: " << error << std::endl;
+            return 1;
+        }
+        if (HasRoi || Streaming || ShardCount > 1 || MipLevels != 1) {
+            std::cerr << "--compare renders whole images in one process; ignoring --roi, --stream, --shards and --mip-levels" << std::endl;
+            Roi = {{0, 0}, OutputSize};
+            ShardCount = 1;
+        }
+    }
+    if (AutoAAMode && ShardCount > 1) {
+        ShardCount = 1;
+    }
+    // 점진 렌더는 이미지 하나를 단계마다 다듬는다. 결과가 시간에 따라 달라지므로 캐시하지 않는다.
+    const bool ProgressiveMode = Progressive;
+    if (ProgressiveMode) {
+        if (SequenceMode || CompareMode || AutoAAMode) {
+            std::cerr << "--progressive/--budget-ms does not support --frames, --compare or --auto-aa" << std::endl;
+            return 1;
+        }
+        if (Streaming || ShardCount > 1 || MipLevels != 1) {
+            std::cerr << "--progressive renders one image in memory; ignoring --stream, --shards and --mip-levels" << std::endl;
+            ShardCount = 1;
+        }
+    }
+    // 기준 이미지: "ssaaN" 이면 같은 영역을 SSAA N 으로 렌더하고, 아니면 파일을 읽는다.
+    const int ReferenceSSAALevel = ReferenceText.empty() ? DEFAULT_REFERENCE_SSAA_LEVEL : parse_reference_ssaa_level(ReferenceText);
+    const bool UseReference = !ReferenceText.empty() || AutoAAMode;
+    if (UseReference && SequenceMode) {
+        std::cerr << "--frames does not support --reference/--auto-aa" << std::endl;
+        return 1;
+    }
+    const std::string CompareBaseFile = (args.size() > 5) ? outputFile : "output_" + std::to_string(OutputSize.x) + "x" + std::to_string(OutputSize.y) + ".ppm";
+
+    const float CheckerboardAngle = Sequence.checkerboardAngle.start;
+    const vec2f CheckerboardPivot = {0.5f, 0.5f};
+    const float CheckerboardTileSize = Sequence.checkerboardTileSize;
+    const float CircleThickness = Sequence.circleThickness.start;
+    const float CircleGap = Sequence.circleGap.start;
+    Sequence.voronoiSiteCount = VoronoiSiteCount;
+    Sequence.voronoiLookup = VoronoiLookup;
+
+#if !defined(BASICAA_SHARED)
+    // 라이브러리(basicaa.h)에 넘기는 패턴 설명. --layers 형식이며 float 는 되읽어도 같은 값이 되도록 9자리로 쓴다.
+    std::string LibraryPatternText = GraphText;
+    if (GraphMode && !GraphFile.empty()) {
+        std::ifstream graphIn(GraphFile);
+        std::ostringstream graphText;
+        graphText << graphIn.rdbuf();
+        LibraryPatternText = graphText.str();
+    } else if (!GraphMode) {
+        std::ostringstream patternText;
+        patternText.precision(9);
+        switch (patternType) {
+            case EPatternType::UV: patternText << "uv"; break;
+            case EPatternType::CHECKERBOARD: patternText << "checkerboard angle=" << CheckerboardAngle << " tile=" << CheckerboardTileSize; break;
+            case EPatternType::CIRCLE: patternText << "circle thickness=" << CircleThickness << " gap=" << CircleGap; break;
+            case EPatternType::VORONOI: patternText << "voronoi sites=" << VoronoiSiteCount << " voronoi=" << VoronoiLookupName; break;
+        }
+        LibraryPatternText = patternText.str();
+    }
+#endif
+
+    if (SequenceMode && Sequence.format == ESequenceFormat::Y4M && BitDepth != 8) {
+        std::cerr << "y4m output is 8-bit; ignoring --bit-depth " << BitDepth << std::endl;
+        BitDepth = 8;
+    }
+
+    const PixelEncoder Encoder(BitDepth == 16 ? EPixelFormat::RGB16 : EPixelFormat::RGB8, Encoding, Gamma);
+    RenderSampleStats SampleStats;
+    // 스트림을 표준 출력으로 보낼 때는 다른 출력이 섞이지 않도록 표준 에러로 보낸다.
+    std::ostream& Info = (outputFile == "-") ? std::cerr : std::cout;
+
+    // 밉맵은 파일 여러 개를 쓰므로 캐시와 샤드를 쓰지 않는다.
+    const bool MipMode = MipLevels != 1 && !SequenceMode && !CompareMode && !ProgressiveMode;
+    if (MipMode && ShardCount > 1) {
+        std::cerr << "--mip-levels renders in one process; ignoring --shards " << ShardCount << std::endl;
+        ShardCount = 1;
+    }
+
+    // fn 에 makePattern(AAType, AALevel) 을 넘긴다. makePattern 은 그 설정의 단일 렌더와 같은 패턴을 std::unique_ptr 로 만든다.
+    auto withPatternFactory = [&](const auto& fn) {
+        if (PluginMode) {
+            return fn([&](EAAType type, int level) { return std::make_unique<PluginPattern>(*PluginLibrary.GetPlugin(), OutputSize, type, level, PluginParams); });
+        }
+        if (GraphMode) {
+            return fn([&](EAAType type, int level) { return std::make_unique<CompositePattern>(OutputSize, type, level, Graph); });
+        }
+        switch (patternType) {
+            case EPatternType::UV:
+                return fn([&](EAAType, int) { return std::make_unique<UVPattern>(OutputSize); });
+            case EPatternType::CHECKERBOARD:
+                return fn([&](EAAType type, int level) { return std::make_unique<CheckerboardPattern>(OutputSize, type, level, CheckerboardAngle, CheckerboardPivot, CheckerboardTileSize); });
+            case EPatternType::CIRCLE:
+                return fn([&](EAAType type, int level) { return std::make_unique<CirclePattern>(OutputSize, type, level, CircleThickness, CircleGap); });
+            default:
+                break;
+        }
+        return fn([&](EAAType type, int level) { return std::make_unique<VoronoiPattern>(OutputSize, type, level, VoronoiSiteCount, VoronoiLookup); });
+    };
+
+    EncodedImage ReferenceImage;
+    auto loadReference = [&]() -> bool {
+        if (ReferenceSSAALevel == 0) {
+            return load_ppm_image(ReferenceText.c_str(), ReferenceImage);
+        }
+        ReferenceImage = withPatternFactory([&](const auto& makePattern) {
+            return render_encoded_image(OutputSize, EAAType::SSAA, ReferenceSSAALevel, *makePattern(EAAType::SSAA, ReferenceSSAALevel), Roi, Encoder);
+        });
+        return true;
+    };
+
+    // makePattern(AAType, AALevel) 로 설정마다 패턴을 만들어 비교 파일들을 쓴다.
+    RenderSampleStats CompareSeparateStats;
+    auto renderComparison = [&](const auto& makePattern) -> bool {
+        using Pattern = typename decltype(makePattern(EAAType::NONE, 1))::element_type;
+        ProfileStage profileStage("total");
+        return render_aa_comparison<Pattern>(CompareBaseFile, OutputSize, CompareVariants, makePattern, Encoder, &SampleStats, &CompareSeparateStats);
+    };
+
+    // 단계마다 걸린 시간을 알리고, --save-passes 면 단계 이미지도 쓴다. 출력 파일에는 마지막으로 마친 단계를 쓴다.
+    auto renderProgressive = [&](const auto& pattern) -> bool {
+        const vec2i roiSize = Roi.max - Roi.min;
+        std::vector<unsigned char> data(static_cast<size_t>(roiSize.x) * roiSize.y * Encoder.GetBytesPerPixel());
+        bool passesWritten = true;
+        std::vector<vec3f> image;
+        const bool complete = render_pattern_progressive(OutputSize, AAType, AALevel, pattern, Roi, BudgetMilliseconds, image, [&](const ProgressiveFrame& frame, const std::vector<vec3f>& pixels) {
+            Info << "Pass " << frame.pass << " (" << get_progressive_pass_name(frame.type) << ", " << frame.samplesPerPixel << " samples/pixel";
+            if (frame.refinedFraction < 1.0) {
+                Info << ", " << (100.0 * frame.refinedFraction) << "% of tiles";
+            }
+            Info << "): " << frame.milliseconds << " ms" << (frame.final ? ", final" : "") << std::endl;
+            if (SavePasses) {
+                quantize_pixels(pixels.data(), pixels.size(), Encoder, data.data());
+                const std::string passFile = insert_filename_suffix(outputFile, "_pass" + std::to_string(frame.pass));
+                passesWritten = ExportPPM(passFile.c_str(), EPPMFormat::P3_BINARY, roiSize.x, roiSize.y, data.data(), Encoder.GetMaxValue()) && passesWritten;
+            }
+        }, &SampleStats);
+        if (!complete) {
+            Info << "Budget of " << BudgetMilliseconds << " ms reached before the final pass" << std::endl;
+        }
+        quantize_pixels(image.data(), image.size(), Encoder, data.data());
+        return ExportPPM(outputFile.c_str(), EPPMFormat::P3_BINARY, roiSize.x, roiSize.y, data.data(), Encoder.GetMaxValue()) && passesWritten;
+    };
+
+    // 패턴 펑터 하나를 받아 출력 파일까지 만든다.
+    auto renderToFile = [&](const auto& pattern) -> bool {
+        ProfileStage profileStage("total");
+        if (ProgressiveMode) {
+            return renderProgressive(pattern);
+        }
+        if (MipMode) {
+            // 기본 레벨을 밴드로 렌더하면서 작은 레벨들을 함께 만든다.
+            return render_pattern_mipmaps(outputFile, OutputSize, AAType, AALevel, pattern, Roi, Encoder, MipFilter, MipLevels, BandRows, &SampleStats);
+        }
+        if (Streaming) {
+            // 전체 이미지를 메모리에 올리지 않고 밴드 단위로 렌더하면서 바로 파일에 쓴다.
+            return render_pattern_to_ppm(outputFile.c_str(), EPPMFormat::P3_BINARY, OutputSize, AAType, AALevel, pattern, Roi, Encoder, BandRows, &SampleStats);
+        }
+
+        std::vector<unsigned char> data;
+        if (AAType == EAAType::FXAA) {
+            // FXAA 는 float 이미지에서 휘도를 보므로 float 로 렌더한 뒤, FXAA 결과를 바로 정수 픽셀로 쓴다.
+            data = render_pattern_fxaa_encoded(OutputSize, pattern, Roi, Encoder, &SampleStats);
+        } else {
+            // 샘플 누적 결과를 float 이미지 없이 바로 정수 픽셀로 만든다.
+            data = render_pattern_encoded(OutputSize, AAType, AALevel, pattern, Roi, Encoder, &SampleStats);
+        }
+        const vec2i roiSize = Roi.max - Roi.min;
+        const bool exported = ExportPPM(outputFile.c_str(), EPPMFormat::P3_BINARY, roiSize.x, roiSize.y, data.data(), Encoder.GetMaxValue());
+        profile_release_buffer(static_cast<int64_t>(data.size()));
+        return exported;
+    };
+
+#if !defined(BASICAA_SHARED)
+    // 한 장짜리 기본 렌더는 라이브러리로 출력 버퍼에 바로 렌더한다. 결과는 renderToFile 과 같다.
+    // 정적 링크에서만 쓴다. 이때는 스레드 풀, SIMD, 대칭 설정을 실행 파일과 라이브러리가 함께 쓴다.
+    // 공유 라이브러리는 설정과 스레드 풀을 따로 가지므로, 그 빌드에서는 헤더로 바로 렌더해 풀을 하나만 만든다.
+    auto renderWithLibrary = [&]() -> bool {
+        ProfileStage profileStage("total");
+        std::unique_ptr<BasicAARenderer, decltype(&basicaa_destroy_renderer)> renderer(basicaa_create_renderer(), basicaa_destroy_renderer);
+        BasicAARenderDesc desc;
+        basicaa_default_render_desc(&desc);
+        desc.width = OutputSize.x;
+        desc.height = OutputSize.y;
+        desc.aaType = static_cast<int>(AAType);
+        desc.aaLevel = AALevel;
+        desc.pattern = LibraryPatternText.c_str();
+        desc.roiX = Roi.min.x;
+        desc.roiY = Roi.min.y;
+        desc.roiWidth = Roi.max.x - Roi.min.x;
+        desc.roiHeight = Roi.max.y - Roi.min.y;
+        desc.encoding = static_cast<int>(Encoding);
+        desc.gamma = Gamma;
+
+        std::vector<unsigned char> data(static_cast<size_t>(desc.roiWidth) * desc.roiHeight * Encoder.GetBytesPerPixel());
+        profile_track_buffer(static_cast<int64_t>(data.size()));
+        const BasicAAImage image = {data.data(), static_cast<size_t>(desc.roiWidth) * Encoder.GetBytesPerPixel(), BitDepth == 16 ? BASICAA_FORMAT_RGB16 : BASICAA_FORMAT_RGB8};
+        BasicAARenderStats stats = {};
+        const int status = renderer ? basicaa_render(renderer.get(), &desc, &image, &stats) : BASICAA_ERROR_OUT_OF_MEMORY;
+        if (status != BASICAA_OK) {
+            std::cerr << "Render failed: " << basicaa_status_string(status) << std::endl;
+            profile_release_buffer(static_cast<int64_t>(data.size()));
+            return false;
+        }
+        SampleStats.pixelCount += stats.pixelCount;
+        SampleStats.sampleCount += stats.sampleCount;
+        SampleStats.refinedPixelCount += stats.refinedPixelCount;
+
+        const bool exported = ExportPPM(outputFile.c_str(), EPPMFormat::P3_BINARY, desc.roiWidth, desc.roiHeight, data.data(), Encoder.GetMaxValue());
+        profile_release_buffer(static_cast<int64_t>(data.size()));
+        return exported;
+    };
+#endif
+
+    // 같은 이미지를 만드는 파라미터만 키에 넣는다. 프레임 시퀀스, 밉맵, AA 비교는 캐시하지 않는다.
+    // 플러그인은 라이브러리가 바뀌어도 키로 알 수 없으므로 캐시하지 않는다.
+    const bool UseCache = !CacheDirectory.empty() && !SequenceMode && !MipMode && !CompareMode && !AutoAAMode && !PluginMode && !ProgressiveMode;
+    const RenderCache Cache(CacheDirectory, CacheMegabytes * 1024 * 1024);
+    RenderCacheKey CacheKey;
+    CacheKey.Add("width", OutputSize.x).Add("height", OutputSize.y).Add("aa", static_cast<int>(AAType)).Add("level", AALevel).Add("pattern", static_cast<int>(patternType));
+    CacheKey.Add("roi", std::to_string(Roi.min.x) + "," + std::to_string(Roi.min.y) + "," + std::to_string(Roi.max.x) + "," + std::to_string(Roi.max.y));
+    CacheKey.Add("encoding", static_cast<int>(Encoding)).Add("gamma", Encoding == EColorEncoding::GAMMA ? Gamma : 0.0f).Add("bits", BitDepth);
     switch (patternType) {
-        case EPatternType::UV:
-            pixels = generate_uv_pattern_data(OutputSize, AAType, AALevel);
-            break;
-        case EPatternType::CHECKERBOARD:
-            pixels = generate_checkerboard_pattern_data(OutputSize, AAType, AALevel, 40.0f, {0.5f, 0.5f}, 50.f);
-            break;
-        case EPatternType::CIRCLE:
-            pixels = generate_circle_pattern_data(OutputSize, AAType, AALevel, 12.f, 7.f);
-            break;
-        case EPatternType::VORONOI:
-            pixels = generate_voronoi_pattern_data(OutputSize, AAType, AALevel, 100);
-            break;
+        case EPatternType::CHECKERBOARD: CacheKey.Add("angle", CheckerboardAngle).Add("tile", CheckerboardTileSize); break;
+        case EPatternType::CIRCLE: CacheKey.Add("thickness", CircleThickness).Add("gap", CircleGap); break;
+        case EPatternType::VORONOI: CacheKey.Add("sites", VoronoiSiteCount).Add("lookup", static_cast<int>(VoronoiLookup)).Add("seed", 1); break;
+        default: break;
+    }
+    if (GraphMode) {
+        // 같은 설명을 다르게 적어도 레이어 값이 같으면 같은 키가 되도록 읽은 값을 넣는다.
+        for (const PatternLayerDesc& layer : Graph.layers) {
+            CacheKey.Add("layer", static_cast<int>(layer.source)).Add("angle", layer.checkerboardAngle).Add("tile", layer.checkerboardTileSize);
+            CacheKey.Add("thickness", layer.circleThickness).Add("gap", layer.circleGap).Add("sites", layer.voronoiSiteCount).Add("lookup", static_cast<int>(layer.voronoiLookup));
+            CacheKey.Add("color", layer.color.x).Add("color", layer.color.y).Add("color", layer.color.z).Add("blend", static_cast<int>(layer.blend)).Add("opacity", layer.opacity);
+            CacheKey.Add("mask", layer.mask).Add("invert", layer.invertMask ? 1 : 0).Add("hidden", layer.hidden ? 1 : 0);
+            CacheKey.Add("offset", layer.offset.x).Add("offset", layer.offset.y).Add("scale", layer.scale).Add("rotate", layer.rotation);
+        }
+    }
+
+    const bool CacheHit = UseCache && Cache.Fetch(CacheKey, outputFile);
+
+    // 밴드를 나눠 자식 프로세스에 맡긴다. fork 는 스레드 풀을 만들기 전에 해야 한다.
+    bool Sharded = false;
+    bool ShardChild = false;
+    RenderShard Shard;
+    if (!CacheHit && !SequenceMode && ShardCount > 1) {
+        ShardReport shardTotal;
+        switch (fork_render_shards(Roi, ShardCount, outputFile, Shard, shardTotal)) {
+            case EShardRole::CHILD:
+                Roi = Shard.roi;
+                outputFile = Shard.partFile;
+                ShardChild = true;
+                if (ThreadCount <= 0) {
+                    ThreadCount = std::max(static_cast<int>(std::thread::hardware_concurrency()) / ShardCount, 1);
+                }
+                break;
+            case EShardRole::MERGED:
+                // 자식들이 센 값을 이 프로세스가 렌더한 것처럼 보고한다.
+                Sharded = true;
+                SampleStats += shardTotal.samples;
+                for (int i = 0; i < PROFILE_COUNTER_COUNT; ++i) {
+                    profile_add_counter(static_cast<EProfileCounter>(i), shardTotal.counters[i]);
+                }
+                break;
+            case EShardRole::FAILED:
+                std::cerr << "Failed to render " << outputFile << " in " << ShardCount << " shards" << std::endl;
+                return 1;
+        }
     }
+    SetThreadCount(ThreadCount);
 
-    if (AAType == EAAType::FXAA) {
-        // Apply FXAA
-        pixels = apply_fxaa(OutputSize, pixels);
+    if (AutoAAMode) {
+        // 후보를 하나씩 렌더해 비교만 하고 파일은 쓰지 않는다.
+        if (!loadReference()) {
+            std::cerr << "Failed to read reference " << ReferenceText << std::endl;
+            return 1;
+        }
+        std::vector<AASelectionResult> results;
+        const int selected = withPatternFactory([&](const auto& makePattern) {
+            return select_aa_setting(OutputSize, Roi, makePattern, Encoder, ReferenceImage, AutoAATargetPsnr, results);
+        });
+        for (const AASelectionResult& result : results) {
+            Info << get_aa_variant_suffix({result.type, result.level}).substr(1) << ": " << result.milliseconds << " ms, " << result.samplesPerPixel << " samples/pixel, PSNR "
+                 << result.metrics.psnr << " dB, SSIM " << result.metrics.ssim << std::endl;
+        }
+        if (selected < 0) {
+            Info << "No AA setting reaches " << AutoAATargetPsnr << " dB" << std::endl;
+            return 1;
+        }
+        Info << "Selected: " << get_aa_variant_suffix({results[selected].type, results[selected].level}).substr(1) << std::endl;
+        return 0;
+    }
+
+    bool written = CacheHit || Sharded;
+    if (written) {
+        // 캐시에서 복사했거나 자식 프로세스들이 렌더해 합쳤으므로 렌더하지 않는다.
+    } else if (SequenceMode) {
+        ProfileStage profileStage("total");
+        written = render_sequence(outputFile.c_str(), Sequence, OutputSize, AAType, AALevel, patternType, Encoder, &SampleStats);
+    } else if (CompareMode) {
+        written = withPatternFactory(renderComparison);
+        if (written) {
+            Info << "Compare: " << CompareVariants.size() << " AA settings from " << SampleStats.sampleCount << " samples vs "
+                 << CompareSeparateStats.sampleCount << " rendered separately" << std::endl;
+        }
+    } else if (PluginMode) {
+        const PluginPattern pattern(*PluginLibrary.GetPlugin(), OutputSize, AAType, AALevel, PluginParams);
+        written = renderToFile(pattern);
+#if !defined(BASICAA_SHARED)
+    } else if (!MipMode && !Streaming && !ProgressiveMode) {
+        written = renderWithLibrary();
+#endif
+    } else if (GraphMode) {
+        const CompositePattern pattern(OutputSize, AAType, AALevel, Graph);
+        written = renderToFile(pattern);
+    } else {
+        switch (patternType) {
+            case EPatternType::UV:
+                written = renderToFile(UVPattern(OutputSize));
+                break;
+            case EPatternType::CHECKERBOARD:
+                written = renderToFile(CheckerboardPattern(OutputSize, AAType, AALevel, CheckerboardAngle, CheckerboardPivot, CheckerboardTileSize));
+                break;
+            case EPatternType::CIRCLE:
+                written = renderToFile(CirclePattern(OutputSize, AAType, AALevel, CircleThickness, CircleGap));
+                break;
+            case EPatternType::VORONOI: {
+                const VoronoiPattern pattern(OutputSize, AAType, AALevel, VoronoiSiteCount, VoronoiLookup);
+                written = renderToFile(pattern);
+                break;
+            }
+        }
+    }
+
+    if (!written) {
+        std::cerr << "Failed to write " << outputFile;
+        if (!get_ppm_error().empty()) {
+            std::cerr << ": " << get_ppm_error();
+        }
+        std::cerr << std::endl;
+        return 1;
+    }
+    if (ShardChild) {
+        ShardReport report;
+        report.samples = SampleStats;
+        for (int i = 0; i < PROFILE_COUNTER_COUNT; ++i) {
+            report.counters[i] = GetProfiler().GetCounter(static_cast<EProfileCounter>(i));
+        }
+        send_shard_report(Shard, report);
+        return 0;
     }
 
-    unsigned char* data = new unsigned char[OutputSize.x * OutputSize.y * 3];
-    for (int i = 0; i < OutputSize.x * OutputSize.y; ++i) {
-        data[i * 3 + 0] = static_cast<unsigned char>(pixels[i].x * 255);    
-        data[i * 3 + 1] = static_cast<unsigned char>(pixels[i].y * 255);
-        data[i * 3 + 2] = static_cast<unsigned char>(pixels[i].z * 255);
+    if (UseCache && !CacheHit) {
+        Cache.Store(CacheKey, outputFile);
     }
 
-    ExportPPM(outputFile.c_str(), EPPMFormat::P3_BINARY, OutputSize.x, OutputSize.y, data);
+    if (UseReference) {
+        if (!loadReference()) {
+            std::cerr << "Failed to read reference " << ReferenceText << std::endl;
+            return 1;
+        }
+        // 비교 모드는 설정마다, 아니면 출력 파일(밉맵이면 기본 레벨)을 잰다.
+        std::vector<std::string> measuredFiles;
+        if (CompareMode) {
+            for (const AAVariant& variant : CompareVariants) {
+                measuredFiles.push_back(insert_filename_suffix(CompareBaseFile, get_aa_variant_suffix(variant)));
+            }
+        } else {
+            measuredFiles.push_back(outputFile);
+        }
+        for (const std::string& measuredFile : measuredFiles) {
+            EncodedImage image;
+            ImageMetrics metrics;
+            if (!load_ppm_image(measuredFile.c_str(), image) || !compute_image_metrics(image, ReferenceImage, metrics)) {
+                std::cerr << "Cannot compare " << measuredFile << " with the reference (size or bit depth differs)" << std::endl;
+                return 1;
+            }
+            Info << measuredFile << ": PSNR " << metrics.psnr << " dB, SSIM " << metrics.ssim << ", max error " << metrics.maxError << ", mean error " << metrics.meanError << std::endl;
+        }
+    }
+
+    if (AAType == EAAType::ADAPTIVE && SampleStats.pixelCount > 0) {
+        const int level = clamp(AALevel, 1, MAX_AA_LEVEL);
+        const int64_t fullSampleCount = SampleStats.pixelCount * level * level;
+        Info << "Adaptive: refined " << SampleStats.refinedPixelCount << " of " << SampleStats.pixelCount << " pixels ("
+                  << (100.0 * SampleStats.refinedPixelCount / SampleStats.pixelCount) << "%), "
+                  << SampleStats.sampleCount << " samples vs " << fullSampleCount << " for SSAA" << std::endl;
+    }
 
-    delete[] data;
+    if (PrintStats) {
+        GetProfiler().PrintStats(Info);
+    }
+    if (!TraceFile.empty() && !GetProfiler().WriteTrace(TraceFile.c_str())) {
+        std::cerr << "Failed to write " << TraceFile << std::endl;
+        return 1;
+    }
 
     return 0;
 }
\ No newline at end of file
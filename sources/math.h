@@ -10,11 +10,11 @@ constexpr double PI_INV = 1.0 / PI;
 constexpr double DEG_TO_RAD = PI / 180.0;
 constexpr double RAD_TO_DEG = 180.0 / PI;
 
-float DegreeToRadian(float degrees) {
+inline float DegreeToRadian(float degrees) {
     return degrees * DEG_TO_RAD;
 }
 
-float RadianToDegree(float radians) {
+inline float RadianToDegree(float radians) {
     return radians * RAD_TO_DEG;
 }
 
@@ -48,9 +48,9 @@ struct vec2f
     float x;
     float y;
 
-    vec2f() : x(0.0f), y(0.0f) {}
-    vec2f(float x, float y) : x(x), y(y) {}
-    vec2f(const vec2i& other) 
+    constexpr vec2f() : x(0.0f), y(0.0f) {}
+    constexpr vec2f(float x, float y) : x(x), y(y) {}
+    constexpr vec2f(const vec2i& other) 
         : x(static_cast<float>(other.x)), y(static_cast<float>(other.y)) {}
 
     vec2f operator+(const vec2f& other) const {
@@ -118,8 +118,8 @@ struct vec3f
     static const vec3f Zero;
     static const vec3f One;
 };
-const vec3f vec3f::Zero = {0.0f, 0.0f, 0.0f};
-const vec3f vec3f::One = {1.0f, 1.0f, 1.0f};
+inline const vec3f vec3f::Zero = {0.0f, 0.0f, 0.0f};
+inline const vec3f vec3f::One = {1.0f, 1.0f, 1.0f};
 
 template<typename T>
 float length(const T& v)
@@ -131,7 +131,7 @@ float length(const vec3f& v)
 {
     return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
 }
-float dot(const vec3f& a, const vec3f& b)
+inline float dot(const vec3f& a, const vec3f& b)
 {
     return a.x * b.x + a.y * b.y + a.z * b.z;
 }
@@ -184,5 +184,5 @@ struct mat2f
 
     static const mat2f Identity;
 };
-const mat2f mat2f::Identity = {1.0f, 0.0f, 0.0f, 1.0f};
+inline const mat2f mat2f::Identity = {1.0f, 0.0f, 0.0f, 1.0f};
 
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fxaa.h"
+#include "math.h"
+#include "ppm.h"
+#include "profiler.h"
+#include "quantize.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+// 한 번 렌더한 이미지에서 해상도를 절반씩 줄인 피라미드(밉맵)를 만들어 레벨마다 파일로 쓴다.
+// 기본 레벨은 밴드 단위로 렌더하고, 각 레벨은 윗 레벨의 행을 받는 대로 가로 → 세로 분리형 필터를 적용해
+// 자기 행을 내보낸다. 그래서 레벨마다 필터 폭만큼의 행만 들고 있으며, 추가 레벨은 패턴을 다시 평가하지 않는다.
+// 필터는 양자화 전 선형 float 값에 적용한다.
+
+enum class EMipFilter {
+    BOX,        // 2x2 평균(홀수 크기는 면적 비율)
+    LANCZOS3    // Lanczos a=3
+};
+
+constexpr int DEFAULT_MIP_BAND_ROWS = 64;
+
+// 출력 인덱스마다 원본 인덱스와 가중치 목록. 가장자리 밖 인덱스는 가장자리로 당긴다.
+struct MipFilterTaps
+{
+    int maxTaps = 0;
+    std::vector<int> counts;
+    std::vector<int> indices;     // dst * maxTaps
+    std::vector<float> weights;   // dst * maxTaps
+    std::vector<int> lastIndex;   // 출력마다 읽는 가장 큰 원본 인덱스
+    std::vector<int> firstIndex;  // 출력마다 읽는 가장 작은 원본 인덱스
+};
+
+static float mip_filter_weight(EMipFilter filter, float t)
+{
+    if (filter == EMipFilter::BOX) {
+        return (t >= -0.5f && t < 0.5f) ? 1.0f : 0.0f;
+    }
+    const float a = 3.0f;
+    if (t <= -a || t >= a) {
+        return 0.0f;
+    }
+    if (std::abs(t) < 1e-6f) {
+        return 1.0f;
+    }
+    const float pi = 3.14159265358979f;
+    const float x = pi * t;
+    return a * std::sin(x) * std::sin(x / a) / (x * x);
+}
+
+// srcSize 픽셀을 dstSize 픽셀로 줄이는 1차원 필터. 커널 폭은 출력 픽셀 단위이므로 원본에서는 scale 배로 넓다.
+static MipFilterTaps make_mip_filter_taps(int srcSize, int dstSize, EMipFilter filter)
+{
+    const float scale = static_cast<float>(srcSize) / dstSize;
+    const float support = ((filter == EMipFilter::BOX) ? 0.5f : 3.0f) * scale;
+
+    MipFilterTaps taps;
+    taps.maxTaps = static_cast<int>(std::ceil(2.0f * support)) + 1;
+    taps.counts.resize(dstSize);
+    taps.indices.resize(static_cast<size_t>(dstSize) * taps.maxTaps);
+    taps.weights.resize(static_cast<size_t>(dstSize) * taps.maxTaps);
+    taps.firstIndex.resize(dstSize);
+    taps.lastIndex.resize(dstSize);
+
+    for (int i = 0; i < dstSize; ++i) {
+        const float center = (i + 0.5f) * scale;
+        const int lo = static_cast<int>(std::floor(center - support));
+        const int hi = static_cast<int>(std::ceil(center + support));
+        int* indices = taps.indices.data() + static_cast<size_t>(i) * taps.maxTaps;
+        float* weights = taps.weights.data() + static_cast<size_t>(i) * taps.maxTaps;
+        int count = 0;
+        float total = 0.0f;
+        for (int j = lo; j <= hi && count < taps.maxTaps; ++j) {
+            const float weight = mip_filter_weight(filter, (j + 0.5f - center) / scale);
+            if (weight == 0.0f) {
+                continue;
+            }
+            indices[count] = clamp(j, 0, srcSize - 1);
+            weights[count] = weight;
+            total += weight;
+            ++count;
+        }
+        for (int k = 0; k < count; ++k) {
+            weights[k] /= total;
+        }
+        taps.counts[i] = count;
+        taps.firstIndex[i] = *std::min_element(indices, indices + count);
+        taps.lastIndex[i] = *std::max_element(indices, indices + count);
+    }
+    return taps;
+}
+
+// 가로 필터를 float 단위로 편 표. 출력 행의 float j(픽셀 j / 3 의 채널 j % 3)는 탭 k 마다
+// indices[k * stride + j] 번째 원본 float 에 weights[k * stride + j] 를 곱해 더한다(PatternKernels::mipRow).
+// 탭 수가 가장 많은 출력에 맞춰 나머지는 가중치 0 인 탭(마지막 탭의 원본)으로 채운다. 0 이 아닌 합에 +0/-0 을 더해도,
+// +0 에 더해도 값이 그대로라서 결과는 픽셀마다 제 탭만 더한 것과 같다.
+// 원본이 정확히 두 배인 레벨의 안쪽 [halfBegin, halfEnd) 는 출력 x 가 원본 2x + halfOffset 부터 같은 가중치
+// halfWeights 로 탭을 읽으므로, 모으기(gather) 대신 PatternKernels::mipRowHalf 로 거른다.
+struct MipRowKernel
+{
+    int tapCount = 0;
+    int stride = 0;
+    std::vector<int> indices;
+    std::vector<float> weights;
+
+    int halfBegin = 0;
+    int halfEnd = 0;
+    int halfOffset = 0;
+    std::vector<float> halfWeights;
+};
+
+// 출력 x 가 reference 와 같은 간격 2 의 규칙적인 탭을 쓰는지. 가중치는 비트까지 같아야 한다.
+static bool is_mip_half_tap(const MipFilterTaps& taps, int tapCount, int reference, int x)
+{
+    if (taps.counts[x] != tapCount) {
+        return false;
+    }
+    const int* referenceIndices = taps.indices.data() + static_cast<size_t>(reference) * taps.maxTaps;
+    const float* referenceWeights = taps.weights.data() + static_cast<size_t>(reference) * taps.maxTaps;
+    const int* indices = taps.indices.data() + static_cast<size_t>(x) * taps.maxTaps;
+    const float* weights = taps.weights.data() + static_cast<size_t>(x) * taps.maxTaps;
+    for (int k = 0; k < tapCount; ++k) {
+        if (indices[k] != referenceIndices[0] + 2 * (x - reference) + k
+            || std::memcmp(&weights[k], &referenceWeights[k], sizeof(float)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static MipRowKernel make_mip_row_kernel(const MipFilterTaps& taps, int dstSize)
+{
+    MipRowKernel kernel;
+    kernel.tapCount = *std::max_element(taps.counts.begin(), taps.counts.end());
+    kernel.stride = dstSize * 3;
+    kernel.indices.resize(static_cast<size_t>(kernel.tapCount) * kernel.stride);
+    kernel.weights.resize(static_cast<size_t>(kernel.tapCount) * kernel.stride);
+    for (int x = 0; x < dstSize; ++x) {
+        const int* indices = taps.indices.data() + static_cast<size_t>(x) * taps.maxTaps;
+        const float* weights = taps.weights.data() + static_cast<size_t>(x) * taps.maxTaps;
+        const int count = taps.counts[x];
+        for (int k = 0; k < kernel.tapCount; ++k) {
+            const int index = indices[std::min(k, count - 1)];
+            const float weight = (k < count) ? weights[k] : 0.0f;
+            for (int c = 0; c < 3; ++c) {
+                const size_t tap = static_cast<size_t>(k) * kernel.stride + x * 3 + c;
+                kernel.indices[tap] = index * 3 + c;
+                kernel.weights[tap] = weight;
+            }
+        }
+    }
+
+    // 가운데 출력에서 시작해 규칙적인 구간을 양쪽으로 넓힌다.
+    const int reference = dstSize / 2;
+    if (dstSize > 0 && is_mip_half_tap(taps, kernel.tapCount, reference, reference)) {
+        kernel.halfBegin = reference;
+        kernel.halfEnd = reference + 1;
+        while (kernel.halfBegin > 0 && is_mip_half_tap(taps, kernel.tapCount, reference, kernel.halfBegin - 1)) {
+            --kernel.halfBegin;
+        }
+        while (kernel.halfEnd < dstSize && is_mip_half_tap(taps, kernel.tapCount, reference, kernel.halfEnd)) {
+            ++kernel.halfEnd;
+        }
+        kernel.halfOffset = taps.indices[static_cast<size_t>(reference) * taps.maxTaps] - 2 * reference;
+        const float* weights = taps.weights.data() + static_cast<size_t>(reference) * taps.maxTaps;
+        kernel.halfWeights.assign(weights, weights + kernel.tapCount);
+    }
+    return kernel;
+}
+
+static std::string get_mip_level_filename(const std::string& baseFilename, int level)
+{
+    return (level == 0) ? baseFilename : insert_filename_suffix(baseFilename, "_mip" + std::to_string(level));
+}
+
+// 피라미드의 한 레벨. 윗 레벨 행을 위에서부터 차례로 받아, 필요한 행이 다 모인 출력 행을 계산하고 파일에 쓴다.
+class MipLevel
+{
+public:
+    MipLevel(const vec2i& parentSize, const vec2i& size, EMipFilter filter, const PixelEncoder& encoder)
+        : parentSize(parentSize)
+        , size(size)
+        , encoder(encoder)
+        , columnTaps(make_mip_filter_taps(parentSize.x, size.x, filter))
+        , rowTaps(make_mip_filter_taps(parentSize.y, size.y, filter))
+        , rowKernel(make_mip_row_kernel(columnTaps, size.x))
+    {
+    }
+
+    bool Open(const std::string& filename)
+    {
+        return writer.Open(filename.c_str(), EPPMFormat::P3_BINARY, size.x, size.y, encoder.GetMaxValue());
+    }
+
+    bool Close()
+    {
+        return writer.Close();
+    }
+
+    const vec2i& GetSize() const { return size; }
+
+    // 윗 레벨의 행 [firstRow, firstRow + rowCount) 를 받는다. 이번에 완성된 이 레벨의 행을 emitted 에 담는다.
+    // 가로/세로 필터는 밴드의 행 전체에 PatternKernels 의 SIMD 행 커널을 쓰고, 완성된 행은 한 번에 인코딩해 쓴다.
+    bool PushRows(const vec3f* rows, int firstRow, int rowCount, std::vector<vec3f>& emitted, int& emittedFirstRow)
+    {
+        const PatternKernels& kernels = GetPatternKernels();
+
+        // 가로 필터를 먼저 적용해 size.x 폭으로 쌓아 둔다.
+        const size_t width = static_cast<size_t>(size.x);
+        const int oldRowCount = bufferRowCount;
+        if (bufferRowCount == 0) {
+            bufferFirstRow = firstRow;
+        }
+        bufferRowCount += rowCount;
+        buffer.resize(static_cast<size_t>(bufferRowCount) * width);
+        GetThreadPool().ParallelFor(rowCount, [&](int r) {
+            const float* source = reinterpret_cast<const float*>(rows + static_cast<size_t>(r) * parentSize.x);
+            float* out = reinterpret_cast<float*>(buffer.data() + static_cast<size_t>(oldRowCount + r) * width);
+            FilterRow(kernels, source, out);
+        });
+
+        // 읽을 행이 모두 들어온 출력 행을 세로 필터로 만든다.
+        const int availableLastRow = firstRow + rowCount - 1;
+        const int outputFirst = nextRow;
+        while (nextRow < size.y && rowTaps.lastIndex[nextRow] <= availableLastRow) {
+            ++nextRow;
+        }
+        const int outputCount = nextRow - outputFirst;
+        emittedFirstRow = outputFirst;
+        emitted.resize(static_cast<size_t>(outputCount) * width);
+        columnSources.resize(static_cast<size_t>(outputCount) * rowTaps.maxTaps);
+        GetThreadPool().ParallelFor(outputCount, [&](int r) {
+            const int y = outputFirst + r;
+            const int* indices = rowTaps.indices.data() + static_cast<size_t>(y) * rowTaps.maxTaps;
+            const float* weights = rowTaps.weights.data() + static_cast<size_t>(y) * rowTaps.maxTaps;
+            const float** sources = columnSources.data() + static_cast<size_t>(r) * rowTaps.maxTaps;
+            for (int k = 0; k < rowTaps.counts[y]; ++k) {
+                sources[k] = reinterpret_cast<const float*>(buffer.data() + static_cast<size_t>(indices[k] - bufferFirstRow) * width);
+            }
+            kernels.mipColumn(sources, weights, rowTaps.counts[y], static_cast<int>(width * 3), reinterpret_cast<float*>(emitted.data() + static_cast<size_t>(r) * width));
+        });
+
+        bool ok = true;
+        if (outputCount > 0) {
+            encodedRows.resize(static_cast<size_t>(outputCount) * width * encoder.GetBytesPerPixel());
+            encoder.EncodeRow(emitted.data(), static_cast<size_t>(outputCount) * width, encodedRows.data());
+            ok = writer.WriteRows(encodedRows.data(), outputCount);
+        }
+
+        // 다음 출력 행이 더 이상 읽지 않는 행은 버린다.
+        if (nextRow < size.y) {
+            const int dropCount = clamp(rowTaps.firstIndex[nextRow] - bufferFirstRow, 0, bufferRowCount);
+            if (dropCount > 0) {
+                std::memmove(buffer.data(), buffer.data() + static_cast<size_t>(dropCount) * width, static_cast<size_t>(bufferRowCount - dropCount) * width * sizeof(vec3f));
+                bufferFirstRow += dropCount;
+                bufferRowCount -= dropCount;
+            }
+        } else {
+            bufferRowCount = 0;
+        }
+        return ok;
+    }
+
+private:
+    // 윗 레벨 행 하나를 가로로 거른다. 가장자리는 모으기 커널, 규칙적인 안쪽은 2:1 커널을 쓴다.
+    void FilterRow(const PatternKernels& kernels, const float* source, float* out) const
+    {
+        const MipRowKernel& k = rowKernel;
+        const int halfStart = k.halfBegin * 3;
+        const int halfStop = k.halfEnd * 3;
+        if (halfStart > 0) {
+            kernels.mipRow(source, k.indices.data(), k.weights.data(), k.tapCount, k.stride, halfStart, out);
+        }
+        if (halfStop > halfStart) {
+            const int sourceStart = (2 * k.halfBegin + k.halfOffset) * 3;
+            kernels.mipRowHalf(source + sourceStart, parentSize.x * 3 - sourceStart, k.halfWeights.data(), k.tapCount, k.halfEnd - k.halfBegin, out + halfStart);
+        }
+        if (k.stride > halfStop) {
+            kernels.mipRow(source, k.indices.data() + halfStop, k.weights.data() + halfStop, k.tapCount, k.stride, k.stride - halfStop, out + halfStop);
+        }
+    }
+
+    vec2i parentSize;
+    vec2i size;
+    const PixelEncoder& encoder;
+    MipFilterTaps columnTaps;
+    MipFilterTaps rowTaps;
+    MipRowKernel rowKernel;
+    PPMWriter writer;
+    std::vector<vec3f> buffer;
+    int bufferFirstRow = 0;
+    int bufferRowCount = 0;
+    int nextRow = 0;
+    std::vector<const float*> columnSources;
+    std::vector<unsigned char> encodedRows;
+};
+
+// roi 를 렌더해 baseFilename 에 쓰고, 절반씩 줄인 레벨을 get_mip_level_filename 이름으로 쓴다.
+// levelCount 는 기본 레벨을 포함한 레벨 수이며, 0 이하이면 1x1 까지 만든다.
+// 기본 레벨 파일은 같은 옵션의 일반 렌더와 같다.
+template<typename Pattern>
+static bool render_pattern_mipmaps(const std::string& baseFilename, const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const RenderTile& roi,
+    const PixelEncoder& encoder, EMipFilter filter, int levelCount, int bandRows = DEFAULT_MIP_BAND_ROWS, RenderSampleStats* stats = nullptr)
+{
+    const vec2i baseSize = roi.max - roi.min;
+    std::vector<std::unique_ptr<MipLevel>> levels;
+    vec2i levelSize = baseSize;
+    for (int level = 1; (levelCount <= 0 || level < levelCount) && (levelSize.x > 1 || levelSize.y > 1); ++level) {
+        const vec2i childSize = {std::max(levelSize.x / 2, 1), std::max(levelSize.y / 2, 1)};
+        levels.push_back(std::make_unique<MipLevel>(levelSize, childSize, filter, encoder));
+        if (!levels.back()->Open(get_mip_level_filename(baseFilename, level))) {
+            return false;
+        }
+        levelSize = childSize;
+    }
+
+    PPMWriter baseWriter;
+    if (!baseWriter.Open(baseFilename.c_str(), EPPMFormat::P3_BINARY, baseSize.x, baseSize.y, encoder.GetMaxValue())) {
+        return false;
+    }
+
+    bandRows = clamp(bandRows, 1, baseSize.y);
+    std::vector<vec3f> band(static_cast<size_t>(bandRows) * baseSize.x);
+    std::vector<unsigned char> encodedBand(static_cast<size_t>(bandRows) * baseSize.x * encoder.GetBytesPerPixel());
+    std::unique_ptr<FXAABandRenderer<Pattern>> fxaaBands;
+    std::unique_ptr<PatternBandRenderer<Pattern>> patternBands;
+    if (AAType == EAAType::FXAA) {
+        fxaaBands = std::make_unique<FXAABandRenderer<Pattern>>(outputSize, pattern, bandRows, stats, roi.min.x, roi.max.x, DEFAULT_BAND_ROW_CACHE_BYTES);
+    } else {
+        patternBands = std::make_unique<PatternBandRenderer<Pattern>>(outputSize, AAType, AALevel, pattern, roi, DEFAULT_BAND_ROW_CACHE_BYTES);
+    }
+
+    // 레벨마다 내보낸 행을 다음 레벨에 넘긴다. 버퍼 두 개를 번갈아 쓴다.
+    std::vector<vec3f> emitted[2];
+    bool ok = true;
+    for (int bandMinY = roi.min.y; bandMinY < roi.max.y && ok; bandMinY += bandRows) {
+        const int bandMaxY = std::min(bandMinY + bandRows, roi.max.y);
+        const int rowCount = bandMaxY - bandMinY;
+        const RenderTarget target = make_float_target(band.data(), baseSize.x);
+        if (fxaaBands) {
+            fxaaBands->RenderBand(bandMinY, bandMaxY, target);
+        } else {
+            patternBands->RenderBand(bandMinY, bandMaxY, target, stats);
+        }
+        encoder.EncodeRow(band.data(), static_cast<size_t>(rowCount) * baseSize.x, encodedBand.data());
+        ok = baseWriter.WriteRows(encodedBand.data(), rowCount);
+
+        ProfileStage profileStage("mipmap");
+        const vec3f* rows = band.data();
+        int firstRow = bandMinY - roi.min.y;
+        int count = rowCount;
+        for (size_t level = 0; level < levels.size() && ok && count > 0; ++level) {
+            std::vector<vec3f>& out = emitted[level & 1];
+            int emittedFirstRow = 0;
+            ok = levels[level]->PushRows(rows, firstRow, count, out, emittedFirstRow);
+            rows = out.data();
+            firstRow = emittedFirstRow;
+            count = static_cast<int>(out.size() / levels[level]->GetSize().x);
+        }
+    }
+
+    ok = baseWriter.Close() && ok;
+    for (std::unique_ptr<MipLevel>& level : levels) {
+        ok = level->Close() && ok;
+    }
+    return ok;
+}
@@ -1,13 +1,12 @@
 ﻿#pragma once
 
+#include "fxaa.h"
 #include "math.h"
-
-enum class EAAType {
-    NONE,
-    SSAA,
-    MSAA,
-    FXAA
-};
+#include "pattern_analytic.h"
+#include "pattern_simd.h"
+#include "sampler.h"
+#include "thread_pool.h"
+#include "voronoi_grid.h"
 
 enum class EPatternType {
     UV,
@@ -16,352 +15,337 @@ enum class EPatternType {
     VORONOI
 };
 
-const vec2f MSAA_SAMPLES[8] = {
-    {-0.3125f, -0.4375f}, { 0.1875f, -0.3125f},
-    { 0.4375f, -0.0625f}, { 0.0625f,  0.1875f},
-    {-0.4375f,  0.0625f}, {-0.0625f,  0.3125f},
-    {-0.1875f,  0.4375f}, { 0.3125f,  0.0625f}
-};
-
 static vec3f pattern_uv(const vec2f& uv)
 {
     return {uv.x, uv.y, 0.0f};
 }
 
-static vec3f pattern_checkerboard(const vec2f& uv, const vec2i& size, const float tileSize)
+static vec3f pattern_voronoi(const vec2f& uv, const vec2i& size, const std::vector<vec2f>& points, const VoronoiSiteGrid& grid)
 {
-    // tileSize: 타일 한 칸의 픽셀 크기(<=0 방지)
-    const float step = (tileSize > 0.0f) ? tileSize : 10.0f;
-
-    // 픽셀 좌표
     const vec2f pos = uv * size;
-
-    // 셀 인덱스
-    const int cx = static_cast<int>(std::floor(pos.x / step));
-    const int cy = static_cast<int>(std::floor(pos.y / step));
-
-    // 패리티로 0/1 결정
-    const int parity = (cx + cy) & 1;
-    const float c = parity ? 1.0f : 0.0f;
-
-    return {c, c, c};
+    const vec2f& closestPoint = points[grid.FindClosest(pos)];
+    return {closestPoint.x / size.x, closestPoint.y / size.y, 0.f};
 }
 
-static vec3f pattern_circle(const vec2f& uv, const vec2i& size, const float thickness, const float gap)
+// 사이트 좌표를 재는 패턴 해상도. SSAA 면 outputSize * AALevel 이다.
+static vec2i get_voronoi_pattern_size(const vec2i& outputSize, const EAAType AAType, const int AALevel)
 {
-    const vec2f center = vec2f{0.5f, 0.5f} * size;
-    const vec2f pos = uv * size;
-
-    const float dist = length(pos - center);
-    const float remainder = std::fmod(dist, (thickness + gap));
-    const float parity = remainder > thickness ? 1.f : 0.f;
-    return vec3f::One * parity;
+    return (AAType == EAAType::SSAA) ? outputSize * AALevel : outputSize;
 }
 
-static vec3f pattern_voronoi(const vec2f& uv, const vec2i& size, const std::vector<vec2f>& points)
+// Voronoi 사이트를 뽑는 난수열. glibc 의 srand(seed) 뒤 rand() 와 같은 값을 내므로 사이트가 예전 출력과 같다.
+// 패턴마다 따로 가지므로 std::rand 의 전역 상태를 건드리지 않고, 여러 스레드에서 동시에 패턴을 만들어도 된다.
+class VoronoiSiteRandom
 {
-    const vec2f pos = uv * size;
-    
-    vec2f closestPoint = points[0];
-    float minDist = std::numeric_limits<float>::max();
-    for (const vec2f& point : points) {
-        float dist = length(pos - point);
-        if (dist < minDist) {
-            minDist = dist;
-            closestPoint = point;
+public:
+    explicit VoronoiSiteRandom(uint32_t seed = 1)
+    {
+        int32_t word = (seed == 0) ? 1 : static_cast<int32_t>(seed);
+        state[0] = static_cast<uint32_t>(word);
+        for (int i = 1; i < STATE_SIZE; ++i) {
+            const int32_t hi = word / 127773;
+            const int32_t lo = word % 127773;
+            word = 16807 * lo - 2836 * hi;
+            if (word < 0) {
+                word += 2147483647;
+            }
+            state[i] = static_cast<uint32_t>(word);
+        }
+        for (int i = 0; i < STATE_SIZE * 10; ++i) {
+            Next();
         }
     }
-    
-    return {closestPoint.x / size.x, closestPoint.y / size.y, 0.f};
-    //const float maxDist = 7.f / (length(size));
-    //return {0.f, 0.f, 1.f - (minDist * maxDist)};
-}
 
-static std::vector<vec3f> generate_uv_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel)
+    // [0, 2^31) 의 값.
+    int Next()
+    {
+        state[front] += state[rear];
+        const int result = static_cast<int>(state[front] >> 1);
+        front = (front + 1) % STATE_SIZE;
+        rear = (rear + 1) % STATE_SIZE;
+        return result;
+    }
+
+private:
+    static constexpr int STATE_SIZE = 31;
+    uint32_t state[STATE_SIZE];
+    int front = 3;
+    int rear = 0;
+};
+
+// 사이트 좌표는 패턴 해상도 기준의 정수 픽셀 위치.
+static std::vector<vec2f> generate_voronoi_sites(const vec2i& patternSize, int numPoints, VoronoiSiteRandom& random)
 {
-    const float AspectRatio = static_cast<float>(outputSize.y) / static_cast<float>(outputSize.x);
-   
-    std::vector<vec3f> pixels(outputSize.x * outputSize.y);
-    const vec2f UVOffset = {0.5f, 0.5f};
-
-    for (int y = 0; y < outputSize.y; y++) {
-        for (int x = 0; x < outputSize.x; x++) {
-            vec3f accumulatedColor = vec3f::Zero;
-            int sampleCount = 1;
-
-            if (AAType == EAAType::SSAA) {
-                sampleCount = AALevel * AALevel;
-                const float InvAALevel = 1.0f / static_cast<float>(AALevel);
-                for (int subY = 0; subY < AALevel; subY++) {
-                    for (int subX = 0; subX < AALevel; subX++) {
-                        const int superSampleX = x * AALevel + subX;
-                        const int superSampleY = y * AALevel + subY;
-                        vec2f uv = {
-                            (static_cast<float>(superSampleX) + UVOffset.x) * InvAALevel / outputSize.x,
-                            (static_cast<float>(superSampleY) + UVOffset.y) * InvAALevel / outputSize.y
-                        };
-                        uv.y *= AspectRatio;
-                        accumulatedColor += pattern_uv(uv);
-                    }
-                }
-            } else { // MSAA or NONE
-                sampleCount = (AAType == EAAType::MSAA) ? AALevel : 1;
-                for (int i = 0; i < sampleCount; i++) {
-                    vec2f offset = (AAType == EAAType::MSAA) ? MSAA_SAMPLES[i] : vec2f();
-                    vec2f uv = {
-                        (static_cast<float>(x) + UVOffset.x + offset.x) / outputSize.x,
-                        (static_cast<float>(y) + UVOffset.y + offset.y) / outputSize.y
-                    };
-                    uv.y *= AspectRatio;
-                    accumulatedColor += pattern_uv(uv);
-                }
-            }
-            pixels[y * outputSize.x + x] = accumulatedColor / static_cast<float>(sampleCount);
-        }
+    std::vector<vec2f> points;
+    points.reserve(numPoints);
+    for (int i = 0; i < numPoints; ++i) {
+        points.push_back({static_cast<float>(random.Next() % patternSize.x), static_cast<float>(random.Next() % patternSize.y)});
     }
-    return pixels;
+    return points;
 }
 
-static std::vector<vec3f> generate_checkerboard_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, float angleDegrees, const vec2f& pivot, float tileSize)
+static std::vector<vec2f> generate_voronoi_sites(const vec2i& patternSize, int numPoints)
 {
-    const float AspectRatio = static_cast<float>(outputSize.y) / static_cast<float>(outputSize.x);
-    const float angle = DegreeToRadian(angleDegrees);
-    const mat2f rotation = {std::cos(angle), -std::sin(angle), std::sin(angle), std::cos(angle)};
-   
-    std::vector<vec3f> pixels(outputSize.x * outputSize.y);
-    const vec2f UVOffset = {0.5f, 0.5f};
+    VoronoiSiteRandom random;
+    return generate_voronoi_sites(patternSize, numPoints, random);
+}
 
-    vec2i patternSize = outputSize;
-    float patternTileSize = tileSize;
+// 렌더 드라이버(render_pattern)에 넘기는 패턴 펑터들.
+// 생성자에서 AA 설정에 맞춘 파라미터를 한 번 계산하고, EvaluateBatch 는 샘플 묶음을 색으로 바꾼다.
+// ANALYTIC 이면 샘플은 픽셀 중심이고, 체커보드/원은 그 픽셀 전체를 적분한 값을 돌려준다.
 
-    if (AAType == EAAType::SSAA) {
-        patternSize = outputSize * AALevel;
-        patternTileSize = tileSize * AALevel;
-    }
-    const vec2i SuperSamplePatternSize = {patternSize.x, patternSize.x};
-
-
-    for (int y = 0; y < outputSize.y; y++) {
-        for (int x = 0; x < outputSize.x; x++) {
-            vec3f accumulatedColor = vec3f::Zero;
-            int sampleCount = 1;
-
-            if (AAType == EAAType::SSAA) {
-                sampleCount = AALevel * AALevel;
-                const float InvAALevel = 1.0f / static_cast<float>(AALevel);
-                for (int subY = 0; subY < AALevel; subY++) {
-                    for (int subX = 0; subX < AALevel; subX++) {
-                        const int superSampleX = x * AALevel + subX;
-                        const int superSampleY = y * AALevel + subY;
-                        vec2f uv = {
-                            (static_cast<float>(superSampleX) + UVOffset.x) * InvAALevel / outputSize.x,
-                            (static_cast<float>(superSampleY) + UVOffset.y) * InvAALevel / outputSize.y
-                        };
-                        uv.y *= AspectRatio;
-                        uv = uv - vec2f{pivot.x, pivot.y * AspectRatio};
-                        uv = rotation * uv;
-                        uv = uv + pivot;
-                        accumulatedColor += pattern_checkerboard(uv, SuperSamplePatternSize, patternTileSize);
-                    }
-                }
-            } else { // MSAA or NONE
-                sampleCount = (AAType == EAAType::MSAA) ? AALevel : 1;
-                for (int i = 0; i < sampleCount; i++) {
-                    vec2f offset = (AAType == EAAType::MSAA) ? MSAA_SAMPLES[i] : vec2f();
-                    vec2f uv = {
-                        (static_cast<float>(x) + UVOffset.x + offset.x) / outputSize.x,
-                        (static_cast<float>(y) + UVOffset.y + offset.y) / outputSize.y
-                    };
-                    uv.y *= AspectRatio;
-                    uv = uv - vec2f{pivot.x, pivot.y * AspectRatio};
-                    uv = rotation * uv;
-                    uv = uv + pivot;
-                    accumulatedColor += pattern_checkerboard(uv, SuperSamplePatternSize, patternTileSize);
-                }
-            }
-            pixels[y * outputSize.x + x] = accumulatedColor / static_cast<float>(sampleCount);
+struct UVPattern
+{
+    float aspectRatio;
+
+    UVPattern(const vec2i& outputSize)
+        : aspectRatio(static_cast<float>(outputSize.y) / static_cast<float>(outputSize.x)) {}
+
+    void EvaluateBatch(const SampleBatch& batch) const
+    {
+        for (int i = 0; i < batch.count; i++) {
+            batch.colors[i] = pattern_uv({batch.u[i], batch.v[i] * aspectRatio});
         }
     }
-    return pixels;
+};
+
+// 체커보드 회전 행렬. 90도 배수는 cos/sin 을 정확한 -1/0/1 로 둔다.
+// DegreeToRadian(90) 의 cos 는 0 이 아닌 작은 값이라, 그대로 쓰면 축에 맞춘 체커보드가 조금 기울어진다.
+static mat2f make_checkerboard_rotation(float angleDegrees)
+{
+    const float turnDegrees = std::fmod(angleDegrees, 360.0f);
+    if (std::fmod(turnDegrees, 90.0f) == 0.0f) {
+        constexpr float QuarterCos[4] = {1.0f, 0.0f, -1.0f, 0.0f};
+        constexpr float QuarterSin[4] = {0.0f, 1.0f, 0.0f, -1.0f};
+        const int quarter = (static_cast<int>(turnDegrees / 90.0f) + 4) % 4;
+        return {QuarterCos[quarter], -QuarterSin[quarter], QuarterSin[quarter], QuarterCos[quarter]};
+    }
+    const float angle = DegreeToRadian(angleDegrees);
+    return {std::cos(angle), -std::sin(angle), std::sin(angle), std::cos(angle)};
 }
 
-static std::vector<vec3f> generate_circle_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, const float thickness, const float gap)
+struct CheckerboardPattern
 {
-    std::vector<vec3f> pixels(outputSize.x * outputSize.y);
-    const vec2f UVOffset = {0.5f, 0.5f};
-
-    for (int y = 0; y < outputSize.y; y++) {
-        for (int x = 0; x < outputSize.x; x++) {
-            vec3f accumulatedColor = vec3f::Zero;
-            int sampleCount = 1;
-
-            if (AAType == EAAType::SSAA) {
-                sampleCount = AALevel * AALevel;
-                const float InvAALevel = 1.0f / static_cast<float>(AALevel);
-                const vec2i SuperSampleSize = outputSize * AALevel;
-                const float SuperSampleThickness = thickness * AALevel;
-                const float SuperSampleGap = gap * AALevel;
-
-                for (int subY = 0; subY < AALevel; subY++) {
-                    for (int subX = 0; subX < AALevel; subX++) {
-                        const int superSampleX = x * AALevel + subX;
-                        const int superSampleY = y * AALevel + subY;
-                        const vec2f uv = {
-                            (static_cast<float>(superSampleX) + UVOffset.x) * InvAALevel / outputSize.x,
-                            (static_cast<float>(superSampleY) + UVOffset.y) * InvAALevel / outputSize.y
-                        };
-                        accumulatedColor += pattern_circle(uv, SuperSampleSize, SuperSampleThickness, SuperSampleGap);
-                    }
-                }
-            } else if (AAType == EAAType::MSAA) {
-                sampleCount = AALevel;
-                for (int i = 0; i < sampleCount; i++) {
-                    vec2f uv = {
-                        (static_cast<float>(x) + UVOffset.x + MSAA_SAMPLES[i].x) / outputSize.x,
-                        (static_cast<float>(y) + UVOffset.y + MSAA_SAMPLES[i].y) / outputSize.y
-                    };
-                    accumulatedColor += pattern_circle(uv, outputSize, thickness, gap);
-                }
-            } else { // NONE
-                vec2f uv = {
-                    (static_cast<float>(x) + UVOffset.x) / outputSize.x,
-                    (static_cast<float>(y) + UVOffset.y) / outputSize.y
-                };
-                accumulatedColor = pattern_circle(uv, outputSize, thickness, gap);
+    CheckerboardKernelParams params;
+    const PatternKernels* kernels;
+    bool analytic;
+    vec2f pixelUVSize;
+
+    CheckerboardPattern(const vec2i& outputSize, const EAAType AAType, const int AALevel, float angleDegrees, const vec2f& pivot, float tileSize)
+        : kernels(&GetPatternKernels())
+        , analytic(AAType == EAAType::ANALYTIC)
+        , pixelUVSize{1.0f / outputSize.x, 1.0f / outputSize.y}
+    {
+        const float AspectRatio = static_cast<float>(outputSize.y) / static_cast<float>(outputSize.x);
+        const mat2f rotation = make_checkerboard_rotation(angleDegrees);
+
+        vec2i patternSize = outputSize;
+        float patternTileSize = tileSize;
+
+        if (AAType == EAAType::SSAA) {
+            patternSize = outputSize * AALevel;
+            patternTileSize = tileSize * AALevel;
+        }
+        const vec2i SuperSamplePatternSize = {patternSize.x, patternSize.x};
+
+        params.aspectRatio = AspectRatio;
+        params.pivot = pivot;
+        params.pivotYAspect = pivot.y * AspectRatio;
+        params.rotation = rotation;
+        params.size = SuperSamplePatternSize;
+        params.step = (patternTileSize > 0.0f) ? patternTileSize : 10.0f;
+    }
+
+    void EvaluateBatch(const SampleBatch& batch) const
+    {
+        if (analytic) {
+            for (int i = 0; i < batch.count; i++) {
+                const float coverage = checkerboard_coverage_analytic(batch.u[i], batch.v[i], pixelUVSize, params);
+                batch.colors[i] = {coverage, coverage, coverage};
             }
-            
-            pixels[y * outputSize.x + x] = accumulatedColor / static_cast<float>(sampleCount);
+            return;
+        }
+        kernels->checkerboard(batch.u, batch.v, batch.count, params, batch.values);
+        for (int i = 0; i < batch.count; i++) {
+            batch.colors[i] = {batch.values[i], batch.values[i], batch.values[i]};
         }
     }
-    return pixels;
-}
 
-static std::vector<vec3f> generate_voronoi_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, int numPoints)
-{
-    std::vector<vec3f> pixels(outputSize.x * outputSize.y);
-    const vec2f UVOffset = {0.5f, 0.5f};
+    // 90도 배수로 회전하면 행렬의 대각 항이나 비대각 항이 0 이라서 cx 와 cy 가 각각 u 나 v 하나로만 정해지고,
+    // (cx + cy) & 1 은 두 패리티로 나뉜다.
+    EPatternSymmetry GetSymmetry() const
+    {
+        const mat2f& rotation = params.rotation;
+        const bool axisAligned = (rotation.m01 == 0.0f && rotation.m10 == 0.0f) || (rotation.m00 == 0.0f && rotation.m11 == 0.0f);
+        return (!analytic && axisAligned) ? EPatternSymmetry::SYMMETRIC : EPatternSymmetry::NONE;
+    }
 
-    vec2i patternSize = outputSize;
-    if (AAType == EAAType::SSAA) {
-        patternSize = outputSize * AALevel;
+    // checkerboard_sample_scalar 와 같은 순서로 이 축이 정하는 칸 번호(90/270도면 다른 축의 칸 번호)의 패리티를 구한다.
+    // 빠진 항(0 x 값)은 부호만 있는 0 이라 pivot 을 더한 뒤에는 결과가 같다.
+    float GetAxisKey(int axis, float coord) const
+    {
+        const float offset = (axis == 0) ? coord - params.pivot.x : coord * params.aspectRatio - params.pivotYAspect;
+        const float toX = (axis == 0) ? params.rotation.m00 : params.rotation.m01;
+        const float toY = (axis == 0) ? params.rotation.m10 : params.rotation.m11;
+        const float pos = (toX != 0.0f)
+            ? (toX * offset + params.pivot.x) * params.size.x
+            : (toY * offset + params.pivot.y) * params.size.y;
+        return (static_cast<int>(std::floor(pos / params.step)) & 1) ? 1.0f : 0.0f;
     }
+};
 
-    std::vector<vec2f> points;
-    points.reserve(numPoints);
-    for (int i = 0; i < numPoints; ++i) {
-        points.push_back({static_cast<float>(std::rand() % patternSize.x), static_cast<float>(std::rand() % patternSize.y)});
+struct CirclePattern
+{
+    CircleKernelParams params;
+    const PatternKernels* kernels;
+    bool analytic;
+    vec2f pixelUVSize;
+
+    CirclePattern(const vec2i& outputSize, const EAAType AAType, const int AALevel, const float thickness, const float gap)
+        : kernels(&GetPatternKernels())
+        , analytic(AAType == EAAType::ANALYTIC)
+        , pixelUVSize{1.0f / outputSize.x, 1.0f / outputSize.y}
+    {
+        vec2i patternSize = outputSize;
+        float patternThickness = thickness;
+        float patternGap = gap;
+        if (AAType == EAAType::SSAA) {
+            patternSize = outputSize * AALevel;
+            patternThickness = thickness * AALevel;
+            patternGap = gap * AALevel;
+        }
+
+        params.size = patternSize;
+        params.center = vec2f{0.5f, 0.5f} * patternSize;
+        params.thickness = patternThickness;
+        params.period = patternThickness + patternGap;
     }
 
-    for (int y = 0; y < outputSize.y; y++) {
-        for (int x = 0; x < outputSize.x; x++) {
-            vec3f accumulatedColor = vec3f::Zero;
-            int sampleCount = 1;
-
-            if (AAType == EAAType::SSAA) {
-                sampleCount = AALevel * AALevel;
-                const float InvAALevel = 1.0f / static_cast<float>(AALevel);
-                for (int subY = 0; subY < AALevel; subY++) {
-                    for (int subX = 0; subX < AALevel; subX++) {
-                        const int superSampleX = x * AALevel + subX;
-                        const int superSampleY = y * AALevel + subY;
-                        const vec2f uv = {
-                            (static_cast<float>(superSampleX) + UVOffset.x) * InvAALevel / outputSize.x,
-                            (static_cast<float>(superSampleY) + UVOffset.y) * InvAALevel / outputSize.y
-                        };
-                        accumulatedColor += pattern_voronoi(uv, patternSize, points);
-                    }
-                }
-            } else { // MSAA or NONE
-                sampleCount = (AAType == EAAType::MSAA) ? AALevel : 1;
-                for (int i = 0; i < sampleCount; i++) {
-                    vec2f offset = (AAType == EAAType::MSAA) ? MSAA_SAMPLES[i] : vec2f();
-                    vec2f uv = {
-                        (static_cast<float>(x) + UVOffset.x + offset.x) / outputSize.x,
-                        (static_cast<float>(y) + UVOffset.y + offset.y) / outputSize.y
-                    };
-                    accumulatedColor += pattern_voronoi(uv, patternSize, points);
-                }
+    void EvaluateBatch(const SampleBatch& batch) const
+    {
+        if (analytic) {
+            for (int i = 0; i < batch.count; i++) {
+                const float coverage = circle_coverage_analytic(batch.u[i], batch.v[i], pixelUVSize, params);
+                batch.colors[i] = {coverage, coverage, coverage};
             }
-            pixels[y * outputSize.x + x] = accumulatedColor / static_cast<float>(sampleCount);
+            return;
+        }
+        kernels->circle(batch.u, batch.v, batch.count, params, batch.values);
+        for (int i = 0; i < batch.count; i++) {
+            batch.colors[i] = {batch.values[i], batch.values[i], batch.values[i]};
         }
     }
-    return pixels;
-}
 
+    // 거리는 sqrt(dx * dx + dy * dy) 라서 dx * dx 와 dy * dy 로 정해지고, 둘을 맞바꿔도 같다.
+    EPatternSymmetry GetSymmetry() const
+    {
+        return analytic ? EPatternSymmetry::NONE : EPatternSymmetry::SYMMETRIC;
+    }
 
-static std::vector<vec3f> apply_fxaa(const vec2i& outputSize, const std::vector<vec3f>& pixels)
-{
-    const vec3f LUMA_COEFF = {0.299f, 0.587f, 0.114f};
-    std::vector<float> luma(outputSize.x * outputSize.y);
-    for (int i = 0; i < pixels.size(); ++i) {
-        luma[i] = dot(pixels[i], LUMA_COEFF);
+    float GetAxisKey(int axis, float coord) const
+    {
+        const float d = (axis == 0) ? coord * params.size.x - params.center.x : coord * params.size.y - params.center.y;
+        return d * d;
     }
+};
 
-    std::vector<vec3f> edgePixels(outputSize.x * outputSize.y);
-    constexpr float edgeThreshold = 0.001f;
+struct VoronoiPattern
+{
+    vec2i patternSize;
+    EVoronoiLookup lookup;
+    std::vector<vec2f> points;
+    VoronoiSiteGrid grid;
+    VoronoiKernelParams params;
+    const PatternKernels* kernels;
+
+    // 사이트는 시드 1 의 VoronoiSiteRandom 으로 뽑으므로 같은 인자면 언제나 같은 사이트가 된다.
+    VoronoiPattern(const vec2i& outputSize, const EAAType AAType, const int AALevel, int numPoints, const EVoronoiLookup lookup)
+        : VoronoiPattern(outputSize, AAType, AALevel, generate_voronoi_sites(get_voronoi_pattern_size(outputSize, AAType, AALevel), numPoints), lookup)
+    {
+    }
 
-    for (int y = 1; y < outputSize.y - 1; ++y) {
-        for (int x = 1; x < outputSize.x - 1; ++x) {
-            const int index = y * outputSize.x + x;
+    // random 에서 이어서 사이트를 뽑는다. 여러 Voronoi 레이어가 한 난수열을 나눠 쓸 때 쓴다.
+    VoronoiPattern(const vec2i& outputSize, const EAAType AAType, const int AALevel, int numPoints, const EVoronoiLookup lookup, VoronoiSiteRandom& random)
+        : VoronoiPattern(outputSize, AAType, AALevel, generate_voronoi_sites(get_voronoi_pattern_size(outputSize, AAType, AALevel), numPoints, random), lookup)
+    {
+    }
 
-            const float lumaCenter = luma[index];
-            const float lumaNorth = luma[index - outputSize.x];
-            const float lumaSouth = luma[index + outputSize.x];
-            const float lumaWest = luma[index - 1];
-            const float lumaEast = luma[index + 1];
+    // sites 는 get_voronoi_pattern_size 해상도 기준 좌표. 애니메이션처럼 사이트를 직접 움직일 때 쓴다.
+    VoronoiPattern(const vec2i& outputSize, const EAAType AAType, const int AALevel, std::vector<vec2f> sites, const EVoronoiLookup lookup)
+        : patternSize(get_voronoi_pattern_size(outputSize, AAType, AALevel)), lookup(lookup), points(std::move(sites)), kernels(&GetPatternKernels())
+    {
+        // 사이트 인덱스는 렌더마다 한 번만 만든다.
+        if (lookup == EVoronoiLookup::GRID) {
+            grid.Build(points);
+        }
 
-            const float lumaMin = std::min({lumaCenter, lumaNorth, lumaSouth, lumaWest, lumaEast});
-            const float lumaMax = std::max({lumaCenter, lumaNorth, lumaSouth, lumaWest, lumaEast});
+        params.size = patternSize;
+        params.points = points.data();
+        params.numPoints = static_cast<int>(points.size());
+    }
 
-            const float deltaLuma = lumaMax - lumaMin;
+    // grid 가 points 를 가리키므로 복사/이동하지 않는다.
+    VoronoiPattern(const VoronoiPattern&) = delete;
+    VoronoiPattern& operator=(const VoronoiPattern&) = delete;
 
-            if (deltaLuma > edgeThreshold) {
-                const float lumaNW = luma[index - outputSize.x - 1];
-                const float lumaNE = luma[index - outputSize.x + 1];
-                const float lumaSW = luma[index + outputSize.x - 1];
-                const float lumaSE = luma[index + outputSize.x + 1];
+    void EvaluateBatch(const SampleBatch& batch) const
+    {
+        switch (lookup) {
+            case EVoronoiLookup::GRID:
+                for (int i = 0; i < batch.count; i++) {
+                    batch.colors[i] = pattern_voronoi({batch.u[i], batch.v[i]}, patternSize, points, grid);
+                }
+                break;
+            default:
+                kernels->voronoi(batch.u, batch.v, batch.count, params, batch.indices);
+                for (int i = 0; i < batch.count; i++) {
+                    const vec2f& closestPoint = points[batch.indices[i]];
+                    batch.colors[i] = {closestPoint.x / patternSize.x, closestPoint.y / patternSize.y, 0.f};
+                }
+                break;
+        }
+    }
+};
 
-                const float deltaX = std::abs((lumaNW + lumaSW) - (lumaNE + lumaSE));
-                const float deltaY = std::abs((lumaNW + lumaNE) - (lumaSW + lumaSE));
+// roi 를 받는 생성기는 outputSize 이미지 중 roi 영역만 roi 크기로 만든다. 값은 전체 이미지의 같은 위치와 같다.
+inline std::vector<vec3f> generate_uv_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, const RenderTile& roi)
+{
+    return render_pattern(outputSize, AAType, AALevel, UVPattern(outputSize), roi);
+}
 
-                const bool isHorizontal = deltaX > deltaY;
-                const vec2i dir = isHorizontal ? vec2i(1, 0) : vec2i(0, 1);
+inline std::vector<vec3f> generate_uv_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel)
+{
+    return generate_uv_pattern_data(outputSize, AAType, AALevel, RenderTile{{0, 0}, outputSize});
+}
 
-                float distForward = 0.f;
-                float distBackward = 0.f;
+inline std::vector<vec3f> generate_checkerboard_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, float angleDegrees, const vec2f& pivot, float tileSize, const RenderTile& roi)
+{
+    return render_pattern(outputSize, AAType, AALevel, CheckerboardPattern(outputSize, AAType, AALevel, angleDegrees, pivot, tileSize), roi);
+}
 
-                for (int i = 1; i < 10; ++i) {
-                    const int nextIndex = index + (dir.y * outputSize.x + dir.x) * i;
-                    if (nextIndex < 0 || nextIndex >= luma.size()) break;
-                    if (std::abs(luma[nextIndex] - lumaCenter) > edgeThreshold) {
-                        distForward = static_cast<float>(i);
-                        break;
-                    }
-                }
+inline std::vector<vec3f> generate_checkerboard_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, float angleDegrees, const vec2f& pivot, float tileSize)
+{
+    return generate_checkerboard_pattern_data(outputSize, AAType, AALevel, angleDegrees, pivot, tileSize, RenderTile{{0, 0}, outputSize});
+}
 
-                for (int i = 1; i < 10; ++i) {
-                    const int prevIndex = index - (dir.y * outputSize.x + dir.x) * i;
-                    if (prevIndex < 0 || prevIndex >= luma.size()) break;
-                    if (std::abs(luma[prevIndex] - lumaCenter) > edgeThreshold) {
-                        distBackward = static_cast<float>(i);
-                        break;
-                    }
-                }
+inline std::vector<vec3f> generate_circle_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, const float thickness, const float gap, const RenderTile& roi)
+{
+    return render_pattern(outputSize, AAType, AALevel, CirclePattern(outputSize, AAType, AALevel, thickness, gap), roi);
+}
 
-                const float totalDist = distForward + distBackward;
-                const float pixelOffset = (distForward - distBackward) / (2.f * totalDist) - 0.5f;
+inline std::vector<vec3f> generate_circle_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, const float thickness, const float gap)
+{
+    return generate_circle_pattern_data(outputSize, AAType, AALevel, thickness, gap, RenderTile{{0, 0}, outputSize});
+}
 
-                const int blendIndex = index + (dir.y * outputSize.x + dir.x) * static_cast<int>(pixelOffset);
-                if (blendIndex >= 0 && blendIndex < pixels.size()) {
-                    edgePixels[index] = (pixels[index] + pixels[blendIndex]) * 0.5f;
-                } else {
-                    edgePixels[index] = pixels[index];
-                }
+// 사이트는 항상 전체 outputSize 기준으로 뽑으므로 roi 가 달라도 같은 사이트 집합을 쓴다.
+inline std::vector<vec3f> generate_voronoi_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, int numPoints, const EVoronoiLookup lookup, const RenderTile& roi)
+{
+    const VoronoiPattern pattern(outputSize, AAType, AALevel, numPoints, lookup);
+    return render_pattern(outputSize, AAType, AALevel, pattern, roi);
+}
 
-            } else {
-                edgePixels[index] = pixels[index];
-            }
-        }
-    }
-    return edgePixels;
-}
\ No newline at end of file
+inline std::vector<vec3f> generate_voronoi_pattern_data(const vec2i& outputSize, const EAAType AAType, const int AALevel, int numPoints, const EVoronoiLookup lookup = EVoronoiLookup::GRID)
+{
+    return generate_voronoi_pattern_data(outputSize, AAType, AALevel, numPoints, lookup, RenderTile{{0, 0}, outputSize});
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "math.h"
+#include "pattern_simd.h"
+
+// 해석적(analytic) AA: 픽셀 하나를 덮는 정사각형 박스 필터로 패턴을 적분한 값을 닫힌 식으로 구한다.
+// 샘플은 픽셀 중심 하나만 받고, 픽셀 크기(pixelUVSize)는 uv 단위로 받는다.
+
+struct AnalyticPoint
+{
+    double x;
+    double y;
+};
+
+// 최대 꼭짓점 수: 사각형(4)을 축 정렬 사각형으로 자르면 변이 최대 4개 늘어난다.
+constexpr int ANALYTIC_MAX_POLYGON_VERTICES = 8;
+
+// 볼록 다각형을 반평면 하나로 자른다(Sutherland-Hodgman). axis 0 은 x, 1 은 y, keepGreater 면 좌표 >= limit 쪽을 남긴다.
+static int clip_polygon_axis(const AnalyticPoint* in, int count, int axis, double limit, bool keepGreater, AnalyticPoint* out)
+{
+    auto coord = [axis](const AnalyticPoint& p) { return axis == 0 ? p.x : p.y; };
+    auto inside = [&](const AnalyticPoint& p) { return keepGreater ? coord(p) >= limit : coord(p) <= limit; };
+
+    int outCount = 0;
+    for (int i = 0; i < count; ++i) {
+        const AnalyticPoint& current = in[i];
+        const AnalyticPoint& next = in[(i + 1) % count];
+        const bool currentInside = inside(current);
+        const bool nextInside = inside(next);
+        if (currentInside) {
+            out[outCount++] = current;
+        }
+        if (currentInside != nextInside) {
+            const double t = (limit - coord(current)) / (coord(next) - coord(current));
+            out[outCount++] = {current.x + (next.x - current.x) * t, current.y + (next.y - current.y) * t};
+        }
+    }
+    return outCount;
+}
+
+static double polygon_area(const AnalyticPoint* points, int count)
+{
+    double area = 0.0;
+    for (int i = 0; i < count; ++i) {
+        const AnalyticPoint& a = points[i];
+        const AnalyticPoint& b = points[(i + 1) % count];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return std::abs(area) * 0.5;
+}
+
+// 체커보드: 픽셀 사각형의 네 꼭짓점을 체커보드 칸 좌표(pos / step)로 옮기면 회전된 사각형이 된다.
+// 사각형이 한 칸 안에 있으면 그 칸의 색, 아니면 겹치는 칸마다 사각형을 잘라 흰 칸의 넓이 비율을 구한다.
+static float checkerboard_coverage_analytic(float u, float v, const vec2f& pixelUVSize, const CheckerboardKernelParams& params)
+{
+    const double halfU = 0.5 * pixelUVSize.x;
+    const double halfV = 0.5 * pixelUVSize.y;
+    const double cornersUV[4][2] = {{u - halfU, v - halfV}, {u + halfU, v - halfV}, {u + halfU, v + halfV}, {u - halfU, v + halfV}};
+
+    // checkerboard_sample_scalar 와 같은 변환을 double 로 한다.
+    AnalyticPoint polygon[4];
+    double minX = 0.0, maxX = 0.0, minY = 0.0, maxY = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        const double x = cornersUV[i][0] - params.pivot.x;
+        const double y = cornersUV[i][1] * params.aspectRatio - params.pivotYAspect;
+        const double rotatedX = params.rotation.m00 * x + params.rotation.m01 * y + params.pivot.x;
+        const double rotatedY = params.rotation.m10 * x + params.rotation.m11 * y + params.pivot.y;
+        polygon[i] = {rotatedX * params.size.x / params.step, rotatedY * params.size.y / params.step};
+        minX = (i == 0) ? polygon[i].x : std::min(minX, polygon[i].x);
+        maxX = (i == 0) ? polygon[i].x : std::max(maxX, polygon[i].x);
+        minY = (i == 0) ? polygon[i].y : std::min(minY, polygon[i].y);
+        maxY = (i == 0) ? polygon[i].y : std::max(maxY, polygon[i].y);
+    }
+
+    const int minCellX = static_cast<int>(std::floor(minX));
+    const int maxCellX = static_cast<int>(std::floor(maxX));
+    const int minCellY = static_cast<int>(std::floor(minY));
+    const int maxCellY = static_cast<int>(std::floor(maxY));
+    if (minCellX == maxCellX && minCellY == maxCellY) {
+        return ((minCellX + minCellY) & 1) ? 1.0f : 0.0f;
+    }
+
+    const double totalArea = polygon_area(polygon, 4);
+    if (totalArea <= 0.0) {
+        return checkerboard_sample_scalar(u, v, params);
+    }
+
+    double whiteArea = 0.0;
+    for (int cy = minCellY; cy <= maxCellY; ++cy) {
+        for (int cx = minCellX; cx <= maxCellX; ++cx) {
+            if (((cx + cy) & 1) == 0) {
+                continue;
+            }
+            AnalyticPoint bufferA[ANALYTIC_MAX_POLYGON_VERTICES];
+            AnalyticPoint bufferB[ANALYTIC_MAX_POLYGON_VERTICES];
+            int count = clip_polygon_axis(polygon, 4, 0, cx, true, bufferA);
+            count = clip_polygon_axis(bufferA, count, 0, cx + 1.0, false, bufferB);
+            count = clip_polygon_axis(bufferB, count, 1, cy, true, bufferA);
+            count = clip_polygon_axis(bufferA, count, 1, cy + 1.0, false, bufferB);
+            if (count >= 3) {
+                whiteArea += polygon_area(bufferB, count);
+            }
+        }
+    }
+    return static_cast<float>(clamp(whiteArea / totalArea, 0.0, 1.0));
+}
+
+// 원: 반지름 r 에서 fmod(r, period) > thickness 이면 1 인 주기 함수 g(r) 의 1차/2차 부정적분.
+// 중심을 지나는 픽셀은 음의 r 까지 적분하므로 g(-r) = g(r) 로 대칭 확장한다.
+static double circle_ring_integral(double r, double period, double thickness)
+{
+    if (r < 0.0) {
+        return -circle_ring_integral(-r, period, thickness);
+    }
+    const double k = std::floor(r / period);
+    const double remainder = r - k * period;
+    return k * (period - thickness) + std::max(remainder - thickness, 0.0);
+}
+
+static double circle_ring_integral2(double r, double period, double thickness)
+{
+    if (r < 0.0) {
+        return circle_ring_integral2(-r, period, thickness);
+    }
+    const double whiteWidth = period - thickness;
+    const double k = std::floor(r / period);
+    const double remainder = r - k * period;
+    const double fullPeriodWhite = 0.5 * whiteWidth * whiteWidth;
+    const double remainderWhite = std::max(remainder - thickness, 0.0);
+    return whiteWidth * period * k * (k - 1.0) * 0.5 + k * fullPeriodWhite + k * whiteWidth * remainder + 0.5 * remainderWhite * remainderWhite;
+}
+
+// 원: 픽셀 안에서 링 경계를 직선으로 보고(픽셀 크기에 비해 반지름이 크면 곡률 오차는 무시할 만하다),
+// 픽셀 사각형을 반지름 방향으로 투영한 사다리꼴 분포(폭 a, b 인 두 박스의 합성곱)로 g(r) 를 적분한다.
+static float circle_coverage_analytic(float u, float v, const vec2f& pixelUVSize, const CircleKernelParams& params)
+{
+    const double posX = static_cast<double>(u) * params.size.x - params.center.x;
+    const double posY = static_cast<double>(v) * params.size.y - params.center.y;
+    const double radius = std::sqrt(posX * posX + posY * posY);
+    const double pixelWidth = static_cast<double>(pixelUVSize.x) * params.size.x;
+    const double pixelHeight = static_cast<double>(pixelUVSize.y) * params.size.y;
+    const double period = params.period;
+    const double thickness = params.thickness;
+
+    double a = pixelWidth;
+    double b = 0.0;
+    if (radius > 0.0) {
+        a = std::abs(posX / radius) * pixelWidth;
+        b = std::abs(posY / radius) * pixelHeight;
+    }
+    if (a < b) {
+        std::swap(a, b);
+    }
+
+    // 축 정렬에 가까우면 박스 하나로 본다.
+    if (b < 1e-2 * a) {
+        return static_cast<float>(clamp((circle_ring_integral(radius + 0.5 * a, period, thickness) - circle_ring_integral(radius - 0.5 * a, period, thickness)) / a, 0.0, 1.0));
+    }
+
+    const double sum = circle_ring_integral2(radius + 0.5 * (a + b), period, thickness)
+        - circle_ring_integral2(radius + 0.5 * (a - b), period, thickness)
+        - circle_ring_integral2(radius - 0.5 * (a - b), period, thickness)
+        + circle_ring_integral2(radius - 0.5 * (a + b), period, thickness);
+    return static_cast<float>(clamp(sum / (a * b), 0.0, 1.0));
+}
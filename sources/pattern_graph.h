@@ -0,0 +1,364 @@
+#pragma once
+
+#include <cstdlib>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "math.h"
+#include "pattern.h"
+#include "sampler.h"
+
+// 여러 패턴 레이어를 마스크와 블렌드 연산으로 합친 합성 패턴.
+// 레이어들을 샘플 묶음마다 차례로 평가해 바로 섞으므로, N 개 레이어도 이미지 메모리는 한 번만 지나가고
+// 모든 레이어가 같은 AA 샘플 위치를 쓴다.
+//
+// 텍스트 형식: 한 줄(또는 ';' 로 나눈 조각)에 레이어 하나, "<source> key=value ...". '#' 뒤는 주석.
+//   source: uv, checkerboard, circle, voronoi, solid
+//   angle tile / thickness gap / sites voronoi=brute|grid : 패턴 파라미터(기본값은 단일 패턴과 같다)
+//   color=r,g,b   : solid 색, 다른 소스에는 곱하는 색
+//   blend=normal|multiply|add|subtract|screen|min|max, opacity=A
+//   mask=K        : K 번째(0부터) 레이어의 휘도를 불투명도에 곱한다. mask=!K 는 뒤집은 값
+//   hidden=1      : 섞지 않고 마스크로만 쓴다
+//   offset=x,y scale=S rotate=D : 이미지 중심 기준 레이어 변환(uv 단위, 가로세로 비율 유지)
+
+enum class ELayerSource {
+    UV,
+    CHECKERBOARD,
+    CIRCLE,
+    VORONOI,
+    SOLID
+};
+
+enum class EBlendMode {
+    NORMAL,
+    MULTIPLY,
+    ADD,
+    SUBTRACT,
+    SCREEN,
+    MIN,
+    MAX
+};
+
+struct PatternLayerDesc
+{
+    ELayerSource source = ELayerSource::UV;
+    float checkerboardAngle = 40.0f;
+    float checkerboardTileSize = 50.0f;
+    float circleThickness = 12.0f;
+    float circleGap = 7.0f;
+    int voronoiSiteCount = 100;
+    EVoronoiLookup voronoiLookup = EVoronoiLookup::GRID;
+    vec3f color = vec3f::One;
+    EBlendMode blend = EBlendMode::NORMAL;
+    float opacity = 1.0f;
+    int mask = -1;
+    bool invertMask = false;
+    bool hidden = false;
+    vec2f offset = {0.0f, 0.0f};
+    float scale = 1.0f;
+    float rotation = 0.0f;
+
+    bool HasTransform() const { return offset.x != 0.0f || offset.y != 0.0f || scale != 1.0f || rotation != 0.0f; }
+};
+
+struct PatternGraphDesc
+{
+    std::vector<PatternLayerDesc> layers;
+};
+
+static bool parse_vec_value(const std::string& value, float* out, int count)
+{
+    std::istringstream in(value);
+    for (int i = 0; i < count; ++i) {
+        if (i > 0 && in.get() != ',') {
+            return false;
+        }
+        if (!(in >> out[i])) {
+            return false;
+        }
+    }
+    return in.peek() == EOF;
+}
+
+// 레이어 한 줄을 읽는다. 모르는 소스나 키면 error 에 이유를 쓰고 false.
+static bool parse_pattern_layer(const std::string& line, int layerIndex, PatternLayerDesc& layer, std::string& error)
+{
+    std::istringstream in(line);
+    std::string source;
+    in >> source;
+    if (source == "uv") {
+        layer.source = ELayerSource::UV;
+    } else if (source == "checkerboard") {
+        layer.source = ELayerSource::CHECKERBOARD;
+    } else if (source == "circle") {
+        layer.source = ELayerSource::CIRCLE;
+    } else if (source == "voronoi") {
+        layer.source = ELayerSource::VORONOI;
+    } else if (source == "solid") {
+        layer.source = ELayerSource::SOLID;
+    } else {
+        error = "unknown layer source: " + source;
+        return false;
+    }
+
+    std::string token;
+    while (in >> token) {
+        const size_t equals = token.find('=');
+        if (equals == std::string::npos) {
+            error = "expected key=value: " + token;
+            return false;
+        }
+        const std::string key = token.substr(0, equals);
+        const std::string value = token.substr(equals + 1);
+        bool valid = true;
+        if (key == "angle") {
+            layer.checkerboardAngle = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "tile") {
+            layer.checkerboardTileSize = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "thickness") {
+            layer.circleThickness = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "gap") {
+            layer.circleGap = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "sites") {
+            layer.voronoiSiteCount = std::max(std::atoi(value.c_str()), 1);
+        } else if (key == "voronoi") {
+            if (value == "brute") {
+                layer.voronoiLookup = EVoronoiLookup::BRUTE_FORCE;
+            } else if (value == "grid") {
+                layer.voronoiLookup = EVoronoiLookup::GRID;
+            } else {
+                valid = false;
+            }
+        } else if (key == "color") {
+            valid = parse_vec_value(value, &layer.color.x, 3);
+        } else if (key == "blend") {
+            if (value == "normal") {
+                layer.blend = EBlendMode::NORMAL;
+            } else if (value == "multiply") {
+                layer.blend = EBlendMode::MULTIPLY;
+            } else if (value == "add") {
+                layer.blend = EBlendMode::ADD;
+            } else if (value == "subtract") {
+                layer.blend = EBlendMode::SUBTRACT;
+            } else if (value == "screen") {
+                layer.blend = EBlendMode::SCREEN;
+            } else if (value == "min") {
+                layer.blend = EBlendMode::MIN;
+            } else if (value == "max") {
+                layer.blend = EBlendMode::MAX;
+            } else {
+                valid = false;
+            }
+        } else if (key == "opacity") {
+            layer.opacity = clamp(static_cast<float>(std::atof(value.c_str())), 0.0f, 1.0f);
+        } else if (key == "mask") {
+            layer.invertMask = !value.empty() && value[0] == '!';
+            layer.mask = std::atoi(value.c_str() + (layer.invertMask ? 1 : 0));
+            // 앞 레이어만 마스크로 쓸 수 있다(평가 순서).
+            valid = layer.mask >= 0 && layer.mask < layerIndex;
+        } else if (key == "hidden") {
+            layer.hidden = std::atoi(value.c_str()) != 0;
+        } else if (key == "offset") {
+            valid = parse_vec_value(value, &layer.offset.x, 2);
+        } else if (key == "scale") {
+            layer.scale = static_cast<float>(std::atof(value.c_str()));
+            valid = layer.scale > 0.0f;
+        } else if (key == "rotate") {
+            layer.rotation = static_cast<float>(std::atof(value.c_str()));
+        } else {
+            error = "unknown layer key: " + key;
+            return false;
+        }
+        if (!valid) {
+            error = "bad value for " + key + ": " + value;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 줄바꿈이나 ';' 로 나눈 레이어 목록을 읽는다. 빈 줄과 '#' 주석은 건너뛴다.
+static bool parse_pattern_graph(std::istream& in, PatternGraphDesc& graph, std::string& error)
+{
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.resize(comment);
+        }
+        std::istringstream pieces(line);
+        std::string piece;
+        while (std::getline(pieces, piece, ';')) {
+            if (piece.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+            PatternLayerDesc layer;
+            if (!parse_pattern_layer(piece, static_cast<int>(graph.layers.size()), layer, error)) {
+                error = "layer " + std::to_string(graph.layers.size()) + ": " + error;
+                return false;
+            }
+            graph.layers.push_back(layer);
+        }
+    }
+    if (graph.layers.empty()) {
+        error = "no layers";
+        return false;
+    }
+    return true;
+}
+
+static bool parse_pattern_graph(const std::string& text, PatternGraphDesc& graph, std::string& error)
+{
+    std::istringstream in(text);
+    return parse_pattern_graph(in, graph, error);
+}
+
+inline bool load_pattern_graph(const char* filename, PatternGraphDesc& graph, std::string& error)
+{
+    std::ifstream in(filename);
+    if (!in) {
+        error = std::string("cannot open ") + filename;
+        return false;
+    }
+    return parse_pattern_graph(in, graph, error);
+}
+
+static float blend_channel(EBlendMode blend, float dst, float src)
+{
+    switch (blend) {
+        case EBlendMode::MULTIPLY: return dst * src;
+        case EBlendMode::ADD: return dst + src;
+        case EBlendMode::SUBTRACT: return dst - src;
+        case EBlendMode::SCREEN: return 1.0f - (1.0f - dst) * (1.0f - src);
+        case EBlendMode::MIN: return std::min(dst, src);
+        case EBlendMode::MAX: return std::max(dst, src);
+        default: return src;
+    }
+}
+
+static float layer_luminance(const vec3f& color)
+{
+    return 0.299f * color.x + 0.587f * color.y + 0.114f * color.z;
+}
+
+// PatternGraphDesc 를 렌더 드라이버가 받는 패턴 펑터로 만든다.
+// 레이어 패턴은 단일 패턴과 같은 생성자로 만들므로 SSAA 스케일링도 같다.
+// ANALYTIC 은 레이어마다 픽셀 적분값을 섞는다. 변환이 있는 레이어는 적분식이 맞지 않으므로 점 샘플로 평가한다.
+// Voronoi 레이어는 앞에서부터 차례로 시드 1 의 난수열 하나에서 사이트를 뽑는다.
+class CompositePattern
+{
+public:
+    CompositePattern(const vec2i& outputSize, const EAAType AAType, const int AALevel, const PatternGraphDesc& graph)
+        : aspectRatio(static_cast<float>(outputSize.y) / static_cast<float>(outputSize.x))
+    {
+        VoronoiSiteRandom siteRandom;
+        for (const PatternLayerDesc& desc : graph.layers) {
+            const EAAType layerAAType = (AAType == EAAType::ANALYTIC && desc.HasTransform()) ? EAAType::NONE : AAType;
+            Layer layer;
+            layer.desc = desc;
+            const float angle = DegreeToRadian(-desc.rotation);
+            layer.inverseTransform = mat2f{std::cos(angle), -std::sin(angle), std::sin(angle), std::cos(angle)} * (1.0f / desc.scale);
+            switch (desc.source) {
+                case ELayerSource::UV:
+                    layer.pattern.emplace<UVPattern>(outputSize);
+                    break;
+                case ELayerSource::CHECKERBOARD:
+                    layer.pattern.emplace<CheckerboardPattern>(outputSize, layerAAType, AALevel, desc.checkerboardAngle, vec2f{0.5f, 0.5f}, desc.checkerboardTileSize);
+                    break;
+                case ELayerSource::CIRCLE:
+                    layer.pattern.emplace<CirclePattern>(outputSize, layerAAType, AALevel, desc.circleThickness, desc.circleGap);
+                    break;
+                case ELayerSource::VORONOI:
+                    layer.pattern.emplace<std::unique_ptr<VoronoiPattern>>(std::make_unique<VoronoiPattern>(outputSize, layerAAType, AALevel, desc.voronoiSiteCount, desc.voronoiLookup, siteRandom));
+                    break;
+                case ELayerSource::SOLID:
+                    break;
+            }
+            layers.push_back(std::move(layer));
+        }
+    }
+
+    void EvaluateBatch(const SampleBatch& batch) const
+    {
+        // 레이어 결과는 마스크로 다시 읽을 수 있도록 레이어마다 둔다. 스레드마다 한 벌씩 재사용한다.
+        thread_local std::vector<vec3f> layerColors;
+        thread_local std::vector<float> layerU;
+        thread_local std::vector<float> layerV;
+        const size_t count = static_cast<size_t>(batch.count);
+        layerColors.resize(layers.size() * count);
+        layerU.resize(count);
+        layerV.resize(count);
+
+        std::fill(batch.colors, batch.colors + count, vec3f::Zero);
+        for (size_t l = 0; l < layers.size(); ++l) {
+            const Layer& layer = layers[l];
+            const PatternLayerDesc& desc = layer.desc;
+            vec3f* colors = layerColors.data() + l * count;
+
+            SampleBatch layerBatch = batch;
+            layerBatch.colors = colors;
+            if (desc.HasTransform()) {
+                // 가로세로 비율을 맞춘 공간에서 이미지 중심 기준으로 되돌린다.
+                const vec2f pivot = {0.5f, 0.5f * aspectRatio};
+                for (size_t i = 0; i < count; ++i) {
+                    const vec2f p = vec2f{batch.u[i] - desc.offset.x, (batch.v[i] - desc.offset.y) * aspectRatio} - pivot;
+                    const vec2f q = layer.inverseTransform * p + pivot;
+                    layerU[i] = q.x;
+                    layerV[i] = q.y / aspectRatio;
+                }
+                layerBatch.u = layerU.data();
+                layerBatch.v = layerV.data();
+            }
+            EvaluateLayer(layer, layerBatch);
+            if (desc.source != ELayerSource::SOLID && (desc.color.x != 1.0f || desc.color.y != 1.0f || desc.color.z != 1.0f)) {
+                for (size_t i = 0; i < count; ++i) {
+                    colors[i] = colors[i] * desc.color;
+                }
+            }
+            if (desc.hidden) {
+                continue;
+            }
+
+            const vec3f* maskColors = (desc.mask >= 0) ? layerColors.data() + static_cast<size_t>(desc.mask) * count : nullptr;
+            for (size_t i = 0; i < count; ++i) {
+                float alpha = desc.opacity;
+                if (maskColors) {
+                    const float maskValue = clamp(layer_luminance(maskColors[i]), 0.0f, 1.0f);
+                    alpha *= desc.invertMask ? 1.0f - maskValue : maskValue;
+                }
+                vec3f& dst = batch.colors[i];
+                const vec3f& src = colors[i];
+                const vec3f blended = {blend_channel(desc.blend, dst.x, src.x), blend_channel(desc.blend, dst.y, src.y), blend_channel(desc.blend, dst.z, src.z)};
+                dst = dst + (blended - dst) * alpha;
+            }
+        }
+    }
+
+private:
+    struct Layer
+    {
+        PatternLayerDesc desc;
+        mat2f inverseTransform;
+        // VoronoiPattern 은 옮길 수 없으므로 포인터로 둔다.
+        std::variant<std::monostate, UVPattern, CheckerboardPattern, CirclePattern, std::unique_ptr<VoronoiPattern>> pattern;
+    };
+
+    static void EvaluateLayer(const Layer& layer, const SampleBatch& batch)
+    {
+        switch (layer.pattern.index()) {
+            case 1: std::get<UVPattern>(layer.pattern).EvaluateBatch(batch); break;
+            case 2: std::get<CheckerboardPattern>(layer.pattern).EvaluateBatch(batch); break;
+            case 3: std::get<CirclePattern>(layer.pattern).EvaluateBatch(batch); break;
+            case 4: std::get<std::unique_ptr<VoronoiPattern>>(layer.pattern)->EvaluateBatch(batch); break;
+            default: std::fill(batch.colors, batch.colors + batch.count, layer.desc.color); break;
+        }
+    }
+
+    float aspectRatio;
+    std::vector<Layer> layers;
+};
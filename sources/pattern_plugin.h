@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "math.h"
+#include "pattern.h"
+#include "pattern_graph.h"
+#include "pattern_plugin_api.h"
+#include "sampler.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+
+// 패턴 플러그인(pattern_plugin_api.h) 을 읽어 렌더 드라이버의 패턴 펑터로 쓴다.
+// 내장 패턴(uv, checkerboard, circle, voronoi)도 같은 ABI 로 감싸 두어 "builtin:<이름>" 으로 고를 수 있고,
+// 외부 플러그인과 똑같이 샘플 행마다 evaluate 를 한 번 부르는 경로로 렌더된다.
+
+static_assert(sizeof(vec3f) == 3 * sizeof(float), "plugins write vec3f colors as packed floats");
+
+constexpr const char* BUILTIN_PATTERN_PLUGIN_PREFIX = "builtin:";
+
+// 내장 패턴 파라미터는 --layers 의 레이어 키(angle, tile, thickness, gap, sites, voronoi)와 같다.
+static bool parse_builtin_pattern_params(const char* source, const BasicAAPatternConfig& config, PatternLayerDesc& layer)
+{
+    std::string error;
+    return parse_pattern_layer(std::string(source) + " " + (config.params ? config.params : ""), 0, layer, error);
+}
+
+static vec2i get_plugin_output_size(const BasicAAPatternConfig& config)
+{
+    return {config.width, config.height};
+}
+
+static EAAType get_plugin_aa_type(const BasicAAPatternConfig& config)
+{
+    return static_cast<EAAType>(clamp(config.aaType, 0, static_cast<int>(EAAType::ADAPTIVE)));
+}
+
+static void* create_builtin_uv(const BasicAAPatternConfig* config)
+{
+    PatternLayerDesc layer;
+    if (!parse_builtin_pattern_params("uv", *config, layer)) {
+        return nullptr;
+    }
+    return new UVPattern(get_plugin_output_size(*config));
+}
+
+static void* create_builtin_checkerboard(const BasicAAPatternConfig* config)
+{
+    PatternLayerDesc layer;
+    if (!parse_builtin_pattern_params("checkerboard", *config, layer)) {
+        return nullptr;
+    }
+    return new CheckerboardPattern(get_plugin_output_size(*config), get_plugin_aa_type(*config), config->aaLevel, layer.checkerboardAngle, {0.5f, 0.5f}, layer.checkerboardTileSize);
+}
+
+static void* create_builtin_circle(const BasicAAPatternConfig* config)
+{
+    PatternLayerDesc layer;
+    if (!parse_builtin_pattern_params("circle", *config, layer)) {
+        return nullptr;
+    }
+    return new CirclePattern(get_plugin_output_size(*config), get_plugin_aa_type(*config), config->aaLevel, layer.circleThickness, layer.circleGap);
+}
+
+// 단일 렌더와 같은 사이트가 나오도록 같은 시드로 뽑는다.
+static void* create_builtin_voronoi(const BasicAAPatternConfig* config)
+{
+    PatternLayerDesc layer;
+    if (!parse_builtin_pattern_params("voronoi", *config, layer)) {
+        return nullptr;
+    }
+    return new VoronoiPattern(get_plugin_output_size(*config), get_plugin_aa_type(*config), config->aaLevel, layer.voronoiSiteCount, layer.voronoiLookup);
+}
+
+template<typename Pattern>
+static void destroy_builtin_pattern(void* instance)
+{
+    delete static_cast<Pattern*>(instance);
+}
+
+// SampleBatch 의 임시 버퍼(values/indices)는 ABI 에 없으므로 스레드마다 하나씩 둔다.
+template<typename Pattern>
+static void evaluate_builtin_pattern(const void* instance, const BasicAAPatternBatch* batch)
+{
+    thread_local std::vector<float> values;
+    thread_local std::vector<int> indices;
+    if (values.size() < static_cast<size_t>(batch->count)) {
+        values.resize(batch->count);
+        indices.resize(batch->count);
+    }
+
+    SampleBatch sampleBatch;
+    sampleBatch.u = batch->u;
+    sampleBatch.v = batch->v;
+    sampleBatch.count = batch->count;
+    sampleBatch.colors = reinterpret_cast<vec3f*>(batch->rgb);
+    sampleBatch.values = values.data();
+    sampleBatch.indices = indices.data();
+    static_cast<const Pattern*>(instance)->EvaluateBatch(sampleBatch);
+}
+
+static const BasicAAPatternPlugin BUILTIN_PATTERN_PLUGINS[] = {
+    {BASICAA_PATTERN_PLUGIN_ABI_VERSION, "uv", create_builtin_uv, destroy_builtin_pattern<UVPattern>, evaluate_builtin_pattern<UVPattern>},
+    {BASICAA_PATTERN_PLUGIN_ABI_VERSION, "checkerboard", create_builtin_checkerboard, destroy_builtin_pattern<CheckerboardPattern>, evaluate_builtin_pattern<CheckerboardPattern>},
+    {BASICAA_PATTERN_PLUGIN_ABI_VERSION, "circle", create_builtin_circle, destroy_builtin_pattern<CirclePattern>, evaluate_builtin_pattern<CirclePattern>},
+    {BASICAA_PATTERN_PLUGIN_ABI_VERSION, "voronoi", create_builtin_voronoi, destroy_builtin_pattern<VoronoiPattern>, evaluate_builtin_pattern<VoronoiPattern>},
+};
+
+static const BasicAAPatternPlugin* find_builtin_pattern_plugin(const std::string& name)
+{
+    for (const BasicAAPatternPlugin& plugin : BUILTIN_PATTERN_PLUGINS) {
+        if (name == plugin.name) {
+            return &plugin;
+        }
+    }
+    return nullptr;
+}
+
+// 플러그인 공유 라이브러리(.so/.dylib/.dll) 하나. "builtin:<이름>" 이면 라이브러리 없이 내장 패턴을 쓴다.
+// 플러그인으로 만든 PluginPattern 보다 오래 살아 있어야 한다.
+class PatternPluginLibrary
+{
+public:
+    PatternPluginLibrary() = default;
+    ~PatternPluginLibrary() { Close(); }
+
+    PatternPluginLibrary(const PatternPluginLibrary&) = delete;
+    PatternPluginLibrary& operator=(const PatternPluginLibrary&) = delete;
+
+    // 읽지 못했거나 ABI 버전이 다르면 error 에 이유를 쓰고 false.
+    bool Open(const std::string& path, std::string& error)
+    {
+        Close();
+        if (path.rfind(BUILTIN_PATTERN_PLUGIN_PREFIX, 0) == 0) {
+            plugin = find_builtin_pattern_plugin(path.substr(std::string(BUILTIN_PATTERN_PLUGIN_PREFIX).size()));
+            if (!plugin) {
+                error = "unknown builtin pattern: " + path;
+                return false;
+            }
+            return true;
+        }
+
+        BasicAAPatternPluginEntry entry = nullptr;
+#if defined(_WIN32)
+        handle = LoadLibraryA(path.c_str());
+        if (!handle) {
+            error = "cannot load " + path;
+            return false;
+        }
+        entry = reinterpret_cast<BasicAAPatternPluginEntry>(GetProcAddress(static_cast<HMODULE>(handle), BASICAA_PATTERN_PLUGIN_ENTRY));
+#elif defined(__unix__) || defined(__APPLE__)
+        handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            const char* reason = dlerror();
+            error = reason ? reason : "cannot load " + path;
+            return false;
+        }
+        entry = reinterpret_cast<BasicAAPatternPluginEntry>(dlsym(handle, BASICAA_PATTERN_PLUGIN_ENTRY));
+#else
+        error = "plugins are not supported on this platform";
+        return false;
+#endif
+        if (!entry) {
+            error = path + " does not export " + BASICAA_PATTERN_PLUGIN_ENTRY;
+            Close();
+            return false;
+        }
+        plugin = entry();
+        if (!plugin || plugin->abiVersion != BASICAA_PATTERN_PLUGIN_ABI_VERSION) {
+            error = path + ": plugin ABI version " + std::to_string(plugin ? plugin->abiVersion : 0) + ", expected " + std::to_string(BASICAA_PATTERN_PLUGIN_ABI_VERSION);
+            Close();
+            return false;
+        }
+        if (!plugin->create || !plugin->destroy || !plugin->evaluate) {
+            error = path + ": plugin table is incomplete";
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        plugin = nullptr;
+        if (!handle) {
+            return;
+        }
+#if defined(_WIN32)
+        FreeLibrary(static_cast<HMODULE>(handle));
+#elif defined(__unix__) || defined(__APPLE__)
+        dlclose(handle);
+#endif
+        handle = nullptr;
+    }
+
+    const BasicAAPatternPlugin* GetPlugin() const { return plugin; }
+
+private:
+    void* handle = nullptr;
+    const BasicAAPatternPlugin* plugin = nullptr;
+};
+
+// 플러그인 인스턴스 하나를 감싼 패턴 펑터. 샘플 행마다 evaluate 를 한 번 부르고,
+// 색은 복사 없이 batch.colors 에 바로 쓰게 한다. 인스턴스를 만들지 못했으면(IsValid 가 false) 검은색을 낸다.
+class PluginPattern
+{
+public:
+    PluginPattern(const BasicAAPatternPlugin& plugin, const vec2i& outputSize, const EAAType AAType, const int AALevel, const std::string& params)
+        : plugin(&plugin)
+    {
+        BasicAAPatternConfig config;
+        config.width = outputSize.x;
+        config.height = outputSize.y;
+        config.aaType = static_cast<int>(AAType);
+        config.aaLevel = AALevel;
+        config.params = params.c_str();
+        instance = plugin.create(&config);
+    }
+
+    ~PluginPattern()
+    {
+        if (instance) {
+            plugin->destroy(instance);
+        }
+    }
+
+    PluginPattern(const PluginPattern&) = delete;
+    PluginPattern& operator=(const PluginPattern&) = delete;
+
+    bool IsValid() const { return instance != nullptr; }
+
+    void EvaluateBatch(const SampleBatch& batch) const
+    {
+        if (!instance) {
+            std::fill(batch.colors, batch.colors + batch.count, vec3f::Zero);
+            return;
+        }
+        BasicAAPatternBatch pluginBatch;
+        pluginBatch.u = batch.u;
+        pluginBatch.v = batch.v;
+        pluginBatch.count = batch.count;
+        pluginBatch.rgb = reinterpret_cast<float*>(batch.colors);
+        plugin->evaluate(instance, &pluginBatch);
+    }
+
+private:
+    const BasicAAPatternPlugin* plugin;
+    void* instance = nullptr;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+// 런타임에 읽어 들이는 패턴 플러그인의 C ABI. 플러그인은 이 헤더만 포함하고
+// BASICAA_PATTERN_PLUGIN_ENTRY 이름의 함수를 내보내 BasicAAPatternPlugin 을 돌려준다.
+// evaluate 는 샘플 한 개가 아니라 샘플 행 하나(수백~수천 개)를 한 번에 받으므로 호출 비용이 샘플 수에 묻힌다.
+
+#define BASICAA_PATTERN_PLUGIN_ABI_VERSION 1
+#define BASICAA_PATTERN_PLUGIN_ENTRY "basicaa_pattern_plugin"
+
+#if defined(_WIN32)
+#define BASICAA_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define BASICAA_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 렌더 설정. aaType 은 0 none, 1 ssaa, 2 msaa, 3 fxaa, 4 analytic, 5 adaptive.
+// params 는 --plugin-params 문자열이다(없으면 빈 문자열).
+typedef struct BasicAAPatternConfig
+{
+    int width;
+    int height;
+    int aaType;
+    int aaLevel;
+    const char* params;
+} BasicAAPatternConfig;
+
+// 샘플 묶음. u/v 는 이미지 전체 기준 [0, 1] 좌표, rgb 에 샘플마다 float 3개를 쓴다.
+typedef struct BasicAAPatternBatch
+{
+    const float* u;
+    const float* v;
+    int count;
+    float* rgb;
+} BasicAAPatternBatch;
+
+typedef struct BasicAAPatternPlugin
+{
+    int abiVersion;     // BASICAA_PATTERN_PLUGIN_ABI_VERSION
+    const char* name;
+    // 렌더 설정마다 인스턴스를 하나 만든다. 실패하면 NULL.
+    void* (*create)(const BasicAAPatternConfig* config);
+    void (*destroy)(void* instance);
+    // 여러 스레드가 같은 인스턴스로 동시에 부르므로 인스턴스를 바꾸지 않아야 한다.
+    void (*evaluate)(const void* instance, const BasicAAPatternBatch* batch);
+} BasicAAPatternPlugin;
+
+typedef const BasicAAPatternPlugin* (*BasicAAPatternPluginEntry)(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,890 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "math.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PATTERN_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define PATTERN_SIMD_TARGET_AVX2
+#define PATTERN_SIMD_TARGET_AVX512
+#else
+#define PATTERN_SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define PATTERN_SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#else
+#define PATTERN_SIMD_X86 0
+#endif
+
+// 패턴 커널의 배치(SoA) 버전.
+// u[i], v[i] 는 generate_*_pattern_data 가 만드는 샘플 uv 좌표이고, 결과는 out[i] 에 쓴다.
+// AVX2 는 8개, AVX-512 는 16개씩 처리하고 남는 샘플은 스칼라로 처리한다.
+// 모든 구현은 pattern.h 의 스칼라 함수와 같은 순서로 연산하므로 결과가 비트 단위로 같다.
+
+enum class ESimdLevel {
+    AUTO,
+    SCALAR,
+    AVX2,
+    AVX512
+};
+
+struct CheckerboardKernelParams
+{
+    float aspectRatio;
+    vec2f pivot;
+    float pivotYAspect;  // pivot.y * aspectRatio
+    mat2f rotation;
+    vec2f size;
+    float step;          // 타일 한 칸의 픽셀 크기(<=0 이면 10)
+};
+
+struct CircleKernelParams
+{
+    vec2f size;
+    vec2f center;
+    float thickness;
+    float period;        // thickness + gap
+};
+
+struct VoronoiKernelParams
+{
+    vec2f size;
+    const vec2f* points;
+    int numPoints;
+};
+
+// FXAA 한 행. 행 포인터는 픽셀 0 을 가리키고 north, center, south 는 [-1], [count] 도 읽을 수 있다.
+// forwardRows[j], backwardRows[j] 는 j + 1 칸 아래, 위 행이며 이미지 밖이면 center 를 가리킨다(끝점이 없다).
+// 가로 끝점 탐색은 center 행을 앞뒤 9칸(이미지 안쪽만) 읽는다.
+struct FXAARowParams
+{
+    const float* north;
+    const float* center;
+    const float* south;
+    const float* forwardRows[9];
+    const float* backwardRows[9];
+    int column;     // 픽셀 0 의 이미지 x
+    int imageWidth;
+    float threshold;
+};
+
+// FXAA 가 픽셀을 바꾸는 경우. 섞을 픽셀은 가장자리 방향으로 한 칸 앞(왼쪽 또는 위)이다.
+struct FXAABlend
+{
+    int index;
+    bool vertical;
+};
+
+// 체커보드/원: 샘플당 0 또는 1 을 out 에 쓴다. 보로노이: 가장 가까운 사이트 인덱스를 outSite 에 쓴다.
+// 휘도(FXAA): 픽셀 count 개의 휘도를 out 에 쓴다.
+// 밉맵 가로 필터: out[j] = sum_k source[indices[k * stride + j]] * weights[k * stride + j] 를 k 순서로 더한다(j < count).
+// 밉맵 가로 2:1 필터: 출력 픽셀 x 의 채널 c 는 sum_k source[(2x + k) * 3 + c] * weights[k] 를 k 순서로 더한다(x < count).
+// source 에서 읽을 수 있는 float 은 sourceCount 개다.
+// 밉맵 세로 필터: out[j] = sum_k rows[k][j] * weights[k] 를 k 순서로 더한다.
+// FXAA 행: 대비가 있는 픽셀 수를 반환하고, 그중 색이 바뀌는 픽셀을 오름차순으로 blends 에 쓴다(blendCount).
+// 대비는 상하좌우 휘도의 최댓값 - 최솟값이 threshold 보다 큰 것이고, 대각 휘도로 가장자리 방향을 정해 앞뒤 9칸까지
+// 휘도 차이가 threshold 보다 큰 끝점을 찾는다. 끝점 거리 forward, backward 로 만든 섞기 오프셋
+// (forward - backward) / (2 * (forward + backward)) - 0.5 를 정수로 자르면 forward 가 0 이고 backward 가 있을 때만 -1 이고
+// 나머지는 0 이다. 오프셋 0 은 자기 자신과 섞는 것이라 값이 그대로이므로, 앞쪽 끝점 없이 뒤쪽 끝점만 있는 픽셀만 바뀐다.
+// 선형 8비트 양자화: out[i] = (int)(clamp(values[i], 0, 1) * scale + 0.5f) 로 PixelEncoder::Encode 와 같다.
+struct PatternKernels
+{
+    ESimdLevel level;
+    const char* name;
+    void (*checkerboard)(const float* u, const float* v, int count, const CheckerboardKernelParams& params, float* out);
+    void (*circle)(const float* u, const float* v, int count, const CircleKernelParams& params, float* out);
+    void (*voronoi)(const float* u, const float* v, int count, const VoronoiKernelParams& params, int* outSite);
+    void (*luma)(const vec3f* pixels, int count, float* out);
+    void (*mipRow)(const float* source, const int* indices, const float* weights, int tapCount, int stride, int count, float* out);
+    void (*mipRowHalf)(const float* source, int sourceCount, const float* weights, int tapCount, int count, float* out);
+    void (*mipColumn)(const float* const* rows, const float* weights, int tapCount, int count, float* out);
+    int (*fxaaRow)(const FXAARowParams& params, int count, FXAABlend* blends, int& blendCount);
+    void (*quantizeUnorm8)(const float* values, size_t count, float scale, unsigned char* out);
+};
+
+// FXAA 휘도 계수(R, G, B).
+constexpr float LUMA_COEFF_R = 0.299f;
+constexpr float LUMA_COEFF_G = 0.587f;
+constexpr float LUMA_COEFF_B = 0.114f;
+
+static_assert(sizeof(vec3f) == 3 * sizeof(float), "luma kernels read vec3f as packed floats");
+
+static float checkerboard_sample_scalar(float u, float v, const CheckerboardKernelParams& params)
+{
+    vec2f uv = {u, v};
+    uv.y *= params.aspectRatio;
+    uv = uv - vec2f{params.pivot.x, params.pivotYAspect};
+    uv = params.rotation * uv;
+    uv = uv + params.pivot;
+
+    const vec2f pos = uv * params.size;
+    const int cx = static_cast<int>(std::floor(pos.x / params.step));
+    const int cy = static_cast<int>(std::floor(pos.y / params.step));
+    return ((cx + cy) & 1) ? 1.0f : 0.0f;
+}
+
+static float circle_sample_scalar(float u, float v, const CircleKernelParams& params)
+{
+    const vec2f pos = vec2f{u, v} * params.size;
+    const float dist = length(pos - params.center);
+    const float remainder = std::fmod(dist, params.period);
+    return remainder > params.thickness ? 1.f : 0.f;
+}
+
+static int voronoi_sample_scalar(float u, float v, const VoronoiKernelParams& params)
+{
+    const vec2f pos = vec2f{u, v} * params.size;
+    int closest = 0;
+    float minDist = std::numeric_limits<float>::max();
+    for (int i = 0; i < params.numPoints; ++i) {
+        const float dist = length(pos - params.points[i]);
+        if (dist < minDist) {
+            minDist = dist;
+            closest = i;
+        }
+    }
+    return closest;
+}
+
+static void checkerboard_batch_scalar(const float* u, const float* v, int count, const CheckerboardKernelParams& params, float* out)
+{
+    for (int i = 0; i < count; ++i) {
+        out[i] = checkerboard_sample_scalar(u[i], v[i], params);
+    }
+}
+
+static void circle_batch_scalar(const float* u, const float* v, int count, const CircleKernelParams& params, float* out)
+{
+    for (int i = 0; i < count; ++i) {
+        out[i] = circle_sample_scalar(u[i], v[i], params);
+    }
+}
+
+static void voronoi_batch_scalar(const float* u, const float* v, int count, const VoronoiKernelParams& params, int* outSite)
+{
+    for (int i = 0; i < count; ++i) {
+        outSite[i] = voronoi_sample_scalar(u[i], v[i], params);
+    }
+}
+
+// dot(pixel, {R, G, B}) 와 같은 순서로 계산한다.
+static void luma_batch_scalar(const vec3f* pixels, int count, float* out)
+{
+    for (int i = 0; i < count; ++i) {
+        out[i] = pixels[i].x * LUMA_COEFF_R + pixels[i].y * LUMA_COEFF_G + pixels[i].z * LUMA_COEFF_B;
+    }
+}
+
+static void mip_row_batch_scalar(const float* source, const int* indices, const float* weights, int tapCount, int stride, int count, float* out)
+{
+    for (int j = 0; j < count; ++j) {
+        float sum = 0.0f;
+        for (int k = 0; k < tapCount; ++k) {
+            const size_t tap = static_cast<size_t>(k) * stride + j;
+            sum += source[indices[tap]] * weights[tap];
+        }
+        out[j] = sum;
+    }
+}
+
+// 출력마다 필요한 탭만 읽으므로 읽을 수 있는 범위(sourceCount)는 SIMD 구현만 본다.
+static void mip_row_half_batch_scalar(const float* source, int /*sourceCount*/, const float* weights, int tapCount, int count, float* out)
+{
+    for (int j = 0; j < count * 3; ++j) {
+        const float* taps = source + (j / 3) * 6 + j % 3;
+        float sum = 0.0f;
+        for (int k = 0; k < tapCount; ++k) {
+            sum += taps[k * 3] * weights[k];
+        }
+        out[j] = sum;
+    }
+}
+
+// 픽셀 i 의 대비, 가장자리 방향, 끝점을 차례로 검사한다. 대비가 없으면 false. SIMD 구현의 나머지 처리에도 쓴다.
+static bool fxaa_pixel_scalar(const FXAARowParams& params, int i, FXAABlend* blends, int& blendCount)
+{
+    const float* north = params.north;
+    const float* center = params.center;
+    const float* south = params.south;
+    const float lumaMin = std::min(std::min(std::min(center[i], north[i]), std::min(south[i], center[i - 1])), center[i + 1]);
+    const float lumaMax = std::max(std::max(std::max(center[i], north[i]), std::max(south[i], center[i - 1])), center[i + 1]);
+    if (!((lumaMax - lumaMin) > params.threshold)) {
+        return false;
+    }
+
+    const float deltaX = std::abs((north[i - 1] + south[i - 1]) - (north[i + 1] + south[i + 1]));
+    const float deltaY = std::abs((north[i - 1] + north[i + 1]) - (south[i - 1] + south[i + 1]));
+    const bool isHorizontal = deltaX > deltaY;
+    const int x = params.column + i;
+    auto hasEndpoint = [&](const float* const* rows, int direction, int horizontalLimit) {
+        for (int j = 1; j <= 9; ++j) {
+            if (isHorizontal && j > horizontalLimit) {
+                return false;
+            }
+            const float luma = isHorizontal ? center[i + direction * j] : rows[j - 1][i];
+            if (std::abs(luma - center[i]) > params.threshold) {
+                return true;
+            }
+        }
+        return false;
+    };
+    if (!hasEndpoint(params.forwardRows, 1, params.imageWidth - 1 - x) && hasEndpoint(params.backwardRows, -1, x)) {
+        blends[blendCount++] = {i, !isHorizontal};
+    }
+    return true;
+}
+
+static int fxaa_row_range_scalar(const FXAARowParams& params, int first, int count, FXAABlend* blends, int& blendCount)
+{
+    int edgeCount = 0;
+    for (int i = first; i < count; ++i) {
+        edgeCount += fxaa_pixel_scalar(params, i, blends, blendCount) ? 1 : 0;
+    }
+    return edgeCount;
+}
+
+static int fxaa_row_batch_scalar(const FXAARowParams& params, int count, FXAABlend* blends, int& blendCount)
+{
+    blendCount = 0;
+    return fxaa_row_range_scalar(params, 0, count, blends, blendCount);
+}
+
+static void quantize_unorm8_batch_scalar(const float* values, size_t count, float scale, unsigned char* out)
+{
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<unsigned char>(static_cast<int>(clamp(values[i], 0.0f, 1.0f) * scale + 0.5f));
+    }
+}
+
+static void mip_column_batch_scalar(const float* const* rows, const float* weights, int tapCount, int count, float* out)
+{
+    for (int j = 0; j < count; ++j) {
+        float sum = 0.0f;
+        for (int k = 0; k < tapCount; ++k) {
+            sum += rows[k][j] * weights[k];
+        }
+        out[j] = sum;
+    }
+}
+
+#if PATTERN_SIMD_X86
+
+// fmod 를 double 로 정확히 계산한다. float 두 값의 몫을 double 로 버림하면 실제 정수 몫과 같고,
+// dist - q * period 는 float 로 표현 가능한 정확한 나머지라서 반올림 없이 std::fmod 와 같아진다.
+PATTERN_SIMD_TARGET_AVX2 static __m128 fmod_exact_avx2(__m128 dist, __m256d period)
+{
+    const __m256d d = _mm256_cvtps_pd(dist);
+    const __m256d q = _mm256_round_pd(_mm256_div_pd(d, period), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    return _mm256_cvtpd_ps(_mm256_sub_pd(d, _mm256_mul_pd(q, period)));
+}
+
+PATTERN_SIMD_TARGET_AVX2 static void checkerboard_batch_avx2(const float* u, const float* v, int count, const CheckerboardKernelParams& params, float* out)
+{
+    const __m256 aspect = _mm256_set1_ps(params.aspectRatio);
+    const __m256 pivotX = _mm256_set1_ps(params.pivot.x);
+    const __m256 pivotY = _mm256_set1_ps(params.pivot.y);
+    const __m256 pivotYAspect = _mm256_set1_ps(params.pivotYAspect);
+    const __m256 m00 = _mm256_set1_ps(params.rotation.m00);
+    const __m256 m01 = _mm256_set1_ps(params.rotation.m01);
+    const __m256 m10 = _mm256_set1_ps(params.rotation.m10);
+    const __m256 m11 = _mm256_set1_ps(params.rotation.m11);
+    const __m256 sizeX = _mm256_set1_ps(params.size.x);
+    const __m256 sizeY = _mm256_set1_ps(params.size.y);
+    const __m256 step = _mm256_set1_ps(params.step);
+    const __m256i one = _mm256_set1_epi32(1);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_sub_ps(_mm256_loadu_ps(u + i), pivotX);
+        const __m256 y = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(v + i), aspect), pivotYAspect);
+        const __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, x), _mm256_mul_ps(m01, y)), pivotX);
+        const __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m10, x), _mm256_mul_ps(m11, y)), pivotY);
+        const __m256i cx = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_div_ps(_mm256_mul_ps(rx, sizeX), step)));
+        const __m256i cy = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_div_ps(_mm256_mul_ps(ry, sizeY), step)));
+        const __m256i parity = _mm256_and_si256(_mm256_add_epi32(cx, cy), one);
+        _mm256_storeu_ps(out + i, _mm256_cvtepi32_ps(parity));
+    }
+    checkerboard_batch_scalar(u + i, v + i, count - i, params, out + i);
+}
+
+PATTERN_SIMD_TARGET_AVX2 static void circle_batch_avx2(const float* u, const float* v, int count, const CircleKernelParams& params, float* out)
+{
+    const __m256 sizeX = _mm256_set1_ps(params.size.x);
+    const __m256 sizeY = _mm256_set1_ps(params.size.y);
+    const __m256 centerX = _mm256_set1_ps(params.center.x);
+    const __m256 centerY = _mm256_set1_ps(params.center.y);
+    const __m256 thickness = _mm256_set1_ps(params.thickness);
+    const __m256d period = _mm256_set1_pd(params.period);
+    const __m256 one = _mm256_set1_ps(1.f);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 dx = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(u + i), sizeX), centerX);
+        const __m256 dy = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(v + i), sizeY), centerY);
+        const __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        const __m128 remLo = fmod_exact_avx2(_mm256_castps256_ps128(dist), period);
+        const __m128 remHi = fmod_exact_avx2(_mm256_extractf128_ps(dist, 1), period);
+        const __m256 remainder = _mm256_insertf128_ps(_mm256_castps128_ps256(remLo), remHi, 1);
+        _mm256_storeu_ps(out + i, _mm256_and_ps(_mm256_cmp_ps(remainder, thickness, _CMP_GT_OQ), one));
+    }
+    circle_batch_scalar(u + i, v + i, count - i, params, out + i);
+}
+
+PATTERN_SIMD_TARGET_AVX2 static void voronoi_batch_avx2(const float* u, const float* v, int count, const VoronoiKernelParams& params, int* outSite)
+{
+    const __m256 sizeX = _mm256_set1_ps(params.size.x);
+    const __m256 sizeY = _mm256_set1_ps(params.size.y);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 px = _mm256_mul_ps(_mm256_loadu_ps(u + i), sizeX);
+        const __m256 py = _mm256_mul_ps(_mm256_loadu_ps(v + i), sizeY);
+        __m256 minDist = _mm256_set1_ps(std::numeric_limits<float>::max());
+        __m256 closest = _mm256_setzero_ps();
+        for (int j = 0; j < params.numPoints; ++j) {
+            const __m256 dx = _mm256_sub_ps(px, _mm256_set1_ps(params.points[j].x));
+            const __m256 dy = _mm256_sub_ps(py, _mm256_set1_ps(params.points[j].y));
+            const __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+            const __m256 closer = _mm256_cmp_ps(dist, minDist, _CMP_LT_OQ);
+            minDist = _mm256_blendv_ps(minDist, dist, closer);
+            closest = _mm256_blendv_ps(closest, _mm256_castsi256_ps(_mm256_set1_epi32(j)), closer);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(outSite + i), _mm256_castps_si256(closest));
+    }
+    voronoi_batch_scalar(u + i, v + i, count - i, params, outSite + i);
+}
+
+// RGB 가 섞여 있는 픽셀 8개(float 24개)를 세 번 읽고, 채널마다 블렌드 두 번과 순열 한 번으로 모은다.
+// 채널 c 의 k 번째 값은 (3k + c) 번째 float 이라서 세 레지스터에서 서로 다른 칸에 있다.
+PATTERN_SIMD_TARGET_AVX2 static void luma_batch_avx2(const vec3f* pixels, int count, float* out)
+{
+    const float* data = reinterpret_cast<const float*>(pixels);
+    const __m256i permuteR = _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5);
+    const __m256i permuteG = _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6);
+    const __m256i permuteB = _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7);
+    const __m256 coeffR = _mm256_set1_ps(LUMA_COEFF_R);
+    const __m256 coeffG = _mm256_set1_ps(LUMA_COEFF_G);
+    const __m256 coeffB = _mm256_set1_ps(LUMA_COEFF_B);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const float* base = data + static_cast<size_t>(i) * 3;
+        const __m256 m0 = _mm256_loadu_ps(base);
+        const __m256 m1 = _mm256_loadu_ps(base + 8);
+        const __m256 m2 = _mm256_loadu_ps(base + 16);
+        const __m256 r = _mm256_permutevar8x32_ps(_mm256_blend_ps(_mm256_blend_ps(m0, m1, 0x92), m2, 0x24), permuteR);
+        const __m256 g = _mm256_permutevar8x32_ps(_mm256_blend_ps(_mm256_blend_ps(m0, m1, 0x24), m2, 0x49), permuteG);
+        const __m256 b = _mm256_permutevar8x32_ps(_mm256_blend_ps(_mm256_blend_ps(m0, m1, 0x49), m2, 0x92), permuteB);
+        const __m256 luma = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, coeffR), _mm256_mul_ps(g, coeffG)), _mm256_mul_ps(b, coeffB));
+        _mm256_storeu_ps(out + i, luma);
+    }
+    luma_batch_scalar(pixels + i, count - i, out + i);
+}
+
+PATTERN_SIMD_TARGET_AVX2 static void mip_row_batch_avx2(const float* source, const int* indices, const float* weights, int tapCount, int stride, int count, float* out)
+{
+    int j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (int k = 0; k < tapCount; ++k) {
+            const size_t tap = static_cast<size_t>(k) * stride + j;
+            const __m256 value = _mm256_i32gather_ps(source, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + tap)), 4);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(value, _mm256_loadu_ps(weights + tap)));
+        }
+        _mm256_storeu_ps(out + j, sum);
+    }
+    mip_row_batch_scalar(source, indices + j, weights + j, tapCount, stride, count - j, out + j);
+}
+
+// 출력 float j(픽셀 j / 3, 채널 j % 3)가 읽는 첫 탭은 source 의 (j / 3) * 6 + j % 3 번째 float 이다.
+// 출력 4개는 연속한 8개 안에 있으므로, 출력 8개마다 두 번 읽어 각각 순열로 모으고 아래 128비트를 합친다.
+// 순열은 출력 픽셀 4개(float 12개)마다 반복된다.
+PATTERN_SIMD_TARGET_AVX2 static void mip_row_half_batch_avx2(const float* source, int sourceCount, const float* weights, int tapCount, int count, float* out)
+{
+    static constexpr int Bases[6] = {0, 7, 14, 24, 31, 38};
+    const __m256i permutes[3] = {
+        _mm256_setr_epi32(0, 1, 2, 6, 0, 0, 0, 0),
+        _mm256_setr_epi32(0, 1, 5, 6, 0, 0, 0, 0),
+        _mm256_setr_epi32(0, 4, 5, 6, 0, 0, 0, 0)
+    };
+
+    // 출력 픽셀 8개는 원본 픽셀 16개(+ 탭)를 읽는다. 마지막 순열은 Bases[5] + 8 번째 float 앞까지 읽는다.
+    int x = 0;
+    for (; x + 8 <= count && x * 6 + (tapCount - 1) * 3 + Bases[5] + 8 <= sourceCount; x += 8) {
+        const float* block = source + x * 6;
+        __m256 sums[3] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+        for (int k = 0; k < tapCount; ++k) {
+            const float* taps = block + k * 3;
+            const __m256 weight = _mm256_set1_ps(weights[k]);
+            for (int v = 0; v < 3; ++v) {
+                const __m256 low = _mm256_permutevar8x32_ps(_mm256_loadu_ps(taps + Bases[v * 2]), permutes[(v * 2) % 3]);
+                const __m256 high = _mm256_permutevar8x32_ps(_mm256_loadu_ps(taps + Bases[v * 2 + 1]), permutes[(v * 2 + 1) % 3]);
+                sums[v] = _mm256_add_ps(sums[v], _mm256_mul_ps(_mm256_permute2f128_ps(low, high, 0x20), weight));
+            }
+        }
+        for (int v = 0; v < 3; ++v) {
+            _mm256_storeu_ps(out + x * 3 + v * 8, sums[v]);
+        }
+    }
+    mip_row_half_batch_scalar(source + x * 6, sourceCount - x * 6, weights, tapCount, count - x, out + x * 3);
+}
+
+// 레인마다 가로(horizontal)면 center 행, 세로면 rows 를 따라 9칸 안에 끝점이 있는지 비트로 돌려준다.
+PATTERN_SIMD_TARGET_AVX2 static unsigned fxaa_endpoints_avx2(const float* center, const float* const* rows, int i, int direction, __m256 horizontal, float threshold)
+{
+    const __m256 thresholds = _mm256_set1_ps(threshold);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 c = _mm256_loadu_ps(center + i);
+    __m256 hits = _mm256_setzero_ps();
+    for (int j = 1; j <= 9; ++j) {
+        const __m256 luma = _mm256_blendv_ps(_mm256_loadu_ps(rows[j - 1] + i), _mm256_loadu_ps(center + i + direction * j), horizontal);
+        hits = _mm256_or_ps(hits, _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(luma, c), absMask), thresholds, _CMP_GT_OQ));
+    }
+    return static_cast<unsigned>(_mm256_movemask_ps(hits));
+}
+
+// 8개 중 대비가 있는 픽셀이 없으면 한 번의 비교로 넘어간다. 대비가 있으면 8개의 방향과 앞뒤 9칸 끝점을 같이 구하고,
+// 가로 탐색이 이미지 가장자리에 걸리는 8개만 스칼라로 처리한다.
+// std::min(a, b) 는 min_ps(b, a), std::max(a, b) 는 max_ps(b, a) 와 같다(NaN 이 섞여도).
+PATTERN_SIMD_TARGET_AVX2 static int fxaa_row_batch_avx2(const FXAARowParams& params, int count, FXAABlend* blends, int& blendCount)
+{
+    const float* north = params.north;
+    const float* center = params.center;
+    const float* south = params.south;
+    const __m256 thresholds = _mm256_set1_ps(params.threshold);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    // 가로 탐색이 앞뒤 9칸 모두 이미지 안인 픽셀 범위.
+    const int interiorBegin = 9 - params.column;
+    const int interiorEnd = params.imageWidth - 9 - params.column;
+    blendCount = 0;
+    int edgeCount = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 c = _mm256_loadu_ps(center + i);
+        const __m256 n = _mm256_loadu_ps(north + i);
+        const __m256 s = _mm256_loadu_ps(south + i);
+        const __m256 w = _mm256_loadu_ps(center + i - 1);
+        const __m256 e = _mm256_loadu_ps(center + i + 1);
+        const __m256 lumaMin = _mm256_min_ps(e, _mm256_min_ps(_mm256_min_ps(w, s), _mm256_min_ps(n, c)));
+        const __m256 lumaMax = _mm256_max_ps(e, _mm256_max_ps(_mm256_max_ps(w, s), _mm256_max_ps(n, c)));
+        const unsigned edges = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_sub_ps(lumaMax, lumaMin), thresholds, _CMP_GT_OQ)));
+        if (edges == 0) {
+            continue;
+        }
+        if (i < interiorBegin || i + 8 > interiorEnd) {
+            edgeCount += fxaa_row_range_scalar(params, i, i + 8, blends, blendCount);
+            continue;
+        }
+        edgeCount += std::popcount(edges);
+
+        const __m256 northWest = _mm256_loadu_ps(north + i - 1);
+        const __m256 northEast = _mm256_loadu_ps(north + i + 1);
+        const __m256 southWest = _mm256_loadu_ps(south + i - 1);
+        const __m256 southEast = _mm256_loadu_ps(south + i + 1);
+        const __m256 deltaX = _mm256_and_ps(_mm256_sub_ps(_mm256_add_ps(northWest, southWest), _mm256_add_ps(northEast, southEast)), absMask);
+        const __m256 deltaY = _mm256_and_ps(_mm256_sub_ps(_mm256_add_ps(northWest, northEast), _mm256_add_ps(southWest, southEast)), absMask);
+        const __m256 horizontal = _mm256_cmp_ps(deltaX, deltaY, _CMP_GT_OQ);
+
+        // 앞쪽 끝점이 있으면 그대로이므로 남은 픽셀이 없으면 뒤쪽은 보지 않는다.
+        unsigned candidates = edges & ~fxaa_endpoints_avx2(center, params.forwardRows, i, 1, horizontal, params.threshold);
+        if (candidates == 0) {
+            continue;
+        }
+        candidates &= fxaa_endpoints_avx2(center, params.backwardRows, i, -1, horizontal, params.threshold);
+        const unsigned horizontalBits = static_cast<unsigned>(_mm256_movemask_ps(horizontal));
+        while (candidates != 0) {
+            const int lane = std::countr_zero(candidates);
+            blends[blendCount++] = {i + lane, ((horizontalBits >> lane) & 1u) == 0};
+            candidates &= candidates - 1;
+        }
+    }
+    return edgeCount + fxaa_row_range_scalar(params, i, count, blends, blendCount);
+}
+
+// clamp(v, 0, 1) 은 max(0, min(v, 1)) 이라 NaN 이 0 이 된다. max_ps(v, 0) 을 먼저 하면 같은 결과가 된다.
+PATTERN_SIMD_TARGET_AVX2 static void quantize_unorm8_batch_avx2(const float* values, size_t count, float scale, unsigned char* out)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 scales = _mm256_set1_ps(scale);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    // packs 는 128비트 레인마다 섞으므로 마지막에 32비트 단위 순서를 되돌린다.
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i words[4];
+        for (int v = 0; v < 4; ++v) {
+            const __m256 clamped = _mm256_min_ps(one, _mm256_max_ps(_mm256_loadu_ps(values + i + v * 8), zero));
+            words[v] = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, scales), half));
+        }
+        const __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(words[0], words[1]), _mm256_packs_epi32(words[2], words[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permutevar8x32_epi32(bytes, order));
+    }
+    quantize_unorm8_batch_scalar(values + i, count - i, scale, out + i);
+}
+
+PATTERN_SIMD_TARGET_AVX2 static void mip_column_batch_avx2(const float* const* rows, const float* weights, int tapCount, int count, float* out)
+{
+    int j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (int k = 0; k < tapCount; ++k) {
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + j), _mm256_set1_ps(weights[k])));
+        }
+        _mm256_storeu_ps(out + j, sum);
+    }
+    for (; j < count; ++j) {
+        float sum = 0.0f;
+        for (int k = 0; k < tapCount; ++k) {
+            sum += rows[k][j] * weights[k];
+        }
+        out[j] = sum;
+    }
+}
+
+// GCC 12 는 마스크 없는 AVX-512 내장 함수가 결과 원본으로 쓰는 _mm512_undefined_* 를 -Wmaybe-uninitialized 로 경고한다.
+// 그런 함수는 0 원본과 전체 마스크를 주는 mask 형태로 부른다. 마스크가 모두 1 이라 같은 명령으로 컴파일된다.
+constexpr __mmask16 AVX512_ALL_LANES = 0xFFFF;
+constexpr __mmask8 AVX512_ALL_LANES_PD = 0xFF;
+
+PATTERN_SIMD_TARGET_AVX512 static __m512 min_avx512(__m512 a, __m512 b)
+{
+    return _mm512_mask_min_ps(_mm512_setzero_ps(), AVX512_ALL_LANES, a, b);
+}
+
+PATTERN_SIMD_TARGET_AVX512 static __m512 max_avx512(__m512 a, __m512 b)
+{
+    return _mm512_mask_max_ps(_mm512_setzero_ps(), AVX512_ALL_LANES, a, b);
+}
+
+PATTERN_SIMD_TARGET_AVX512 static __m256 fmod_exact_avx512(__m256 dist, __m512d period)
+{
+    const __m512d d = _mm512_mask_cvtps_pd(_mm512_setzero_pd(), AVX512_ALL_LANES_PD, dist);
+    const __m512d q = _mm512_mask_roundscale_pd(_mm512_setzero_pd(), AVX512_ALL_LANES_PD, _mm512_div_pd(d, period), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    return _mm512_mask_cvtpd_ps(_mm256_setzero_ps(), AVX512_ALL_LANES_PD, _mm512_sub_pd(d, _mm512_mul_pd(q, period)));
+}
+
+PATTERN_SIMD_TARGET_AVX512 static void checkerboard_batch_avx512(const float* u, const float* v, int count, const CheckerboardKernelParams& params, float* out)
+{
+    const __m512 aspect = _mm512_set1_ps(params.aspectRatio);
+    const __m512 pivotX = _mm512_set1_ps(params.pivot.x);
+    const __m512 pivotY = _mm512_set1_ps(params.pivot.y);
+    const __m512 pivotYAspect = _mm512_set1_ps(params.pivotYAspect);
+    const __m512 m00 = _mm512_set1_ps(params.rotation.m00);
+    const __m512 m01 = _mm512_set1_ps(params.rotation.m01);
+    const __m512 m10 = _mm512_set1_ps(params.rotation.m10);
+    const __m512 m11 = _mm512_set1_ps(params.rotation.m11);
+    const __m512 sizeX = _mm512_set1_ps(params.size.x);
+    const __m512 sizeY = _mm512_set1_ps(params.size.y);
+    const __m512 step = _mm512_set1_ps(params.step);
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512 zero = _mm512_setzero_ps();
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512 x = _mm512_sub_ps(_mm512_loadu_ps(u + i), pivotX);
+        const __m512 y = _mm512_sub_ps(_mm512_mul_ps(_mm512_loadu_ps(v + i), aspect), pivotYAspect);
+        const __m512 rx = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(m00, x), _mm512_mul_ps(m01, y)), pivotX);
+        const __m512 ry = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(m10, x), _mm512_mul_ps(m11, y)), pivotY);
+        const __m512 fx = _mm512_mask_roundscale_ps(zero, AVX512_ALL_LANES, _mm512_div_ps(_mm512_mul_ps(rx, sizeX), step), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        const __m512 fy = _mm512_mask_roundscale_ps(zero, AVX512_ALL_LANES, _mm512_div_ps(_mm512_mul_ps(ry, sizeY), step), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        const __m512i cellX = _mm512_mask_cvttps_epi32(_mm512_setzero_si512(), AVX512_ALL_LANES, fx);
+        const __m512i cellY = _mm512_mask_cvttps_epi32(_mm512_setzero_si512(), AVX512_ALL_LANES, fy);
+        const __m512i parity = _mm512_and_si512(_mm512_add_epi32(cellX, cellY), one);
+        _mm512_storeu_ps(out + i, _mm512_mask_cvtepi32_ps(zero, AVX512_ALL_LANES, parity));
+    }
+    checkerboard_batch_scalar(u + i, v + i, count - i, params, out + i);
+}
+
+PATTERN_SIMD_TARGET_AVX512 static void circle_batch_avx512(const float* u, const float* v, int count, const CircleKernelParams& params, float* out)
+{
+    const __m512 sizeX = _mm512_set1_ps(params.size.x);
+    const __m512 sizeY = _mm512_set1_ps(params.size.y);
+    const __m512 centerX = _mm512_set1_ps(params.center.x);
+    const __m512 centerY = _mm512_set1_ps(params.center.y);
+    const __m512 thickness = _mm512_set1_ps(params.thickness);
+    const __m512d period = _mm512_set1_pd(params.period);
+    const __m512 one = _mm512_set1_ps(1.f);
+    const __m512 zero = _mm512_setzero_ps();
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512 dx = _mm512_sub_ps(_mm512_mul_ps(_mm512_loadu_ps(u + i), sizeX), centerX);
+        const __m512 dy = _mm512_sub_ps(_mm512_mul_ps(_mm512_loadu_ps(v + i), sizeY), centerY);
+        const __m512 dist = _mm512_mask_sqrt_ps(zero, AVX512_ALL_LANES, _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)));
+        const __m256d distLo = _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), AVX512_ALL_LANES_PD, _mm512_castps_pd(dist), 0);
+        const __m256d distHi = _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), AVX512_ALL_LANES_PD, _mm512_castps_pd(dist), 1);
+        const __m256 remLo = fmod_exact_avx512(_mm256_castpd_ps(distLo), period);
+        const __m256 remHi = fmod_exact_avx512(_mm256_castpd_ps(distHi), period);
+        const __m512d remLoWide = _mm512_castps_pd(_mm512_castps256_ps512(remLo));
+        const __m512 remainder = _mm512_castpd_ps(_mm512_mask_insertf64x4(_mm512_setzero_pd(), AVX512_ALL_LANES_PD, remLoWide, _mm256_castps_pd(remHi), 1));
+        const __mmask16 outside = _mm512_cmp_ps_mask(remainder, thickness, _CMP_GT_OQ);
+        _mm512_storeu_ps(out + i, _mm512_maskz_mov_ps(outside, one));
+    }
+    circle_batch_scalar(u + i, v + i, count - i, params, out + i);
+}
+
+PATTERN_SIMD_TARGET_AVX512 static void voronoi_batch_avx512(const float* u, const float* v, int count, const VoronoiKernelParams& params, int* outSite)
+{
+    const __m512 sizeX = _mm512_set1_ps(params.size.x);
+    const __m512 sizeY = _mm512_set1_ps(params.size.y);
+    const __m512 zero = _mm512_setzero_ps();
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512 px = _mm512_mul_ps(_mm512_loadu_ps(u + i), sizeX);
+        const __m512 py = _mm512_mul_ps(_mm512_loadu_ps(v + i), sizeY);
+        __m512 minDist = _mm512_set1_ps(std::numeric_limits<float>::max());
+        __m512i closest = _mm512_setzero_si512();
+        for (int j = 0; j < params.numPoints; ++j) {
+            const __m512 dx = _mm512_sub_ps(px, _mm512_set1_ps(params.points[j].x));
+            const __m512 dy = _mm512_sub_ps(py, _mm512_set1_ps(params.points[j].y));
+            const __m512 dist = _mm512_mask_sqrt_ps(zero, AVX512_ALL_LANES, _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)));
+            const __mmask16 closer = _mm512_cmp_ps_mask(dist, minDist, _CMP_LT_OQ);
+            minDist = _mm512_mask_mov_ps(minDist, closer, dist);
+            closest = _mm512_mask_mov_epi32(closest, closer, _mm512_set1_epi32(j));
+        }
+        _mm512_storeu_si512(outSite + i, closest);
+    }
+    voronoi_batch_scalar(u + i, v + i, count - i, params, outSite + i);
+}
+
+// luma_batch_avx2 와 같은 방식으로 16개씩 처리한다.
+PATTERN_SIMD_TARGET_AVX512 static void luma_batch_avx512(const vec3f* pixels, int count, float* out)
+{
+    const float* data = reinterpret_cast<const float*>(pixels);
+    const __m512i permuteR = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 2, 5, 8, 11, 14, 1, 4, 7, 10, 13);
+    const __m512i permuteG = _mm512_setr_epi32(1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2, 5, 8, 11, 14);
+    const __m512i permuteB = _mm512_setr_epi32(2, 5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15);
+    const __m512 coeffR = _mm512_set1_ps(LUMA_COEFF_R);
+    const __m512 coeffG = _mm512_set1_ps(LUMA_COEFF_G);
+    const __m512 coeffB = _mm512_set1_ps(LUMA_COEFF_B);
+    const __m512 zero = _mm512_setzero_ps();
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const float* base = data + static_cast<size_t>(i) * 3;
+        const __m512 m0 = _mm512_loadu_ps(base);
+        const __m512 m1 = _mm512_loadu_ps(base + 16);
+        const __m512 m2 = _mm512_loadu_ps(base + 32);
+        const __m512 r = _mm512_mask_permutexvar_ps(zero, AVX512_ALL_LANES, permuteR, _mm512_mask_blend_ps(0x2492, _mm512_mask_blend_ps(0x4924, m0, m1), m2));
+        const __m512 g = _mm512_mask_permutexvar_ps(zero, AVX512_ALL_LANES, permuteG, _mm512_mask_blend_ps(0x4924, _mm512_mask_blend_ps(0x9249, m0, m1), m2));
+        const __m512 b = _mm512_mask_permutexvar_ps(zero, AVX512_ALL_LANES, permuteB, _mm512_mask_blend_ps(0x9249, _mm512_mask_blend_ps(0x2492, m0, m1), m2));
+        const __m512 luma = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(r, coeffR), _mm512_mul_ps(g, coeffG)), _mm512_mul_ps(b, coeffB));
+        _mm512_storeu_ps(out + i, luma);
+    }
+    luma_batch_scalar(pixels + i, count - i, out + i);
+}
+
+PATTERN_SIMD_TARGET_AVX512 static void mip_row_batch_avx512(const float* source, const int* indices, const float* weights, int tapCount, int stride, int count, float* out)
+{
+    int j = 0;
+    for (; j + 16 <= count; j += 16) {
+        __m512 sum = _mm512_setzero_ps();
+        for (int k = 0; k < tapCount; ++k) {
+            const size_t tap = static_cast<size_t>(k) * stride + j;
+            const __m512 value = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), AVX512_ALL_LANES, _mm512_loadu_si512(indices + tap), source, 4);
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(value, _mm512_loadu_ps(weights + tap)));
+        }
+        _mm512_storeu_ps(out + j, sum);
+    }
+    mip_row_batch_scalar(source, indices + j, weights + j, tapCount, stride, count - j, out + j);
+}
+
+// mip_row_half_batch_avx2 와 같은 배치로, 출력 16개는 연속한 32개 안에 있으므로 두 번 읽어 한 번의 순열로 모은다.
+PATTERN_SIMD_TARGET_AVX512 static void mip_row_half_batch_avx512(const float* source, int sourceCount, const float* weights, int tapCount, int count, float* out)
+{
+    static constexpr int Bases[3] = {0, 31, 62};
+    const __m512i permutes[3] = {
+        _mm512_setr_epi32(0, 1, 2, 6, 7, 8, 12, 13, 14, 18, 19, 20, 24, 25, 26, 30),
+        _mm512_setr_epi32(0, 1, 5, 6, 7, 11, 12, 13, 17, 18, 19, 23, 24, 25, 29, 30),
+        _mm512_setr_epi32(0, 4, 5, 6, 10, 11, 12, 16, 17, 18, 22, 23, 24, 28, 29, 30)
+    };
+
+    // 출력 픽셀 16개는 원본 픽셀 32개(+ 탭)를 읽는다. 마지막 순열은 Bases[2] + 32 번째 float 앞까지 읽는다.
+    int x = 0;
+    for (; x + 16 <= count && x * 6 + (tapCount - 1) * 3 + Bases[2] + 32 <= sourceCount; x += 16) {
+        const float* block = source + x * 6;
+        __m512 sums[3] = {_mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps()};
+        for (int k = 0; k < tapCount; ++k) {
+            const float* taps = block + k * 3;
+            const __m512 weight = _mm512_set1_ps(weights[k]);
+            for (int v = 0; v < 3; ++v) {
+                const __m512 gathered = _mm512_permutex2var_ps(_mm512_loadu_ps(taps + Bases[v]), permutes[v], _mm512_loadu_ps(taps + Bases[v] + 16));
+                sums[v] = _mm512_add_ps(sums[v], _mm512_mul_ps(gathered, weight));
+            }
+        }
+        for (int v = 0; v < 3; ++v) {
+            _mm512_storeu_ps(out + x * 3 + v * 16, sums[v]);
+        }
+    }
+    mip_row_half_batch_scalar(source + x * 6, sourceCount - x * 6, weights, tapCount, count - x, out + x * 3);
+}
+
+PATTERN_SIMD_TARGET_AVX512 static unsigned fxaa_endpoints_avx512(const float* center, const float* const* rows, int i, int direction, __mmask16 horizontal, float threshold)
+{
+    const __m512 thresholds = _mm512_set1_ps(threshold);
+    const __m512 c = _mm512_loadu_ps(center + i);
+    __mmask16 hits = 0;
+    for (int j = 1; j <= 9; ++j) {
+        const __m512 luma = _mm512_mask_blend_ps(horizontal, _mm512_loadu_ps(rows[j - 1] + i), _mm512_loadu_ps(center + i + direction * j));
+        hits |= _mm512_cmp_ps_mask(_mm512_abs_ps(_mm512_sub_ps(luma, c)), thresholds, _CMP_GT_OQ);
+    }
+    return hits;
+}
+
+// fxaa_row_batch_avx2 와 같은 순서로 16개씩 처리한다.
+PATTERN_SIMD_TARGET_AVX512 static int fxaa_row_batch_avx512(const FXAARowParams& params, int count, FXAABlend* blends, int& blendCount)
+{
+    const float* north = params.north;
+    const float* center = params.center;
+    const float* south = params.south;
+    const __m512 thresholds = _mm512_set1_ps(params.threshold);
+    const int interiorBegin = 9 - params.column;
+    const int interiorEnd = params.imageWidth - 9 - params.column;
+    blendCount = 0;
+    int edgeCount = 0;
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512 c = _mm512_loadu_ps(center + i);
+        const __m512 n = _mm512_loadu_ps(north + i);
+        const __m512 s = _mm512_loadu_ps(south + i);
+        const __m512 w = _mm512_loadu_ps(center + i - 1);
+        const __m512 e = _mm512_loadu_ps(center + i + 1);
+        const __m512 lumaMin = min_avx512(e, min_avx512(min_avx512(w, s), min_avx512(n, c)));
+        const __m512 lumaMax = max_avx512(e, max_avx512(max_avx512(w, s), max_avx512(n, c)));
+        const unsigned edges = _mm512_cmp_ps_mask(_mm512_sub_ps(lumaMax, lumaMin), thresholds, _CMP_GT_OQ);
+        if (edges == 0) {
+            continue;
+        }
+        if (i < interiorBegin || i + 16 > interiorEnd) {
+            edgeCount += fxaa_row_range_scalar(params, i, i + 16, blends, blendCount);
+            continue;
+        }
+        edgeCount += std::popcount(edges);
+
+        const __m512 northWest = _mm512_loadu_ps(north + i - 1);
+        const __m512 northEast = _mm512_loadu_ps(north + i + 1);
+        const __m512 southWest = _mm512_loadu_ps(south + i - 1);
+        const __m512 southEast = _mm512_loadu_ps(south + i + 1);
+        const __m512 deltaX = _mm512_abs_ps(_mm512_sub_ps(_mm512_add_ps(northWest, southWest), _mm512_add_ps(northEast, southEast)));
+        const __m512 deltaY = _mm512_abs_ps(_mm512_sub_ps(_mm512_add_ps(northWest, northEast), _mm512_add_ps(southWest, southEast)));
+        const __mmask16 horizontal = _mm512_cmp_ps_mask(deltaX, deltaY, _CMP_GT_OQ);
+
+        unsigned candidates = edges & ~fxaa_endpoints_avx512(center, params.forwardRows, i, 1, horizontal, params.threshold);
+        if (candidates == 0) {
+            continue;
+        }
+        candidates &= fxaa_endpoints_avx512(center, params.backwardRows, i, -1, horizontal, params.threshold);
+        while (candidates != 0) {
+            const int lane = std::countr_zero(candidates);
+            blends[blendCount++] = {i + lane, ((horizontal >> lane) & 1u) == 0};
+            candidates &= candidates - 1;
+        }
+    }
+    return edgeCount + fxaa_row_range_scalar(params, i, count, blends, blendCount);
+}
+
+// quantize_unorm8_batch_avx2 와 같은 순서로 자르고, 16개씩 바이트로 줄여 쓴다.
+PATTERN_SIMD_TARGET_AVX512 static void quantize_unorm8_batch_avx512(const float* values, size_t count, float scale, unsigned char* out)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 scales = _mm512_set1_ps(scale);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512 clamped = min_avx512(one, max_avx512(_mm512_loadu_ps(values + i), zero));
+        const __m512i words = _mm512_mask_cvttps_epi32(_mm512_setzero_si512(), AVX512_ALL_LANES, _mm512_add_ps(_mm512_mul_ps(clamped, scales), half));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm512_mask_cvtepi32_epi8(_mm_setzero_si128(), AVX512_ALL_LANES, words));
+    }
+    quantize_unorm8_batch_scalar(values + i, count - i, scale, out + i);
+}
+
+PATTERN_SIMD_TARGET_AVX512 static void mip_column_batch_avx512(const float* const* rows, const float* weights, int tapCount, int count, float* out)
+{
+    int j = 0;
+    for (; j + 16 <= count; j += 16) {
+        __m512 sum = _mm512_setzero_ps();
+        for (int k = 0; k < tapCount; ++k) {
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(rows[k] + j), _mm512_set1_ps(weights[k])));
+        }
+        _mm512_storeu_ps(out + j, sum);
+    }
+    for (; j < count; ++j) {
+        float sum = 0.0f;
+        for (int k = 0; k < tapCount; ++k) {
+            sum += rows[k][j] * weights[k];
+        }
+        out[j] = sum;
+    }
+}
+
+static bool cpu_supports_simd(ESimdLevel level)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave) return false;
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if (level == ESimdLevel::AVX2) return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+    if (level == ESimdLevel::AVX512) return (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+    return level == ESimdLevel::SCALAR;
+#else
+    __builtin_cpu_init();
+    if (level == ESimdLevel::AVX2) return __builtin_cpu_supports("avx2");
+    if (level == ESimdLevel::AVX512) return __builtin_cpu_supports("avx512f");
+    return level == ESimdLevel::SCALAR;
+#endif
+}
+
+#endif // PATTERN_SIMD_X86
+
+// 요청한 수준 이하에서 CPU 가 지원하는 가장 넓은 커널 집합을 고른다.
+static PatternKernels select_pattern_kernels(ESimdLevel requested)
+{
+    const PatternKernels scalar = {ESimdLevel::SCALAR, "scalar", checkerboard_batch_scalar, circle_batch_scalar, voronoi_batch_scalar, luma_batch_scalar,
+        mip_row_batch_scalar, mip_row_half_batch_scalar, mip_column_batch_scalar,
+        fxaa_row_batch_scalar, quantize_unorm8_batch_scalar};
+#if PATTERN_SIMD_X86
+    const bool any = (requested == ESimdLevel::AUTO);
+    if ((any || requested == ESimdLevel::AVX512) && cpu_supports_simd(ESimdLevel::AVX512)) {
+        return {ESimdLevel::AVX512, "avx512", checkerboard_batch_avx512, circle_batch_avx512, voronoi_batch_avx512, luma_batch_avx512,
+            mip_row_batch_avx512, mip_row_half_batch_avx512, mip_column_batch_avx512,
+            fxaa_row_batch_avx512, quantize_unorm8_batch_avx512};
+    }
+    if ((any || requested == ESimdLevel::AVX512 || requested == ESimdLevel::AVX2) && cpu_supports_simd(ESimdLevel::AVX2)) {
+        return {ESimdLevel::AVX2, "avx2", checkerboard_batch_avx2, circle_batch_avx2, voronoi_batch_avx2, luma_batch_avx2,
+            mip_row_batch_avx2, mip_row_half_batch_avx2, mip_column_batch_avx2,
+            fxaa_row_batch_avx2, quantize_unorm8_batch_avx2};
+    }
+#endif
+    return scalar;
+}
+
+inline PatternKernels& GetPatternKernelsInstance()
+{
+    static PatternKernels kernels = select_pattern_kernels(ESimdLevel::AUTO);
+    return kernels;
+}
+
+inline void SetSimdLevel(ESimdLevel level)
+{
+    GetPatternKernelsInstance() = select_pattern_kernels(level);
+}
+
+inline const PatternKernels& GetPatternKernels()
+{
+    return GetPatternKernelsInstance();
+}
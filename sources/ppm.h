@@ -1,6 +1,23 @@
 #pragma once
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "profiler.h"
+#include "thread_pool.h"
+
+#if !defined(_WIN32)
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 enum class EPPMFormat
 {
@@ -8,32 +25,467 @@ enum class EPPMFormat
     P3_BINARY
 };
 
-bool ExportPPM(const char* filename, EPPMFormat format, int width, int height, const unsigned char* data)
+// fopen_s 는 MSVC 에만 있으므로 다른 플랫폼에서는 fopen 을 쓴다. 실패하면 nullptr.
+inline FILE* open_file_stream(const char* filename, const char* mode)
+{
+#if defined(_WIN32)
+    FILE* file = nullptr;
+    return (fopen_s(&file, filename, mode) == 0) ? file : nullptr;
+#else
+    return std::fopen(filename, mode);
+#endif
+}
+
+// 마지막으로 실패한 PPM 쓰기의 이유. 쓰기가 성공하면 지워진다.
+static std::string& get_ppm_error()
+{
+    thread_local std::string error;
+    return error;
+}
+
+// 쓸 바이트 구간 하나. writev 의 iovec 과 같은 역할이다.
+struct PPMChunk
+{
+    const void* data;
+    size_t size;
+};
+
+// stdio 버퍼를 거치지 않고 큰 블록을 그대로 쓰는 출력 파일.
+// POSIX 에서는 open/writev 로 헤더와 픽셀을 한 번의 시스템 호출로 내보내고, Windows 에서는 fwrite 를 쓴다.
+class PPMFile
 {
-    if (filename == nullptr || data == nullptr || width <= 0 || height <= 0) 
+public:
+    PPMFile() = default;
+    PPMFile(const PPMFile&) = delete;
+    PPMFile& operator=(const PPMFile&) = delete;
+
+    ~PPMFile()
     {
+        Close();
+    }
+
+    // P3 는 Windows 에서 텍스트 모드로 연다(기존 출력과 같은 줄바꿈).
+    bool Open(const char* filename, EPPMFormat format)
+    {
+        Close();
+        error.clear();
+#if defined(_WIN32)
+        file = open_file_stream(filename, (format == EPPMFormat::P3_ASCII) ? "w" : "wb");
+        if (file == nullptr)
+        {
+            return Fail(std::generic_category().message(errno));
+        }
+#else
+        (void)format;
+        descriptor = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (descriptor < 0)
+        {
+            return Fail(std::generic_category().message(errno));
+        }
+#endif
+        return true;
+    }
+
+    bool IsOpen() const
+    {
+#if defined(_WIN32)
+        return file != nullptr;
+#else
+        return descriptor >= 0;
+#endif
+    }
+
+    // chunks 를 순서대로 모두 쓴다. 일부만 써지면 남은 부분을 이어서 쓴다.
+    bool Write(const PPMChunk* chunks, int chunkCount)
+    {
+        if (!IsOpen() || !error.empty())
+        {
+            return false;
+        }
+        int64_t written = 0;
+#if defined(_WIN32)
+        for (int i = 0; i < chunkCount; ++i)
+        {
+            const size_t count = fwrite(chunks[i].data, 1, chunks[i].size, file);
+            written += static_cast<int64_t>(count);
+            if (count != chunks[i].size)
+            {
+                profile_add_counter(EProfileCounter::BYTES_WRITTEN, written);
+                return Fail("write failed: " + std::generic_category().message(errno));
+            }
+        }
+#else
+        std::vector<iovec> vectors;
+        vectors.reserve(chunkCount);
+        for (int i = 0; i < chunkCount; ++i)
+        {
+            if (chunks[i].size > 0)
+            {
+                vectors.push_back({const_cast<void*>(chunks[i].data), chunks[i].size});
+            }
+        }
+        size_t first = 0;
+        while (first < vectors.size())
+        {
+            const int count = static_cast<int>(std::min<size_t>(vectors.size() - first, IOV_MAX));
+            const ssize_t result = ::writev(descriptor, vectors.data() + first, count);
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                profile_add_counter(EProfileCounter::BYTES_WRITTEN, written);
+                return Fail("write failed: " + std::generic_category().message(errno));
+            }
+            written += result;
+            // 다 써진 구간은 건너뛰고, 반만 써진 구간은 남은 부분부터 다시 쓴다.
+            size_t remaining = static_cast<size_t>(result);
+            while (first < vectors.size() && remaining >= vectors[first].iov_len)
+            {
+                remaining -= vectors[first].iov_len;
+                ++first;
+            }
+            if (remaining > 0)
+            {
+                vectors[first].iov_base = static_cast<char*>(vectors[first].iov_base) + remaining;
+                vectors[first].iov_len -= remaining;
+            }
+        }
+#endif
+        profile_add_counter(EProfileCounter::BYTES_WRITTEN, written);
+        return true;
+    }
+
+    bool Write(const void* data, size_t size)
+    {
+        const PPMChunk chunk = {data, size};
+        return Write(&chunk, 1);
+    }
+
+    // 앞선 쓰기와 닫기가 모두 성공했으면 true.
+    bool Close()
+    {
+        if (!IsOpen())
+        {
+            return false;
+        }
+#if defined(_WIN32)
+        const bool closed = fclose(file) == 0;
+        file = nullptr;
+#else
+        const bool closed = ::close(descriptor) == 0;
+        descriptor = -1;
+#endif
+        if (!closed && error.empty())
+        {
+            Fail("close failed: " + std::generic_category().message(errno));
+        }
+        return error.empty();
+    }
+
+    const std::string& GetError() const { return error; }
+
+private:
+    bool Fail(const std::string& reason)
+    {
+        error = reason;
         return false;
     }
 
+#if defined(_WIN32)
     FILE* file = nullptr;
-    if (fopen_s(&file, filename, (format == EPPMFormat::P3_ASCII) ? "w" : "wb") != 0 || file == nullptr)
+#else
+    int descriptor = -1;
+#endif
+    std::string error;
+};
+
+// P3 샘플을 "<값> " 으로 바꾸는 표. 8비트는 값마다 글자를 미리 만들어 두고, 16비트는 두 자리씩 찾는다.
+struct PPMDecimalTable
+{
+    char bytes[256][4];
+    unsigned char byteLengths[256];
+    char pairs[100][2];
+
+    PPMDecimalTable()
     {
-        return false;
+        for (int value = 0; value < 256; ++value)
+        {
+            char text[8];
+            const int length = std::snprintf(text, sizeof(text), "%d ", value);
+            std::memcpy(bytes[value], text, 4);
+            byteLengths[value] = static_cast<unsigned char>(length);
+        }
+        for (int value = 0; value < 100; ++value)
+        {
+            pairs[value][0] = static_cast<char>('0' + value / 10);
+            pairs[value][1] = static_cast<char>('0' + value % 10);
+        }
     }
+};
 
-    fprintf(file, (format == EPPMFormat::P3_ASCII) ? "P3\n%d %d\n255\n" : "P6\n%d %d\n255\n", width, height);
-    if (format == EPPMFormat::P3_ASCII) 
+static const PPMDecimalTable& get_ppm_decimal_table()
+{
+    static const PPMDecimalTable table;
+    return table;
+}
+
+// 샘플 하나가 차지할 수 있는 가장 긴 글자 수("255 ", "65535 ").
+constexpr size_t PPM_TEXT_MAX_BYTES[3] = {0, 4, 6};
+
+// sampleCount 개 샘플을 "%d " 과 같은 글자로 out 에 쓰고 쓴 바이트 수를 반환한다.
+// out 에는 sampleCount * PPM_TEXT_MAX_BYTES[bytesPerSample] 바이트가 있어야 한다.
+static size_t format_ppm_text(const unsigned char* data, size_t sampleCount, int bytesPerSample, char* out)
+{
+    const PPMDecimalTable& table = get_ppm_decimal_table();
+    char* cursor = out;
+    if (bytesPerSample == 1)
+    {
+        for (size_t i = 0; i < sampleCount; ++i)
+        {
+            // 4바이트를 통째로 복사하고 실제 길이만큼만 나아간다.
+            std::memcpy(cursor, table.bytes[data[i]], 4);
+            cursor += table.byteLengths[data[i]];
+        }
+        return static_cast<size_t>(cursor - out);
+    }
+
+    for (size_t i = 0; i < sampleCount; ++i)
     {
-        for (int i = 0; i < width * height * 3; ++i) 
+        unsigned value = static_cast<unsigned>(data[i * 2] << 8 | data[i * 2 + 1]);
+        // 뒤에서부터 두 자리씩 채운 뒤 앞으로 옮긴다.
+        char digits[6];
+        char* end = digits + sizeof(digits);
+        char* begin = end;
+        while (value >= 100)
         {
-            fprintf(file, "%d ", data[i]);
+            begin -= 2;
+            std::memcpy(begin, table.pairs[value % 100], 2);
+            value /= 100;
         }
+        if (value >= 10)
+        {
+            begin -= 2;
+            std::memcpy(begin, table.pairs[value], 2);
+        }
+        else
+        {
+            *--begin = static_cast<char>('0' + value);
+        }
+        const size_t length = static_cast<size_t>(end - begin);
+        std::memcpy(cursor, begin, length);
+        cursor[length] = ' ';
+        cursor += length + 1;
+    }
+    return static_cast<size_t>(cursor - out);
+}
+
+// P3 텍스트 한 조각이 맡는 샘플 수. 8비트면 조각당 최대 1MB 다.
+constexpr size_t PPM_TEXT_CHUNK_SAMPLES = 256 * 1024;
+
+// 샘플을 조각으로 나눠 스레드 풀에서 글자로 바꾸고, 한 묶음씩 순서대로 writev 로 쓴다.
+// 묶음은 스레드 수의 두 배 조각이라 메모리는 이미지 크기와 상관없이 일정하다. prefix 는 첫 묶음 앞에 함께 쓴다.
+static bool write_ppm_text(PPMFile& file, const unsigned char* data, size_t sampleCount, int bytesPerSample, const std::string& prefix = std::string())
+{
+    const size_t chunkCount = (sampleCount + PPM_TEXT_CHUNK_SAMPLES - 1) / PPM_TEXT_CHUNK_SAMPLES;
+    const size_t batchSize = std::min<size_t>(chunkCount, static_cast<size_t>(GetThreadPool().GetThreadCount()) * 2);
+    std::vector<std::vector<char>> buffers(batchSize);
+    std::vector<size_t> lengths(batchSize);
+    std::vector<PPMChunk> chunks;
+
+    bool written = true;
+    for (size_t batchStart = 0; batchStart < chunkCount && written; batchStart += batchSize)
+    {
+        const size_t batchCount = std::min(batchSize, chunkCount - batchStart);
+        GetThreadPool().ParallelFor(static_cast<int>(batchCount), [&](int index) {
+            const size_t first = (batchStart + index) * PPM_TEXT_CHUNK_SAMPLES;
+            const size_t count = std::min(PPM_TEXT_CHUNK_SAMPLES, sampleCount - first);
+            std::vector<char>& buffer = buffers[index];
+            buffer.resize(count * PPM_TEXT_MAX_BYTES[bytesPerSample]);
+            lengths[index] = format_ppm_text(data + first * bytesPerSample, count, bytesPerSample, buffer.data());
+        });
+
+        chunks.clear();
+        if (batchStart == 0)
+        {
+            chunks.push_back({prefix.data(), prefix.size()});
+        }
+        for (size_t i = 0; i < batchCount; ++i)
+        {
+            chunks.push_back({buffers[i].data(), lengths[i]});
+        }
+        written = file.Write(chunks.data(), static_cast<int>(chunks.size()));
+    }
+    if (chunkCount == 0 && !prefix.empty())
+    {
+        written = file.Write(prefix.data(), prefix.size());
+    }
+    return written;
+}
+
+static std::string format_ppm_header(EPPMFormat format, int width, int height, int maxValue)
+{
+    char header[64];
+    const int length = std::snprintf(header, sizeof(header), (format == EPPMFormat::P3_ASCII) ? "P3\n%d %d\n%d\n" : "P6\n%d %d\n%d\n", width, height, maxValue);
+    return std::string(header, static_cast<size_t>(length));
+}
+
+// maxValue 가 255 보다 크면 data 는 채널당 2바이트(빅엔디언) 샘플이다.
+// P6 는 data 를 복사하지 않고 헤더와 함께 그대로 쓰고, P3 는 여러 스레드에서 글자로 바꿔 쓴다.
+// 실패하면 false 이고 이유는 get_ppm_error() 에 남는다.
+static bool ExportPPM(const char* filename, EPPMFormat format, int width, int height, const unsigned char* data, int maxValue = 255)
+{
+    get_ppm_error().clear();
+    if (filename == nullptr || data == nullptr || width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 65535) 
+    {
+        get_ppm_error() = "invalid image";
+        return false;
+    }
+    const int bytesPerSample = (maxValue > 255) ? 2 : 1;
+    ProfileStage profileStage("export");
+
+    PPMFile file;
+    if (!file.Open(filename, format))
+    {
+        get_ppm_error() = file.GetError();
+        return false;
+    }
+
+    const std::string header = format_ppm_header(format, width, height, maxValue);
+    const size_t sampleCount = static_cast<size_t>(width) * height * 3;
+    if (format == EPPMFormat::P3_ASCII) 
+    {
+        write_ppm_text(file, data, sampleCount, bytesPerSample, header);
     } 
     else 
     {
-        // For binary format, we write the raw data directly
-        fwrite(data, 1, width * height * 3, file);
+        const PPMChunk chunks[] = {{header.data(), header.size()}, {data, sampleCount * bytesPerSample}};
+        file.Write(chunks, 2);
+    }
+    if (!file.Close())
+    {
+        get_ppm_error() = file.GetError();
+        return false;
     }
-    fclose(file);
     return true;
-}
\ No newline at end of file
+}
+
+// "P6\n<width> <height>\n<maxValue>\n" 헤더를 읽고 픽셀 데이터 앞에 멈춘다.
+inline bool read_ppm_header(FILE* file, int& width, int& height, int& maxValue)
+{
+    if (std::fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) != 3 || width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 65535)
+    {
+        return false;
+    }
+    // 최댓값 뒤의 공백 한 글자까지가 헤더다.
+    return std::fgetc(file) != EOF;
+}
+
+// "name.ext" 를 "name<suffix>.ext" 로 바꾼다. 확장자가 없으면 끝에 붙인다.
+inline std::string insert_filename_suffix(const std::string& filename, const std::string& suffix)
+{
+    const size_t dot = filename.find_last_of('.');
+    const size_t slash = filename.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        return filename + suffix;
+    }
+    return filename.substr(0, dot) + suffix + filename.substr(dot);
+}
+
+// 헤더를 먼저 쓰고 픽셀을 행 묶음 단위로 이어 쓰는 PPM 파일 작성기.
+// 이미지 전체를 메모리에 두지 않고 밴드별로 내보낼 때 쓴다. 헤더는 첫 밴드와 함께 한 번에 쓴다.
+class PPMWriter
+{
+public:
+    PPMWriter() = default;
+    PPMWriter(const PPMWriter&) = delete;
+    PPMWriter& operator=(const PPMWriter&) = delete;
+
+    ~PPMWriter()
+    {
+        Close();
+    }
+
+    bool Open(const char* filename, EPPMFormat format, int width, int height, int maxValue = 255)
+    {
+        Close();
+        get_ppm_error().clear();
+        if (filename == nullptr || width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 65535)
+        {
+            get_ppm_error() = "invalid image";
+            return false;
+        }
+
+        if (!file.Open(filename, format))
+        {
+            get_ppm_error() = file.GetError();
+            return false;
+        }
+
+        this->format = format;
+        this->width = width;
+        this->height = height;
+        bytesPerSample = (maxValue > 255) ? 2 : 1;
+        rowsWritten = 0;
+        failed = false;
+        header = format_ppm_header(format, width, height, maxValue);
+        return true;
+    }
+
+    // data 는 rowCount 행의 RGB 샘플(width * 3 * rowCount 개, 샘플당 1 또는 2바이트).
+    bool WriteRows(const unsigned char* data, int rowCount)
+    {
+        if (!file.IsOpen() || failed || data == nullptr || rowCount <= 0 || rowsWritten + rowCount > height)
+        {
+            failed = true;
+            return false;
+        }
+
+        ProfileStage profileStage("write");
+        const size_t sampleCount = static_cast<size_t>(width) * rowCount * 3;
+        if (format == EPPMFormat::P3_ASCII)
+        {
+            failed = !write_ppm_text(file, data, sampleCount, bytesPerSample, header);
+        }
+        else
+        {
+            const PPMChunk chunks[] = {{header.data(), header.size()}, {data, sampleCount * bytesPerSample}};
+            failed = !file.Write(chunks, 2);
+        }
+        header.clear();
+        rowsWritten += rowCount;
+        return !failed;
+    }
+
+    // 모든 행이 문제없이 써졌으면 true. 실패 이유는 get_ppm_error() 에 남는다.
+    bool Close()
+    {
+        if (!file.IsOpen())
+        {
+            return false;
+        }
+        const bool complete = !failed && rowsWritten == height;
+        const bool closed = file.Close();
+        if (!closed)
+        {
+            get_ppm_error() = file.GetError();
+        }
+        else if (!complete)
+        {
+            get_ppm_error() = "wrote " + std::to_string(rowsWritten) + " of " + std::to_string(height) + " rows";
+        }
+        return complete && closed;
+    }
+
+private:
+    PPMFile file;
+    EPPMFormat format = EPPMFormat::P3_BINARY;
+    int width = 0;
+    int height = 0;
+    int bytesPerSample = 1;
+    int rowsWritten = 0;
+    bool failed = false;
+    std::string header;
+};
@@ -0,0 +1,462 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PROFILER_PERF_EVENTS 1
+#else
+#define PROFILER_PERF_EVENTS 0
+#endif
+
+// 단계(stage)와 타일 단위 시간, 카운터, 하드웨어 카운터를 모으는 프로파일러.
+// 꺼져 있으면 단계/타일마다 bool 하나만 검사하고 아무것도 기록하지 않는다(픽셀 루프에는 손대지 않는다).
+// 이벤트는 스레드마다 따로 쌓고, 렌더가 끝난 뒤 한 스레드에서 요약(--stats)이나 Chrome trace(--trace)로 내보낸다.
+
+enum class EProfileCounter {
+    SAMPLES,            // 패턴 평가 횟수
+    FXAA_EDGE_PIXELS,   // FXAA 끝점 탐색을 한 픽셀 수
+    BYTES_WRITTEN,      // 파일에 쓴 바이트 수
+    COUNT
+};
+
+// perf_event_open 으로 읽는 하드웨어 카운터.
+enum class EHardwareCounter {
+    CYCLES,
+    INSTRUCTIONS,
+    CACHE_MISSES,
+    BRANCH_MISSES,
+    COUNT
+};
+
+constexpr int PROFILE_COUNTER_COUNT = static_cast<int>(EProfileCounter::COUNT);
+constexpr int HARDWARE_COUNTER_COUNT = static_cast<int>(EHardwareCounter::COUNT);
+
+// 단계 이벤트는 tileX < 0, 타일 이벤트는 타일 왼쪽 위 픽셀 좌표를 가진다.
+struct ProfileEvent
+{
+    const char* name;
+    int64_t startNs;
+    int64_t durationNs;
+    int tileX;
+    int tileY;
+};
+
+class Profiler
+{
+public:
+    Profiler()
+        : origin(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~Profiler()
+    {
+        for (std::unique_ptr<ThreadRecord>& thread : threads) {
+            CloseHardwareCounters(*thread);
+        }
+    }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // hardwareCounters 면 각 스레드가 처음 기록할 때 perf 카운터를 연다. 열 수 없으면 조용히 건너뛴다.
+    // 부른 스레드가 trace 의 0번 스레드가 된다.
+    void Enable(bool hardwareCounters)
+    {
+        useHardwareCounters = hardwareCounters;
+        GetThreadRecord();
+        enabled.store(true, std::memory_order_release);
+    }
+
+    bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    int64_t Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    void Record(const ProfileEvent& event)
+    {
+        GetThreadRecord().events.push_back(event);
+    }
+
+    void AddCounter(EProfileCounter counter, int64_t value)
+    {
+        counters[static_cast<int>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    int64_t GetCounter(EProfileCounter counter) const
+    {
+        return counters[static_cast<int>(counter)].load(std::memory_order_relaxed);
+    }
+
+    // 큰 버퍼의 할당/해제를 알려 동시에 살아 있는 버퍼 크기의 최댓값을 잰다.
+    void TrackBuffer(int64_t bytes)
+    {
+        const int64_t current = liveBufferBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        int64_t peak = peakBufferBytes.load(std::memory_order_relaxed);
+        while (current > peak && !peakBufferBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+        }
+    }
+
+    void ReleaseBuffer(int64_t bytes)
+    {
+        liveBufferBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    // 지금까지 카운터를 연 모든 스레드의 하드웨어 카운터 합.
+    void ReadHardwareCounters(int64_t* values)
+    {
+        std::fill(values, values + HARDWARE_COUNTER_COUNT, 0);
+        if (!useHardwareCounters) {
+            return;
+        }
+        GetThreadRecord();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::unique_ptr<ThreadRecord>& thread : threads) {
+            for (int i = 0; i < HARDWARE_COUNTER_COUNT; ++i) {
+                values[i] += ReadHardwareCounter(thread->perfFds[i]);
+            }
+        }
+    }
+
+    // 단계 하나가 끝날 때 하드웨어 카운터 증가분을 단계 이름별로 더한다.
+    void AddStageHardwareCounters(const char* name, const int64_t* deltas)
+    {
+        if (!useHardwareCounters) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        int64_t* total = stageHardwareCounters[name].data();
+        for (int i = 0; i < HARDWARE_COUNTER_COUNT; ++i) {
+            total[i] += deltas[i];
+        }
+    }
+
+    bool WriteTrace(const char* filename) const;
+    void PrintStats(std::ostream& out) const;
+
+    // parallel_for_tiles 가 타일 이벤트에 붙일 이름. 호출한 스레드의 가장 안쪽 단계 이름이다.
+    static const char*& CurrentStageName()
+    {
+        thread_local const char* name = "tiles";
+        return name;
+    }
+
+private:
+    struct ThreadRecord
+    {
+        int threadId = 0;
+        std::vector<ProfileEvent> events;
+        int perfFds[HARDWARE_COUNTER_COUNT] = {-1, -1, -1, -1};
+    };
+
+    ThreadRecord& GetThreadRecord()
+    {
+        thread_local ThreadRecord* record = nullptr;
+        thread_local const Profiler* owner = nullptr;
+        if (record == nullptr || owner != this) {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.push_back(std::make_unique<ThreadRecord>());
+            record = threads.back().get();
+            record->threadId = static_cast<int>(threads.size()) - 1;
+            record->events.reserve(1024);
+            owner = this;
+            if (useHardwareCounters) {
+                OpenHardwareCounters(*record);
+            }
+        }
+        return *record;
+    }
+
+    static void OpenHardwareCounters(ThreadRecord& thread)
+    {
+#if PROFILER_PERF_EVENTS
+        static const uint64_t configs[HARDWARE_COUNTER_COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < HARDWARE_COUNTER_COUNT; ++i) {
+            perf_event_attr attr = {};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // pid 0, cpu -1: 이 스레드가 어느 CPU 에서 돌든 센다.
+            thread.perfFds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#else
+        (void)thread;
+#endif
+    }
+
+    static void CloseHardwareCounters(ThreadRecord& thread)
+    {
+#if PROFILER_PERF_EVENTS
+        for (int& fd : thread.perfFds) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+#else
+        (void)thread;
+#endif
+    }
+
+    static int64_t ReadHardwareCounter(int fd)
+    {
+#if PROFILER_PERF_EVENTS
+        uint64_t value = 0;
+        if (fd >= 0 && read(fd, &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value))) {
+            return static_cast<int64_t>(value);
+        }
+#else
+        (void)fd;
+#endif
+        return 0;
+    }
+
+    bool HasHardwareCounters() const
+    {
+        for (const std::unique_ptr<ThreadRecord>& thread : threads) {
+            if (thread->perfFds[0] >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static int64_t GetPeakResidentBytes()
+    {
+#if PROFILER_PERF_EVENTS
+        rusage usage = {};
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+        }
+#endif
+        return 0;
+    }
+
+    std::atomic<bool> enabled = false;
+    bool useHardwareCounters = false;
+    std::chrono::steady_clock::time_point origin;
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadRecord>> threads;
+    std::atomic<int64_t> counters[PROFILE_COUNTER_COUNT] = {};
+    std::atomic<int64_t> liveBufferBytes = 0;
+    std::atomic<int64_t> peakBufferBytes = 0;
+    std::map<std::string, std::array<int64_t, HARDWARE_COUNTER_COUNT>> stageHardwareCounters;
+};
+
+// Chrome trace-event 형식(chrome://tracing, Perfetto 에서 열 수 있다). 시간 단위는 마이크로초.
+inline bool Profiler::WriteTrace(const char* filename) const
+{
+    std::ofstream file(filename);
+    if (!file) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    char line[256];
+    for (const std::unique_ptr<ThreadRecord>& thread : threads) {
+        std::snprintf(line, sizeof(line), "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s %d\"}}",
+            first ? "" : ",\n", thread->threadId, thread->threadId == 0 ? "main" : "worker", thread->threadId);
+        file << line;
+        first = false;
+        for (const ProfileEvent& event : thread->events) {
+            const bool isTile = event.tileX >= 0;
+            std::snprintf(line, sizeof(line), ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                event.name, isTile ? "tile" : "stage", thread->threadId, event.startNs * 1e-3, event.durationNs * 1e-3);
+            file << line;
+            if (isTile) {
+                std::snprintf(line, sizeof(line), ", \"args\": {\"x\": %d, \"y\": %d}", event.tileX, event.tileY);
+                file << line;
+            }
+            file << "}";
+        }
+    }
+    file << "\n], \"otherData\": {";
+    std::snprintf(line, sizeof(line), "\"samples\": %lld, \"fxaa_edge_pixels\": %lld, \"bytes_written\": %lld, \"peak_buffer_bytes\": %lld",
+        static_cast<long long>(counters[static_cast<int>(EProfileCounter::SAMPLES)].load()),
+        static_cast<long long>(counters[static_cast<int>(EProfileCounter::FXAA_EDGE_PIXELS)].load()),
+        static_cast<long long>(counters[static_cast<int>(EProfileCounter::BYTES_WRITTEN)].load()),
+        static_cast<long long>(peakBufferBytes.load()));
+    file << line << "}}\n";
+    return static_cast<bool>(file);
+}
+
+inline void Profiler::PrintStats(std::ostream& out) const
+{
+    struct EventSummary
+    {
+        int64_t count = 0;
+        int64_t totalNs = 0;
+        int64_t minNs = 0;
+        int64_t maxNs = 0;
+    };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // 단계는 처음 나온 순서대로 보여 준다.
+    std::vector<std::string> stageOrder;
+    std::map<std::string, EventSummary> stages;
+    std::map<std::string, EventSummary> tiles;
+    std::vector<std::pair<int64_t, std::string>> firstSeen;
+    for (const std::unique_ptr<ThreadRecord>& thread : threads) {
+        for (const ProfileEvent& event : thread->events) {
+            const bool isTile = event.tileX >= 0;
+            EventSummary& summary = isTile ? tiles[event.name] : stages[event.name];
+            if (!isTile && summary.count == 0) {
+                firstSeen.push_back({event.startNs, event.name});
+            }
+            summary.minNs = (summary.count == 0) ? event.durationNs : std::min(summary.minNs, event.durationNs);
+            summary.maxNs = std::max(summary.maxNs, event.durationNs);
+            summary.totalNs += event.durationNs;
+            ++summary.count;
+        }
+    }
+    std::sort(firstSeen.begin(), firstSeen.end());
+
+    char line[256];
+    out << "Stages:" << std::endl;
+    std::snprintf(line, sizeof(line), "  %-14s %7s %12s %10s %10s %10s", "stage", "calls", "total ms", "tiles", "tile avg", "tile max");
+    out << line << std::endl;
+    for (const auto& [startNs, name] : firstSeen) {
+        const EventSummary& stage = stages[name];
+        std::snprintf(line, sizeof(line), "  %-14s %7lld %12.3f", name.c_str(), static_cast<long long>(stage.count), stage.totalNs * 1e-6);
+        out << line;
+        const auto tile = tiles.find(name);
+        if (tile != tiles.end()) {
+            std::snprintf(line, sizeof(line), " %10lld %10.3f %10.3f", static_cast<long long>(tile->second.count), tile->second.totalNs * 1e-6 / tile->second.count, tile->second.maxNs * 1e-6);
+            out << line;
+        }
+        out << std::endl;
+    }
+
+    out << "Counters:" << std::endl;
+    out << "  samples evaluated   " << counters[static_cast<int>(EProfileCounter::SAMPLES)].load() << std::endl;
+    out << "  fxaa edge pixels    " << counters[static_cast<int>(EProfileCounter::FXAA_EDGE_PIXELS)].load() << std::endl;
+    out << "  bytes written       " << counters[static_cast<int>(EProfileCounter::BYTES_WRITTEN)].load() << std::endl;
+    std::snprintf(line, sizeof(line), "  peak buffers        %.2f MiB", peakBufferBytes.load() / (1024.0 * 1024.0));
+    out << line << std::endl;
+    const int64_t peakResident = GetPeakResidentBytes();
+    if (peakResident > 0) {
+        std::snprintf(line, sizeof(line), "  peak resident       %.2f MiB", peakResident / (1024.0 * 1024.0));
+        out << line << std::endl;
+    }
+
+    if (useHardwareCounters) {
+        out << "Hardware counters:" << std::endl;
+        if (!HasHardwareCounters()) {
+            out << "  unavailable (perf_event_open failed; check kernel.perf_event_paranoid)" << std::endl;
+            return;
+        }
+        std::snprintf(line, sizeof(line), "  %-14s %16s %16s %6s %14s %14s", "stage", "cycles", "instructions", "IPC", "cache misses", "branch misses");
+        out << line << std::endl;
+        for (const auto& [startNs, name] : firstSeen) {
+            const auto found = stageHardwareCounters.find(name);
+            if (found == stageHardwareCounters.end()) {
+                continue;
+            }
+            const std::array<int64_t, HARDWARE_COUNTER_COUNT>& values = found->second;
+            const double ipc = values[0] > 0 ? static_cast<double>(values[1]) / values[0] : 0.0;
+            std::snprintf(line, sizeof(line), "  %-14s %16lld %16lld %6.2f %14lld %14lld", name.c_str(), static_cast<long long>(values[0]), static_cast<long long>(values[1]), ipc,
+                static_cast<long long>(values[2]), static_cast<long long>(values[3]));
+            out << line << std::endl;
+        }
+    }
+}
+
+inline Profiler& GetProfiler()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+inline bool IsProfilingEnabled()
+{
+    return GetProfiler().IsEnabled();
+}
+
+// 범위 하나를 단계 이벤트로 기록한다. 안에서 돈 parallel_for_tiles 의 타일도 이 이름으로 기록된다.
+// name 은 문자열 리터럴처럼 프로그램이 끝날 때까지 살아 있어야 한다.
+class ProfileStage
+{
+public:
+    explicit ProfileStage(const char* name)
+    {
+        if (!IsProfilingEnabled()) {
+            return;
+        }
+        this->name = name;
+        Profiler& profiler = GetProfiler();
+        previousStage = Profiler::CurrentStageName();
+        Profiler::CurrentStageName() = name;
+        profiler.ReadHardwareCounters(startCounters);
+        startNs = profiler.Now();
+    }
+
+    ~ProfileStage()
+    {
+        if (name == nullptr) {
+            return;
+        }
+        Profiler& profiler = GetProfiler();
+        const int64_t endNs = profiler.Now();
+        profiler.Record({name, startNs, endNs - startNs, -1, -1});
+        int64_t endCounters[HARDWARE_COUNTER_COUNT];
+        profiler.ReadHardwareCounters(endCounters);
+        for (int i = 0; i < HARDWARE_COUNTER_COUNT; ++i) {
+            endCounters[i] -= startCounters[i];
+        }
+        profiler.AddStageHardwareCounters(name, endCounters);
+        Profiler::CurrentStageName() = previousStage;
+    }
+
+    ProfileStage(const ProfileStage&) = delete;
+    ProfileStage& operator=(const ProfileStage&) = delete;
+
+private:
+    const char* name = nullptr;
+    const char* previousStage = nullptr;
+    int64_t startNs = 0;
+    int64_t startCounters[HARDWARE_COUNTER_COUNT] = {};
+};
+
+static void profile_add_counter(EProfileCounter counter, int64_t value)
+{
+    if (IsProfilingEnabled()) {
+        GetProfiler().AddCounter(counter, value);
+    }
+}
+
+static void profile_track_buffer(int64_t bytes)
+{
+    if (IsProfilingEnabled()) {
+        GetProfiler().TrackBuffer(bytes);
+    }
+}
+
+static void profile_release_buffer(int64_t bytes)
+{
+    if (IsProfilingEnabled()) {
+        GetProfiler().ReleaseBuffer(bytes);
+    }
+}
@@ -0,0 +1,379 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "fxaa.h"
+#include "math.h"
+#include "profiler.h"
+#include "quantize.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+// 마감 시간 안에 미리 보기를 내는 점진 렌더.
+// 거친 블록 이미지 -> 픽셀당 샘플 1개 -> AA 샘플을 몇 번에 나눠 더하는 순서로 이미지를 다듬고, 단계마다 그때의 이미지를 내놓는다.
+// AA 샘플은 단일 렌더와 같은 위치, 같은 순서로 픽셀별 합에 이어 더하므로 마지막 단계까지 마치면 결과는 단일 렌더와 비트 단위로 같다.
+
+enum class EProgressivePass {
+    COARSE,     // PROGRESSIVE_COARSE_BLOCK 블록마다 샘플 1개
+    PIXEL,      // 픽셀 중심 샘플 1개(NONE/FXAA/ANALYTIC 은 이것이 최종 샘플링)
+    SAMPLES,    // SSAA/MSAA 샘플 [firstSample, lastSample) 을 합에 더한다
+    ADAPTIVE,   // 적응형 렌더를 한 번에
+    FXAA        // PIXEL 결과에 FXAA
+};
+
+constexpr int PROGRESSIVE_COARSE_BLOCK = 8;
+
+struct ProgressivePass
+{
+    EProgressivePass type = EProgressivePass::COARSE;
+    int firstSample = 0;
+    int lastSample = 0;
+};
+
+// 단계를 하나 마칠 때마다 콜백에 넘기는 정보.
+struct ProgressiveFrame
+{
+    int pass = 0;
+    EProgressivePass type = EProgressivePass::COARSE;
+    int samplesPerPixel = 0;    // SAMPLES 는 지금까지 더한 AA 샘플 수, PIXEL/FXAA 는 1, ADAPTIVE 는 최대 AALevel^2, COARSE 는 0
+    double refinedFraction = 1.0;   // 마감 시간에 끊긴 SAMPLES 단계는 마친 타일 비율
+    double milliseconds = 0.0;      // 렌더 시작부터 이 단계가 끝날 때까지
+    bool final = false;             // 단일 렌더와 같은 이미지
+};
+
+using ProgressiveCallback = std::function<void(const ProgressiveFrame& frame, const std::vector<vec3f>& pixels)>;
+
+static const char* get_progressive_pass_name(EProgressivePass type)
+{
+    switch (type) {
+        case EProgressivePass::COARSE: return "coarse";
+        case EProgressivePass::PIXEL: return "pixel";
+        case EProgressivePass::SAMPLES: return "samples";
+        case EProgressivePass::ADAPTIVE: return "adaptive";
+        case EProgressivePass::FXAA: return "fxaa";
+    }
+    return "";
+}
+
+// SSAA 는 서브 행 1, 2, 4, ... 개까지, MSAA 는 샘플 2, 4, 8, ... 개까지 늘려 간다.
+// 레벨 1 의 SSAA/MSAA 는 AA 샘플 하나가 곧 최종 이미지이므로 PIXEL 단계를 건너뛴다.
+static std::vector<ProgressivePass> plan_progressive_passes(const EAAType AAType, const int AALevel)
+{
+    const int level = clamp(AALevel, 1, MAX_AA_LEVEL);
+    std::vector<ProgressivePass> passes;
+    passes.push_back({EProgressivePass::COARSE, 0, 0});
+
+    const bool multiSample = AAType == EAAType::SSAA || AAType == EAAType::MSAA;
+    if (!multiSample || level > 1) {
+        passes.push_back({EProgressivePass::PIXEL, 0, 0});
+    }
+    if (AAType == EAAType::SSAA) {
+        for (int rows = 1, previous = 0; previous < level; rows *= 2) {
+            const int last = std::min(rows, level);
+            passes.push_back({EProgressivePass::SAMPLES, previous * level, last * level});
+            previous = last;
+        }
+    } else if (AAType == EAAType::MSAA) {
+        for (int count = std::min(2, level), previous = 0; previous < level; count *= 2) {
+            const int last = std::min(count, level);
+            passes.push_back({EProgressivePass::SAMPLES, previous, last});
+            previous = last;
+        }
+    } else if (AAType == EAAType::ADAPTIVE) {
+        passes.push_back({EProgressivePass::ADAPTIVE, 0, 0});
+    } else if (AAType == EAAType::FXAA) {
+        passes.push_back({EProgressivePass::FXAA, 0, 0});
+    }
+    return passes;
+}
+
+// region 을 블록으로 나눠 블록 가운데 픽셀의 중심 샘플 하나로 블록을 채운다. 샘플 수를 반환한다.
+// 블록을 모두 평가한 뒤에 채우고, 평가에 걸린 시간을 sampleMilliseconds 에 쓴다(다음 단계의 시간을 어림하는 데 쓴다).
+// pixels 는 비운 뒤 행을 이어 붙여 채운다. 미리 0 으로 채우지 않으므로 큰 이미지도 메모리를 한 번만 쓴다.
+template<typename Pattern>
+static int64_t render_progressive_coarse(const vec2i& outputSize, const Pattern& pattern, const RenderTile& region, std::vector<vec3f>& pixels, double& sampleMilliseconds)
+{
+    const int width = region.max.x - region.min.x;
+    const int height = region.max.y - region.min.y;
+    const int blocksX = (width + PROGRESSIVE_COARSE_BLOCK - 1) / PROGRESSIVE_COARSE_BLOCK;
+    const int blocksY = (height + PROGRESSIVE_COARSE_BLOCK - 1) / PROGRESSIVE_COARSE_BLOCK;
+    std::vector<vec3f> blockColors(static_cast<size_t>(blocksX) * blocksY);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    GetThreadPool().ParallelFor(blocksY, [&](int blockY) {
+        std::vector<float> u(blocksX);
+        std::vector<float> v(blocksX);
+        std::vector<float> values(blocksX);
+        std::vector<int> indices(blocksX);
+
+        const int minY = blockY * PROGRESSIVE_COARSE_BLOCK;
+        const int maxY = std::min(minY + PROGRESSIVE_COARSE_BLOCK, height);
+        const int sampleY = region.min.y + (minY + maxY - 1) / 2;
+        for (int blockX = 0; blockX < blocksX; ++blockX) {
+            const int minX = blockX * PROGRESSIVE_COARSE_BLOCK;
+            const int maxX = std::min(minX + PROGRESSIVE_COARSE_BLOCK, width);
+            u[blockX] = (static_cast<float>(region.min.x + (minX + maxX - 1) / 2) + 0.5f) / outputSize.x;
+            v[blockX] = (static_cast<float>(sampleY) + 0.5f) / outputSize.y;
+        }
+        SampleBatch batch;
+        batch.u = u.data();
+        batch.v = v.data();
+        batch.count = blocksX;
+        batch.colors = blockColors.data() + static_cast<size_t>(blockY) * blocksX;
+        batch.values = values.data();
+        batch.indices = indices.data();
+        pattern.EvaluateBatch(batch);
+    });
+    sampleMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // 블록 한 줄의 행은 모두 같으므로 한 행을 만들어 블록 높이만큼 붙인다.
+    std::vector<vec3f> row(width);
+    pixels.clear();
+    pixels.reserve(static_cast<size_t>(width) * height);
+    for (int blockY = 0; blockY < blocksY; ++blockY) {
+        const vec3f* colors = blockColors.data() + static_cast<size_t>(blockY) * blocksX;
+        for (int x = 0; x < width; ++x) {
+            row[x] = colors[x / PROGRESSIVE_COARSE_BLOCK];
+        }
+        for (int y = blockY * PROGRESSIVE_COARSE_BLOCK; y < std::min((blockY + 1) * PROGRESSIVE_COARSE_BLOCK, height); ++y) {
+            pixels.insert(pixels.end(), row.begin(), row.end());
+        }
+    }
+    return static_cast<int64_t>(blocksX) * blocksY;
+}
+
+// SSAA/MSAA 샘플 [firstSample, lastSample) 를 픽셀별 합 sums 에 더하고 pixels 에 지금까지의 평균을 쓴다.
+// 좌표와 더하는 순서는 fill_sample_row/render_pattern_tile 과 같다(SSAA 샘플 번호는 subY * level + subX).
+// deadline 이 지나면 아직 시작하지 않은 타일은 건너뛰고 그 픽셀은 앞 단계 값으로 남긴다. 처리한 픽셀 수를 반환한다.
+template<typename Pattern>
+static int64_t accumulate_progressive_samples(const vec2i& outputSize, const EAAType AAType, const int level, const Pattern& pattern, const RenderTile& region,
+                                              int firstSample, int lastSample, std::chrono::steady_clock::time_point deadline, bool useDeadline, vec3f* sums, vec3f* pixels)
+{
+    const bool isSSAA = AAType == EAAType::SSAA;
+    const int regionWidth = region.max.x - region.min.x;
+    const std::vector<vec2f> msaaOffsets = isSSAA ? std::vector<vec2f>() : get_msaa_sample_offsets(level, std::make_index_sequence<MAX_AA_LEVEL>());
+    const float InvAALevel = 1.0f / static_cast<float>(level);
+    // SSAA 는 서브 행 하나, MSAA 는 이번 단계의 샘플 전부를 한 묶음으로 평가한다.
+    const int samplesPerPass = isSSAA ? level : lastSample - firstSample;
+    const int rowPasses = isSSAA ? (lastSample - firstSample) / level : 1;
+    std::atomic<int64_t> processedPixels = 0;
+
+    parallel_for_tiles(region, [&](const RenderTile& tile) {
+        if (useDeadline && std::chrono::steady_clock::now() >= deadline) {
+            return;
+        }
+        const int width = tile.max.x - tile.min.x;
+        SampleScratch& scratch = get_sample_scratch();
+        scratch.Reserve(static_cast<size_t>(width) * samplesPerPass, 0);
+        float* u = scratch.u.data();
+        float* v = scratch.v.data();
+        const vec3f* colors = scratch.colors.data();
+
+        for (int y = tile.min.y; y < tile.max.y; y++) {
+            const size_t rowOffset = static_cast<size_t>(y - region.min.y) * regionWidth + (tile.min.x - region.min.x);
+            vec3f* rowSums = sums + rowOffset;
+            for (int pass = 0; pass < rowPasses; pass++) {
+                int count = 0;
+                if (isSSAA) {
+                    const int subY = firstSample / level + pass;
+                    const float rowV = ssaa_sample_coord(y * level + subY, InvAALevel, outputSize.y);
+                    for (int x = tile.min.x; x < tile.max.x; x++) {
+                        for (int subX = 0; subX < level; subX++) {
+                            u[count] = ssaa_sample_coord(x * level + subX, InvAALevel, outputSize.x);
+                            v[count] = rowV;
+                            count++;
+                        }
+                    }
+                } else {
+                    for (int x = tile.min.x; x < tile.max.x; x++) {
+                        for (int i = firstSample; i < lastSample; i++) {
+                            u[count] = (static_cast<float>(x) + 0.5f + msaaOffsets[i].x) / outputSize.x;
+                            v[count] = (static_cast<float>(y) + 0.5f + msaaOffsets[i].y) / outputSize.y;
+                            count++;
+                        }
+                    }
+                }
+                pattern.EvaluateBatch(scratch.MakeBatch(count));
+
+                for (int i = 0; i < width; i++) {
+                    const vec3f* pixelSamples = colors + i * samplesPerPass;
+                    for (int s = 0; s < samplesPerPass; s++) {
+                        rowSums[i] += pixelSamples[s];
+                    }
+                }
+            }
+            // 단일 렌더와 같이 합을 샘플 수로 나눈다.
+            vec3f* rowPixels = pixels + rowOffset;
+            for (int i = 0; i < width; i++) {
+                rowPixels[i] = rowSums[i] / static_cast<float>(lastSample);
+            }
+        }
+        processedPixels += static_cast<int64_t>(width) * (tile.max.y - tile.min.y);
+    });
+    return processedPixels.load();
+}
+
+// 값이 오른쪽/아래 픽셀과 다른 픽셀 비율. 네 줄에 한 줄만 본다. ADAPTIVE 가 세분할 픽셀 수를 어림하는 데 쓴다.
+static double estimate_progressive_edge_fraction(const std::vector<vec3f>& pixels, int width, int height)
+{
+    int64_t edges = 0;
+    int64_t checked = 0;
+    for (int y = 0; y + 1 < height; y += 4) {
+        const vec3f* row = pixels.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x + 1 < width; ++x) {
+            edges += (adaptive_colors_differ(row[x], row[x + 1]) || adaptive_colors_differ(row[x], row[x + width])) ? 1 : 0;
+        }
+        checked += width - 1;
+    }
+    return checked > 0 ? static_cast<double>(edges) / checked : 1.0;
+}
+
+// roi 를 점진 렌더한다. 단계마다 roi 크기의 float 이미지를 onFrame 에 넘기고, 마지막으로 마친 단계의 이미지를 image 에 남긴다.
+// budgetMilliseconds 가 0 보다 크면 그 시간 안에 끝날 단계만 시작한다. 앞 단계에서 잰 샘플당 시간으로 다음 단계의 시간을 어림하고,
+// SAMPLES 단계는 타일 단위로 마감 시간에 끊는다(끊긴 단계는 일부 타일만 다듬어진다).
+// COARSE 단계는 마감 시간과 상관없이 한다. 샘플은 블록당 하나지만 roi 크기의 float 이미지를 한 번 채우므로,
+// 첫 프레임까지의 시간은 이 채우기(4K 에서 수십 ms)보다 짧아지지 않는다.
+// 모든 단계를 마쳤으면(단일 렌더와 같은 이미지이면) true.
+template<typename Pattern>
+static bool render_pattern_progressive(const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const RenderTile& roi, double budgetMilliseconds,
+                                       std::vector<vec3f>& image, const ProgressiveCallback& onFrame, RenderSampleStats* stats = nullptr)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    const bool useDeadline = budgetMilliseconds > 0.0;
+    const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(budgetMilliseconds));
+    auto elapsedMilliseconds = [&]() { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+    const int level = clamp(AALevel, 1, MAX_AA_LEVEL);
+    const vec2i roiSize = roi.max - roi.min;
+    const int64_t roiPixels = static_cast<int64_t>(roiSize.x) * roiSize.y;
+
+    // FXAA 는 위아래 halo 행까지 전체 폭으로 렌더해 두고 roi 만 거른다. 나머지는 roi 에 바로 렌더한다.
+    RenderTile region = roi;
+    if (AAType == EAAType::FXAA) {
+        region.min = {0, std::max(roi.min.y - FXAA_HALO_ROWS, 0)};
+        region.max = {outputSize.x, std::min(roi.max.y + FXAA_HALO_ROWS, outputSize.y)};
+    }
+    const int regionWidth = region.max.x - region.min.x;
+    const int regionHeight = region.max.y - region.min.y;
+    const bool cropped = AAType == EAAType::FXAA;
+
+    // 이미지는 COARSE 단계가 처음 채울 때 잡는다.
+    std::vector<vec3f> rendered;
+    std::vector<vec3f>& target = cropped ? rendered : image;
+    std::vector<vec3f> sums;
+
+    RenderSampleStats totalStats;
+    totalStats.pixelCount = roiPixels;
+    double sampleMilliseconds = 0.0;    // 마지막으로 샘플을 평가한 단계의 샘플당 시간
+    double pixelPassMilliseconds = 0.0;
+
+    const std::vector<ProgressivePass> passes = plan_progressive_passes(AAType, level);
+    bool complete = true;
+    for (size_t passIndex = 0; passIndex < passes.size(); ++passIndex) {
+        const ProgressivePass& pass = passes[passIndex];
+        const double elapsed = elapsedMilliseconds();
+        if (passIndex > 0 && useDeadline) {
+            // 끊을 수 없는 단계는 어림한 시간이 남은 시간 안에 들어올 때만 시작한다.
+            double estimate = 0.0;
+            switch (pass.type) {
+                case EProgressivePass::PIXEL: estimate = sampleMilliseconds * roiPixels; break;
+                case EProgressivePass::ADAPTIVE: estimate = sampleMilliseconds * roiPixels * (1.0 + estimate_progressive_edge_fraction(image, roiSize.x, roiSize.y) * level * level); break;
+                case EProgressivePass::FXAA: estimate = pixelPassMilliseconds; break;
+                default: break;
+            }
+            if (elapsed >= budgetMilliseconds || elapsed + estimate > budgetMilliseconds) {
+                complete = false;
+                break;
+            }
+        }
+
+        ProgressiveFrame frame;
+        frame.pass = static_cast<int>(passIndex);
+        frame.type = pass.type;
+        frame.samplesPerPixel = (pass.type == EProgressivePass::COARSE) ? 0 : 1;
+        int64_t passSampleCount = 0;
+        {
+            ProfileStage profileStage("progressive");
+            RenderSampleStats passStats;
+            switch (pass.type) {
+                case EProgressivePass::COARSE: {
+                    double coarseMilliseconds = 0.0;
+                    passStats.sampleCount = render_progressive_coarse(outputSize, pattern, region, target, coarseMilliseconds);
+                    profile_add_counter(EProfileCounter::SAMPLES, passStats.sampleCount);
+                    sampleMilliseconds = coarseMilliseconds / passStats.sampleCount;
+                    break;
+                }
+                case EProgressivePass::PIXEL:
+                    // ANALYTIC 은 패턴 펑터가 중심 샘플에서 픽셀 적분을 내므로 그대로 최종 이미지다.
+                    render_pattern_region(outputSize, AAType == EAAType::ANALYTIC ? EAAType::ANALYTIC : EAAType::NONE, 1, pattern, region, target.data(), &passStats);
+                    break;
+                case EProgressivePass::SAMPLES: {
+                    if (sums.empty()) {
+                        sums.assign(static_cast<size_t>(regionWidth) * regionHeight, vec3f::Zero);
+                    }
+                    const int64_t processed = accumulate_progressive_samples(outputSize, AAType, level, pattern, region, pass.firstSample, pass.lastSample, deadline, useDeadline, sums.data(), target.data());
+                    if (processed == 0) {
+                        complete = false;
+                    }
+                    passStats.sampleCount = processed * (pass.lastSample - pass.firstSample);
+                    profile_add_counter(EProfileCounter::SAMPLES, passStats.sampleCount);
+                    frame.samplesPerPixel = pass.lastSample;
+                    frame.refinedFraction = static_cast<double>(processed) / roiPixels;
+                    break;
+                }
+                case EProgressivePass::ADAPTIVE:
+                    render_pattern_region(outputSize, EAAType::ADAPTIVE, level, pattern, region, target.data(), &passStats);
+                    frame.samplesPerPixel = level * level;
+                    totalStats.refinedPixelCount += passStats.refinedPixelCount;
+                    break;
+                case EProgressivePass::FXAA:
+                    apply_fxaa_region(outputSize, rendered.data(), region.min.y, regionHeight, roi, make_float_target(image.data(), roiSize.x));
+                    break;
+            }
+            totalStats.sampleCount += passStats.sampleCount;
+            passSampleCount = passStats.sampleCount;
+        }
+        if (!complete) {
+            // 타일 하나도 시작하기 전에 마감 시간이 지났다. 이미지는 앞 단계 그대로다.
+            break;
+        }
+        const double passMilliseconds = elapsedMilliseconds() - elapsed;
+        if ((pass.type == EProgressivePass::PIXEL || pass.type == EProgressivePass::SAMPLES) && passSampleCount > 0) {
+            sampleMilliseconds = passMilliseconds / passSampleCount;
+        }
+        if (pass.type == EProgressivePass::PIXEL) {
+            pixelPassMilliseconds = passMilliseconds;
+        }
+
+        // FXAA 전 단계는 렌더한 행에서 roi 를 잘라 보여 준다.
+        if (cropped && pass.type != EProgressivePass::FXAA) {
+            image.clear();
+            image.reserve(static_cast<size_t>(roiPixels));
+            for (int y = 0; y < roiSize.y; ++y) {
+                const vec3f* source = rendered.data() + static_cast<size_t>(roi.min.y - region.min.y + y) * regionWidth + (roi.min.x - region.min.x);
+                image.insert(image.end(), source, source + roiSize.x);
+            }
+        }
+
+        frame.final = (passIndex + 1 == passes.size()) && frame.refinedFraction >= 1.0;
+        frame.milliseconds = elapsedMilliseconds();
+        if (onFrame) {
+            onFrame(frame, image);
+        }
+        if (frame.refinedFraction < 1.0) {
+            complete = false;
+            break;
+        }
+    }
+
+    if (stats) {
+        *stats += totalStats;
+    }
+    return complete;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "math.h"
+#include "pattern_simd.h"
+#include "profiler.h"
+
+enum class EPixelFormat {
+    RGB_F32,    // vec3f
+    RGB8,       // 채널당 1바이트
+    RGB16       // 채널당 2바이트, PPM 과 같은 빅엔디언
+};
+
+enum class EColorEncoding {
+    LINEAR,
+    SRGB,
+    GAMMA
+};
+
+static int get_bytes_per_pixel(EPixelFormat format)
+{
+    switch (format) {
+        case EPixelFormat::RGB8: return 3;
+        case EPixelFormat::RGB16: return 6;
+        default: return static_cast<int>(sizeof(vec3f));
+    }
+}
+
+// 선형 [0, 1] 색을 8/16비트 정수로 바꾸는 인코더.
+// 범위 밖 값(NaN 포함)은 잘라내고 가장 가까운 정수로 반올림한다.
+// sRGB/감마는 미리 계산한 테이블을 쓴다(8비트 출력은 4096칸, 16비트 출력은 65536칸).
+class PixelEncoder
+{
+public:
+    PixelEncoder(EPixelFormat format = EPixelFormat::RGB8, EColorEncoding encoding = EColorEncoding::LINEAR, float gamma = 2.2f)
+        : format(format == EPixelFormat::RGB16 ? EPixelFormat::RGB16 : EPixelFormat::RGB8)
+        , encoding(encoding)
+        , maxValue(format == EPixelFormat::RGB16 ? 65535 : 255)
+    {
+        if (encoding == EColorEncoding::LINEAR) {
+            return;
+        }
+
+        const int tableSize = (this->format == EPixelFormat::RGB16) ? 65536 : 4096;
+        table.resize(tableSize);
+        tableScale = static_cast<float>(tableSize - 1);
+        for (int i = 0; i < tableSize; ++i) {
+            const double value = static_cast<double>(i) / (tableSize - 1);
+            double encoded = 0.0;
+            if (encoding == EColorEncoding::SRGB) {
+                encoded = (value <= 0.0031308) ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+            } else {
+                encoded = std::pow(value, 1.0 / static_cast<double>(gamma));
+            }
+            table[i] = static_cast<uint16_t>(std::lround(clamp(encoded, 0.0, 1.0) * maxValue));
+        }
+    }
+
+    EPixelFormat GetFormat() const { return format; }
+    EColorEncoding GetEncoding() const { return encoding; }
+    int GetMaxValue() const { return maxValue; }
+    int GetBytesPerPixel() const { return get_bytes_per_pixel(format); }
+
+    uint16_t Encode(float value) const
+    {
+        const float clamped = clamp(value, 0.0f, 1.0f);
+        if (table.empty()) {
+            return static_cast<uint16_t>(clamped * static_cast<float>(maxValue) + 0.5f);
+        }
+        return table[static_cast<int>(clamped * tableScale + 0.5f)];
+    }
+
+    // count 개의 색을 out 에 RGB8 또는 RGB16(빅엔디언) 으로 쓴다.
+    void EncodeRow(const vec3f* colors, size_t count, unsigned char* out) const
+    {
+        if (format == EPixelFormat::RGB8 && table.empty()) {
+            // 선형 RGB8 은 채널을 구분할 필요가 없어 float 배열 하나로 보고 SIMD 커널로 바꾼다.
+            GetPatternKernels().quantizeUnorm8(reinterpret_cast<const float*>(colors), count * 3, static_cast<float>(maxValue), out);
+        } else if (format == EPixelFormat::RGB8) {
+            for (size_t i = 0; i < count; ++i) {
+                out[i * 3 + 0] = static_cast<unsigned char>(Encode(colors[i].x));
+                out[i * 3 + 1] = static_cast<unsigned char>(Encode(colors[i].y));
+                out[i * 3 + 2] = static_cast<unsigned char>(Encode(colors[i].z));
+            }
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                const uint16_t channels[3] = {Encode(colors[i].x), Encode(colors[i].y), Encode(colors[i].z)};
+                for (int c = 0; c < 3; ++c) {
+                    out[i * 6 + c * 2 + 0] = static_cast<unsigned char>(channels[c] >> 8);
+                    out[i * 6 + c * 2 + 1] = static_cast<unsigned char>(channels[c] & 0xff);
+                }
+            }
+        }
+    }
+
+private:
+    EPixelFormat format;
+    EColorEncoding encoding;
+    int maxValue;
+    float tableScale = 0.0f;
+    std::vector<uint16_t> table;
+};
+
+// 렌더 결과를 쓸 곳. data 는 영역의 왼쪽 위 픽셀, rowStride 는 바이트 단위 행 간격.
+// RGB8/RGB16 이면 encoder 로 바로 정수 픽셀을 만든다.
+struct RenderTarget
+{
+    void* data = nullptr;
+    size_t rowStride = 0;
+    EPixelFormat format = EPixelFormat::RGB_F32;
+    const PixelEncoder* encoder = nullptr;
+
+    // region 기준 (x, y) 부터 count 개의 색을 쓴다.
+    void StoreRow(int x, int y, const vec3f* colors, int count) const
+    {
+        unsigned char* row = static_cast<unsigned char*>(data) + y * rowStride;
+        if (format == EPixelFormat::RGB_F32) {
+            std::memcpy(row + x * sizeof(vec3f), colors, count * sizeof(vec3f));
+        } else {
+            encoder->EncodeRow(colors, count, row + static_cast<size_t>(x) * encoder->GetBytesPerPixel());
+        }
+    }
+
+    size_t GetBytesPerPixel() const { return static_cast<size_t>(get_bytes_per_pixel(format)); }
+
+    // region 기준 y 행의 첫 바이트.
+    unsigned char* GetRow(int y) const
+    {
+        return static_cast<unsigned char*>(data) + y * rowStride;
+    }
+};
+
+static RenderTarget make_float_target(vec3f* pixels, int width)
+{
+    RenderTarget target;
+    target.data = pixels;
+    target.rowStride = static_cast<size_t>(width) * sizeof(vec3f);
+    target.format = EPixelFormat::RGB_F32;
+    return target;
+}
+
+static RenderTarget make_encoded_target(unsigned char* data, int width, const PixelEncoder& encoder)
+{
+    RenderTarget target;
+    target.data = data;
+    target.rowStride = static_cast<size_t>(width) * encoder.GetBytesPerPixel();
+    target.format = encoder.GetFormat();
+    target.encoder = &encoder;
+    return target;
+}
+
+// 이미 만들어진 float 이미지를 encoder 형식으로 바꾼다.
+inline void quantize_pixels(const vec3f* pixels, size_t count, const PixelEncoder& encoder, unsigned char* data)
+{
+    ProfileStage profileStage("quantize");
+    encoder.EncodeRow(pixels, count, data);
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// 완성된 이미지를 렌더 파라미터 해시로 찾는 디스크 캐시.
+// 파일 이름이 내용 키이므로 같은 파라미터로 다시 요청하면 렌더하지 않고 파일을 복사한다.
+// 쓰기는 임시 파일에 쓴 뒤 rename 하므로 여러 프로세스가 같은 디렉터리를 함께 써도 반쯤 쓴 파일을 읽지 않는다.
+// 용량을 넘으면 가장 오래 쓰이지 않은(수정 시각이 오래된) 파일부터 지운다. 읽을 때 수정 시각을 갱신한다.
+
+constexpr int64_t DEFAULT_RENDER_CACHE_MEGABYTES = 1024;
+
+// 빌드가 바뀌면 같은 파라미터라도 결과가 다를 수 있으므로 빌드 식별자를 키에 넣는다.
+// CMake 가 버전, 출력 리비전, 커밋 해시로 BASICAA_BUILD_ID 를 정의한다. 다시 빌드해도 같은 소스면 같은 값이다.
+#ifndef BASICAA_BUILD_ID
+#define BASICAA_BUILD_ID "unversioned"
+#endif
+constexpr const char* RENDER_CACHE_BUILD_ID = BASICAA_BUILD_ID;
+
+// 이보다 오래된 임시 파일(.ppm.tmp*)은 중간에 끝난 Store 가 남긴 것으로 보고 Evict 에서 지운다.
+constexpr std::chrono::minutes RENDER_CACHE_STALE_TEMPORARY_AGE{60};
+
+// 렌더 파라미터를 "name=value;" 로 이어 붙여 키를 만든다. 같은 순서로 넣어야 같은 키가 된다.
+class RenderCacheKey
+{
+public:
+    RenderCacheKey()
+    {
+        Add("build", RENDER_CACHE_BUILD_ID);
+    }
+
+    RenderCacheKey& Add(const char* name, const std::string& value)
+    {
+        text += name;
+        text += '=';
+        text += value;
+        text += ';';
+        return *this;
+    }
+
+    RenderCacheKey& Add(const char* name, int value) { return Add(name, std::to_string(value)); }
+
+    // 소수 자릿수로 값이 뭉개지지 않도록 비트 그대로 넣는다.
+    RenderCacheKey& Add(const char* name, float value)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%a", value);
+        return Add(name, std::string(buffer));
+    }
+
+    // 64비트 FNV-1a 를 16진수 16자로.
+    std::string GetHash() const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (const char c : text) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        char buffer[17];
+        std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+        return buffer;
+    }
+
+private:
+    std::string text;
+};
+
+class RenderCache
+{
+public:
+    RenderCache(std::filesystem::path directory, int64_t maxBytes)
+        : directory(std::move(directory))
+        , maxBytes(std::max<int64_t>(maxBytes, 0))
+    {
+    }
+
+    // 캐시에 있으면 outputFile 로 복사하고 true.
+    bool Fetch(const RenderCacheKey& key, const std::string& outputFile) const
+    {
+        std::error_code error;
+        const std::filesystem::path entry = GetEntryPath(key);
+        if (!std::filesystem::is_regular_file(entry, error)) {
+            return false;
+        }
+        if (!std::filesystem::copy_file(entry, outputFile, std::filesystem::copy_options::overwrite_existing, error)) {
+            return false;
+        }
+        // LRU 순서를 위해 사용 시각을 남긴다. 그 사이 다른 프로세스가 지웠으면 무시한다.
+        std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), error);
+        return true;
+    }
+
+    // 렌더가 끝난 outputFile 을 캐시에 넣고 용량을 맞춘다. 실패해도 렌더 결과에는 영향이 없다.
+    void Store(const RenderCacheKey& key, const std::string& outputFile) const
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        const std::filesystem::path entry = GetEntryPath(key);
+        const std::filesystem::path temporary = entry.string() + ".tmp" + MakeUniqueSuffix();
+        if (!std::filesystem::copy_file(outputFile, temporary, std::filesystem::copy_options::overwrite_existing, error)) {
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+        std::filesystem::rename(temporary, entry, error);
+        if (error) {
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+        Evict();
+    }
+
+private:
+    std::filesystem::path GetEntryPath(const RenderCacheKey& key) const
+    {
+        return directory / (key.GetHash() + ".ppm");
+    }
+
+    static std::string MakeUniqueSuffix()
+    {
+        std::random_device device;
+        const uint64_t value = (static_cast<uint64_t>(device()) << 32) ^ device()
+            ^ std::hash<std::thread::id>()(std::this_thread::get_id())
+            ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        return std::to_string(value);
+    }
+
+    static bool IsTemporary(const std::filesystem::path& path)
+    {
+        return path.filename().string().find(".ppm.tmp") != std::string::npos;
+    }
+
+    // 완성된 항목(.ppm)의 합이 maxBytes 이하가 될 때까지 오래된 것부터 지운다.
+    // 오래된 임시 파일도 함께 지운다. 쓰는 중인 임시 파일은 수정 시각이 최근이라 남는다.
+    // 다른 프로세스와 동시에 돌아도 지우기 실패는 무시하면 된다.
+    void Evict() const
+    {
+        struct Entry
+        {
+            std::filesystem::path path;
+            std::filesystem::file_time_type lastUse;
+            int64_t size;
+        };
+
+        std::error_code error;
+        std::vector<Entry> entries;
+        int64_t totalBytes = 0;
+        const std::filesystem::file_time_type staleBefore = std::filesystem::file_time_type::clock::now() - RENDER_CACHE_STALE_TEMPORARY_AGE;
+        for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+            std::error_code entryError;
+            if (IsTemporary(it->path())) {
+                if (it->is_regular_file(entryError) && it->last_write_time(entryError) < staleBefore && !entryError) {
+                    std::filesystem::remove(it->path(), entryError);
+                }
+                continue;
+            }
+            if (it->path().extension() != ".ppm" || !it->is_regular_file(entryError)) {
+                continue;
+            }
+            const int64_t size = static_cast<int64_t>(it->file_size(entryError));
+            const std::filesystem::file_time_type lastUse = it->last_write_time(entryError);
+            if (entryError) {
+                continue;
+            }
+            entries.push_back({it->path(), lastUse, size});
+            totalBytes += size;
+        }
+        if (totalBytes <= maxBytes) {
+            return;
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+        for (const Entry& entry : entries) {
+            if (totalBytes <= maxBytes) {
+                break;
+            }
+            std::error_code removeError;
+            std::filesystem::remove(entry.path, removeError);
+            totalBytes -= entry.size;
+        }
+    }
+
+    std::filesystem::path directory;
+    int64_t maxBytes;
+};
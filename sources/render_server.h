@@ -0,0 +1,667 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pattern.h"
+#include "quantize.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define RENDER_SERVER_SUPPORTED 1
+#else
+#define RENDER_SERVER_SUPPORTED 0
+#endif
+
+// Unix 도메인 소켓으로 렌더 요청을 받아 PPM(P6) 바이트를 돌려주는 상주 서버.
+// 프로세스를 요청마다 새로 띄우지 않으므로 스레드 풀과 출력 버퍼를 요청 사이에 재사용한다.
+//
+// 요청은 한 줄짜리 텍스트이고, 한 연결에서 여러 번 보낼 수 있다.
+//   RENDER width=256 height=256 aa=msaa level=2 pattern=checkerboard tile=50 angle=40 [...]\n
+//     -> "OK <바이트 수>\n" 다음에 PPM 파일 바이트
+//   STATS\n    -> "OK requests=N rejected=N errors=N p50_ms=X p99_ms=X\n"
+//   SHUTDOWN\n -> "OK\n" 후 이미 도착한 요청을 마치고 서버를 끝낸다. 쉬고 있는 연결은 닫는다.
+// 잘못된 요청에는 "ERR <이유>\n" 를 보낸다. 빠진 키는 명령줄 렌더와 같은 기본값을 쓰므로
+// 같은 파라미터면 basicAA 가 파일로 쓰는 것과 같은 바이트가 나온다.
+
+constexpr int DEFAULT_SERVER_QUEUE_SIZE = 64;
+constexpr int DEFAULT_SERVER_WORKERS = 4;
+constexpr int MAX_SERVER_IMAGE_SIZE = 16384;
+constexpr int64_t MAX_SERVER_IMAGE_PIXELS = 64ll * 1024 * 1024;
+
+// RENDER 요청 하나의 파라미터.
+struct RenderRequest
+{
+    vec2i outputSize = {1920, 1080};
+    EAAType aaType = EAAType::MSAA;
+    int aaLevel = 2;
+    EPatternType patternType = EPatternType::VORONOI;
+    float checkerboardAngle = 40.0f;
+    float checkerboardTileSize = 50.0f;
+    float circleThickness = 12.0f;
+    float circleGap = 7.0f;
+    int voronoiSiteCount = 100;
+    EVoronoiLookup voronoiLookup = EVoronoiLookup::GRID;
+    EColorEncoding encoding = EColorEncoding::LINEAR;
+    float gamma = 2.2f;
+    int bitDepth = 8;
+};
+
+// "key=value" 목록을 request 에 채운다. 모르는 키나 값이면 error 에 이유를 쓰고 false.
+static bool parse_render_request(std::istream& in, RenderRequest& request, std::string& error)
+{
+    std::string token;
+    while (in >> token) {
+        const size_t equals = token.find('=');
+        if (equals == std::string::npos) {
+            error = "expected key=value: " + token;
+            return false;
+        }
+        const std::string key = token.substr(0, equals);
+        const std::string value = token.substr(equals + 1);
+        if (key == "width") {
+            request.outputSize.x = std::atoi(value.c_str());
+        } else if (key == "height") {
+            request.outputSize.y = std::atoi(value.c_str());
+        } else if (key == "aa") {
+            if (value == "ssaa") {
+                request.aaType = EAAType::SSAA;
+            } else if (value == "msaa") {
+                request.aaType = EAAType::MSAA;
+            } else if (value == "fxaa") {
+                request.aaType = EAAType::FXAA;
+            } else if (value == "analytic") {
+                request.aaType = EAAType::ANALYTIC;
+            } else if (value == "adaptive") {
+                request.aaType = EAAType::ADAPTIVE;
+            } else {
+                error = "unknown aa: " + value;
+                return false;
+            }
+        } else if (key == "level") {
+            request.aaLevel = clamp(std::atoi(value.c_str()), 1, MAX_AA_LEVEL);
+        } else if (key == "pattern") {
+            if (value == "uv") {
+                request.patternType = EPatternType::UV;
+            } else if (value == "checkerboard") {
+                request.patternType = EPatternType::CHECKERBOARD;
+            } else if (value == "circle") {
+                request.patternType = EPatternType::CIRCLE;
+            } else if (value == "voronoi") {
+                request.patternType = EPatternType::VORONOI;
+            } else {
+                error = "unknown pattern: " + value;
+                return false;
+            }
+        } else if (key == "angle") {
+            request.checkerboardAngle = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "tile") {
+            request.checkerboardTileSize = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "thickness") {
+            request.circleThickness = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "gap") {
+            request.circleGap = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "sites") {
+            request.voronoiSiteCount = std::max(std::atoi(value.c_str()), 1);
+        } else if (key == "voronoi") {
+            if (value == "brute") {
+                request.voronoiLookup = EVoronoiLookup::BRUTE_FORCE;
+            } else if (value == "grid") {
+                request.voronoiLookup = EVoronoiLookup::GRID;
+            } else {
+                error = "unknown voronoi lookup: " + value;
+                return false;
+            }
+        } else if (key == "encoding") {
+            if (value == "linear") {
+                request.encoding = EColorEncoding::LINEAR;
+            } else if (value == "srgb") {
+                request.encoding = EColorEncoding::SRGB;
+            } else if (value == "gamma") {
+                request.encoding = EColorEncoding::GAMMA;
+            } else {
+                error = "unknown encoding: " + value;
+                return false;
+            }
+        } else if (key == "gamma") {
+            request.gamma = static_cast<float>(std::atof(value.c_str()));
+            if (request.gamma <= 0.0f) request.gamma = 2.2f;
+        } else if (key == "bits") {
+            request.bitDepth = (std::atoi(value.c_str()) == 16) ? 16 : 8;
+        } else {
+            error = "unknown key: " + key;
+            return false;
+        }
+    }
+
+    const vec2i& size = request.outputSize;
+    if (size.x <= 0 || size.y <= 0 || size.x > MAX_SERVER_IMAGE_SIZE || size.y > MAX_SERVER_IMAGE_SIZE
+        || static_cast<int64_t>(size.x) * size.y > MAX_SERVER_IMAGE_PIXELS) {
+        error = "bad image size";
+        return false;
+    }
+    return true;
+}
+
+// 최근 요청의 처리 시간을 모아 백분위수를 낸다. 서버가 오래 떠 있어도 메모리가 늘지 않도록
+// 마지막 LATENCY_WINDOW 개만 고리 버퍼에 둔다.
+constexpr size_t LATENCY_WINDOW = 4096;
+
+class LatencyRecorder
+{
+public:
+    void Add(double milliseconds)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        samples[static_cast<size_t>(requestCount % LATENCY_WINDOW)] = milliseconds;
+        ++requestCount;
+    }
+
+    void AddRejected() { rejected.fetch_add(1, std::memory_order_relaxed); }
+    void AddError() { errors.fetch_add(1, std::memory_order_relaxed); }
+
+    std::string Summary() const
+    {
+        std::array<double, LATENCY_WINDOW> window;
+        size_t count = 0;
+        int64_t total = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            total = requestCount;
+            count = static_cast<size_t>(std::min<int64_t>(requestCount, LATENCY_WINDOW));
+            std::copy(samples.begin(), samples.begin() + count, window.begin());
+        }
+        auto percentile = [&](double p) {
+            if (count == 0) {
+                return 0.0;
+            }
+            const size_t index = std::min(static_cast<size_t>(p * count), count - 1);
+            std::nth_element(window.begin(), window.begin() + index, window.begin() + count);
+            return window[index];
+        };
+        const double p50 = percentile(0.50);
+        const double p99 = percentile(0.99);
+        char line[256];
+        std::snprintf(line, sizeof(line), "requests=%lld rejected=%lld errors=%lld p50_ms=%.3f p99_ms=%.3f",
+            static_cast<long long>(total), static_cast<long long>(rejected.load()), static_cast<long long>(errors.load()), p50, p99);
+        return line;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::array<double, LATENCY_WINDOW> samples = {};
+    int64_t requestCount = 0;
+    std::atomic<int64_t> rejected = 0;
+    std::atomic<int64_t> errors = 0;
+};
+
+#if RENDER_SERVER_SUPPORTED
+
+inline std::atomic<bool>& RenderServerStopRequested()
+{
+    static std::atomic<bool> stop = false;
+    return stop;
+}
+
+static void render_server_signal_handler(int)
+{
+    RenderServerStopRequested().store(true);
+}
+
+// 응답을 보내다 상대가 이만큼 읽지 않으면 연결을 끊는다.
+constexpr int SERVER_SEND_TIMEOUT_MS = 30000;
+
+// 논블로킹 연결 하나. 받은 바이트를 모아 두었다가 줄 단위로 꺼내고, 보낼 바이트는 끝까지 보낸다.
+class ServerConnection
+{
+public:
+    explicit ServerConnection(int fd)
+        : fd(fd)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    ~ServerConnection()
+    {
+        close(fd);
+    }
+
+    ServerConnection(const ServerConnection&) = delete;
+    ServerConnection& operator=(const ServerConnection&) = delete;
+
+    int GetFd() const { return fd; }
+
+    // 지금 읽을 수 있는 바이트를 모두 받는다. 오류가 났거나 줄이 너무 길면 false.
+    // 상대가 쓰기를 닫아도 이미 받은 줄은 처리할 수 있도록 true 를 반환하고 IsPeerClosed 로 알린다.
+    bool Receive()
+    {
+        constexpr size_t MAX_LINE = 4096;
+        for (;;) {
+            char buffer[4096];
+            const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received > 0) {
+                pending.append(buffer, static_cast<size_t>(received));
+                if (pending.size() > MAX_LINE && pending.find('\n') == std::string::npos) {
+                    return false;
+                }
+                continue;
+            }
+            if (received == 0) {
+                peerClosed = true;
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+
+    bool IsPeerClosed() const { return peerClosed; }
+    bool HasLine() const { return pending.find('\n') != std::string::npos; }
+
+    // 받아 둔 줄 하나를 꺼낸다. HasLine 이 true 일 때만 부른다.
+    std::string TakeLine()
+    {
+        const size_t newline = pending.find('\n');
+        std::string line = pending.substr(0, newline);
+        pending.erase(0, newline + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        return line;
+    }
+
+    // 상대가 SERVER_SEND_TIMEOUT_MS 동안 읽지 않거나, 서버가 끝나는 중에 1초 동안 진척이 없으면 false.
+    template<typename StopCheck>
+    bool Send(const void* data, size_t size, const StopCheck& isStopping)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        int waitedMilliseconds = 0;
+        while (size > 0) {
+#if defined(MSG_NOSIGNAL)
+            const ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+#else
+            const ssize_t sent = send(fd, bytes, size, 0);
+#endif
+            if (sent > 0) {
+                bytes += sent;
+                size -= static_cast<size_t>(sent);
+                waitedMilliseconds = 0;
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                return false;
+            }
+            pollfd writePoll = {fd, POLLOUT, 0};
+            if (poll(&writePoll, 1, 1000) == 0) {
+                waitedMilliseconds += 1000;
+                if (isStopping() || waitedMilliseconds >= SERVER_SEND_TIMEOUT_MS) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    int fd;
+    std::string pending;
+    bool peerClosed = false;
+};
+
+// 연결을 받는 스레드가 쉬고 있는 연결들을 poll 로 지켜보다가, 요청 한 줄이 다 도착하면 그 연결을 대기열에 넣는다.
+// 처리 스레드는 대기열에서 꺼낸 연결의 요청 하나만 처리하고 연결을 돌려주므로, 아무것도 보내지 않는 연결이
+// 처리 스레드를 붙잡지 않는다. 렌더 자체는 전역 스레드 풀에서 병렬로 돈다.
+// 열린 연결이 처리 스레드 수 + 대기열 크기를 넘으면 새 연결에는 바로 "ERR busy" 를 보내고 닫는다.
+class RenderServer
+{
+public:
+    RenderServer(std::string socketPath, int queueSize, int workerCount)
+        : socketPath(std::move(socketPath))
+        , queueSize(std::max(queueSize, 1))
+        , workerCount(std::max(workerCount, 1))
+    {
+    }
+
+    ~RenderServer()
+    {
+        if (listenFd >= 0) {
+            close(listenFd);
+            unlink(socketPath.c_str());
+        }
+        for (int fd : wakeFds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    RenderServer(const RenderServer&) = delete;
+    RenderServer& operator=(const RenderServer&) = delete;
+
+    // SHUTDOWN 요청이나 SIGINT/SIGTERM 을 받을 때까지 돈다. 소켓을 열지 못하면 false.
+    bool Run()
+    {
+        if (!Listen()) {
+            return false;
+        }
+
+        std::signal(SIGINT, render_server_signal_handler);
+        std::signal(SIGTERM, render_server_signal_handler);
+        std::signal(SIGPIPE, SIG_IGN);
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < workerCount; ++i) {
+            workers.emplace_back([this]() { WorkerMain(); });
+        }
+
+        std::cout << "Listening on " << socketPath << std::endl;
+        std::vector<std::unique_ptr<ServerConnection>> idle;
+        std::vector<pollfd> polls;
+        while (!IsStopping()) {
+            polls.assign({{listenFd, POLLIN, 0}, {wakeFds[0], POLLIN, 0}});
+            for (const std::unique_ptr<ServerConnection>& connection : idle) {
+                polls.push_back({connection->GetFd(), POLLIN, 0});
+            }
+            // 종료 요청을 놓치지 않도록 주기적으로 깨어난다.
+            if (poll(polls.data(), static_cast<nfds_t>(polls.size()), 100) <= 0) {
+                continue;
+            }
+
+            if (polls[1].revents != 0) {
+                char drain[64];
+                while (read(wakeFds[0], drain, sizeof(drain)) > 0) {
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                for (std::unique_ptr<ServerConnection>& connection : returned) {
+                    idle.push_back(std::move(connection));
+                }
+                returned.clear();
+            }
+
+            // 쉬던 연결에서 요청 줄이 다 들어왔으면 대기열로 옮긴다. poll 결과는 앞쪽 idle 에만 해당한다.
+            const auto now = std::chrono::steady_clock::now();
+            const size_t polledCount = polls.size() - 2;
+            size_t kept = 0;
+            for (size_t i = 0; i < idle.size(); ++i) {
+                std::unique_ptr<ServerConnection>& connection = idle[i];
+                if (i < polledCount && polls[i + 2].revents != 0) {
+                    if (!connection->Receive() || (connection->IsPeerClosed() && !connection->HasLine())) {
+                        CloseConnection(std::move(connection));
+                        continue;
+                    }
+                    if (connection->HasLine()) {
+                        Enqueue(std::move(connection), now);
+                        continue;
+                    }
+                }
+                idle[kept++] = std::move(idle[i]);
+            }
+            idle.resize(kept);
+
+            if (polls[0].revents != 0) {
+                Accept(idle);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        std::cout << "Served " << latency.Summary() << std::endl;
+        return true;
+    }
+
+private:
+    // 요청이 다 도착한 연결과 도착 시각. 지연 시간은 도착 시각부터 재므로 대기열에서 기다린 시간도 들어간다.
+    struct ReadyConnection
+    {
+        std::unique_ptr<ServerConnection> connection;
+        std::chrono::steady_clock::time_point readyTime;
+    };
+
+    bool Listen()
+    {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        // 처리 스레드가 연결을 돌려줄 때 poll 을 바로 깨우는 파이프.
+        if (pipe(wakeFds) != 0) {
+            wakeFds[0] = wakeFds[1] = -1;
+            return false;
+        }
+        for (int fd : wakeFds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        }
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0) {
+            return false;
+        }
+        // 이전 실행이 남긴 소켓 파일을 지운다.
+        unlink(socketPath.c_str());
+        if (bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, queueSize) != 0) {
+            close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    void Accept(std::vector<std::unique_ptr<ServerConnection>>& idle)
+    {
+        const int clientFd = accept(listenFd, nullptr, nullptr);
+        if (clientFd < 0) {
+            return;
+        }
+        auto connection = std::make_unique<ServerConnection>(clientFd);
+        if (openConnections.load() >= workerCount + queueSize) {
+            latency.AddRejected();
+            connection->Send("ERR busy\n", 9, [this]() { return true; });
+            return;
+        }
+        openConnections.fetch_add(1);
+        idle.push_back(std::move(connection));
+    }
+
+    bool IsStopping() const
+    {
+        return RenderServerStopRequested().load() || shutdownRequested.load();
+    }
+
+    void Wake()
+    {
+        const char byte = 0;
+        (void)!write(wakeFds[1], &byte, 1);
+    }
+
+    void Enqueue(std::unique_ptr<ServerConnection> connection, std::chrono::steady_clock::time_point readyTime)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back({std::move(connection), readyTime});
+        }
+        condition.notify_one();
+    }
+
+    void CloseConnection(std::unique_ptr<ServerConnection> connection)
+    {
+        connection.reset();
+        openConnections.fetch_sub(1);
+    }
+
+    void WorkerMain()
+    {
+        // 출력 버퍼는 처리 스레드마다 하나씩 두고 요청 사이에 재사용한다.
+        std::vector<unsigned char> response;
+        for (;;) {
+            ReadyConnection item;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]() { return stopping || !ready.empty(); });
+                if (ready.empty()) {
+                    return;
+                }
+                item = std::move(ready.front());
+                ready.pop_front();
+            }
+
+            const bool keep = ServeRequest(*item.connection, item.readyTime, response) && !IsStopping();
+            if (!keep || (item.connection->IsPeerClosed() && !item.connection->HasLine())) {
+                CloseConnection(std::move(item.connection));
+            } else if (item.connection->HasLine()) {
+                // 이어서 보낸 요청은 대기열 뒤로 보내 다른 연결과 번갈아 처리한다.
+                Enqueue(std::move(item.connection), std::chrono::steady_clock::now());
+            } else {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    returned.push_back(std::move(item.connection));
+                }
+                Wake();
+            }
+        }
+    }
+
+    // 받아 둔 요청 한 줄을 처리한다. 응답을 보내지 못했으면 false.
+    bool ServeRequest(ServerConnection& connection, std::chrono::steady_clock::time_point readyTime, std::vector<unsigned char>& response)
+    {
+        auto isStopping = [this]() { return IsStopping(); };
+        auto sendText = [&](const std::string& text) { return connection.Send(text.data(), text.size(), isStopping); };
+
+        std::istringstream in(connection.TakeLine());
+        std::string command;
+        in >> command;
+        if (command == "RENDER") {
+            RenderRequest request;
+            std::string error;
+            if (!parse_render_request(in, request, error)) {
+                latency.AddError();
+                return sendText("ERR " + error + "\n");
+            }
+            RenderToPPM(request, response);
+            const bool sent = sendText("OK " + std::to_string(response.size()) + "\n") && connection.Send(response.data(), response.size(), isStopping);
+            latency.Add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - readyTime).count());
+            return sent;
+        }
+        if (command == "STATS") {
+            return sendText("OK " + latency.Summary() + "\n");
+        }
+        if (command == "SHUTDOWN") {
+            shutdownRequested.store(true);
+            sendText("OK\n");
+            Wake();
+            return false;
+        }
+        if (!command.empty()) {
+            latency.AddError();
+            return sendText("ERR unknown command: " + command + "\n");
+        }
+        return true;
+    }
+
+    // PPM(P6) 헤더와 픽셀을 out 에 이어 쓴다. out 의 용량은 다음 요청에서 재사용된다.
+    static void RenderToPPM(const RenderRequest& request, std::vector<unsigned char>& out)
+    {
+        const PixelEncoder encoder(request.bitDepth == 16 ? EPixelFormat::RGB16 : EPixelFormat::RGB8, request.encoding, request.gamma);
+        const vec2i& size = request.outputSize;
+
+        char header[64];
+        const int headerSize = std::snprintf(header, sizeof(header), "P6\n%d %d\n%d\n", size.x, size.y, encoder.GetMaxValue());
+        out.resize(headerSize + static_cast<size_t>(size.x) * size.y * encoder.GetBytesPerPixel());
+        std::memcpy(out.data(), header, headerSize);
+        const RenderTarget target = make_encoded_target(out.data() + headerSize, size.x, encoder);
+
+        auto render = [&](const auto& pattern) {
+            if (request.aaType == EAAType::FXAA) {
+                render_pattern_fxaa_to_target(size, pattern, target);
+            } else {
+                render_pattern_region(size, request.aaType, request.aaLevel, pattern, RenderTile{{0, 0}, size}, target);
+            }
+        };
+
+        switch (request.patternType) {
+            case EPatternType::UV:
+                render(UVPattern(size));
+                break;
+            case EPatternType::CHECKERBOARD:
+                render(CheckerboardPattern(size, request.aaType, request.aaLevel, request.checkerboardAngle, {0.5f, 0.5f}, request.checkerboardTileSize));
+                break;
+            case EPatternType::CIRCLE:
+                render(CirclePattern(size, request.aaType, request.aaLevel, request.circleThickness, request.circleGap));
+                break;
+            case EPatternType::VORONOI: {
+                const VoronoiPattern pattern(size, request.aaType, request.aaLevel, request.voronoiSiteCount, request.voronoiLookup);
+                render(pattern);
+                break;
+            }
+        }
+    }
+
+    std::string socketPath;
+    int queueSize;
+    int workerCount;
+    int listenFd = -1;
+
+    int wakeFds[2] = {-1, -1};
+    std::atomic<int> openConnections = 0;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<ReadyConnection> ready;
+    std::vector<std::unique_ptr<ServerConnection>> returned;
+    bool stopping = false;
+    std::atomic<bool> shutdownRequested = false;
+
+    LatencyRecorder latency;
+};
+
+#endif
+
+// socketPath 에서 렌더 요청을 받는다. 서버를 열지 못했거나 지원하지 않는 플랫폼이면 false.
+static bool run_render_server(const std::string& socketPath, int queueSize, int workerCount)
+{
+#if RENDER_SERVER_SUPPORTED
+    RenderServer server(socketPath, queueSize, workerCount);
+    return server.Run();
+#else
+    (void)socketPath;
+    (void)queueSize;
+    (void)workerCount;
+    std::cerr << "--serve needs Unix domain sockets, which this platform build does not support" << std::endl;
+    return false;
+#endif
+}
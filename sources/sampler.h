@@ -0,0 +1,859 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "math.h"
+#include "profiler.h"
+#include "quantize.h"
+#include "thread_pool.h"
+
+enum class EAAType {
+    NONE,
+    SSAA,
+    MSAA,
+    FXAA,
+    ANALYTIC,   // 픽셀 박스 필터 적분을 닫힌 식으로 계산(체커보드/원)
+    ADAPTIVE    // 픽셀 모서리 샘플이 다른 픽셀만 AALevel x AALevel 로 세분
+};
+
+// SSAA 는 AALevel x AALevel 격자, MSAA 는 AALevel 개의 샘플.
+constexpr int MAX_AA_LEVEL = 16;
+
+constexpr vec2f MSAA_SAMPLES[8] = {
+    {-0.3125f, -0.4375f}, { 0.1875f, -0.3125f},
+    { 0.4375f, -0.0625f}, { 0.0625f,  0.1875f},
+    {-0.4375f,  0.0625f}, {-0.0625f,  0.3125f},
+    {-0.1875f,  0.4375f}, { 0.3125f,  0.0625f}
+};
+
+// MSAA 샘플 오프셋 테이블.
+// 8개 이하는 MSAA_SAMPLES 의 앞부분을 그대로 쓰고, 그보다 많으면 N-rooks 패턴을 만든다.
+// (x 는 1/N 칸마다 하나, y 는 N 과 서로소인 보폭으로 섞어서 행/열마다 샘플이 하나씩 오도록)
+template<int N>
+constexpr std::array<vec2f, N> make_msaa_samples()
+{
+    std::array<vec2f, N> samples{};
+    if constexpr (N <= 8) {
+        for (int i = 0; i < N; ++i) {
+            samples[i] = MSAA_SAMPLES[i];
+        }
+    } else {
+        int stride = (N * 5) / 8;
+        while (std::gcd(stride, N) != 1) {
+            ++stride;
+        }
+        for (int i = 0; i < N; ++i) {
+            const int row = (i * stride) % N;
+            samples[i] = {(static_cast<float>(i) + 0.5f) / N - 0.5f, (static_cast<float>(row) + 0.5f) / N - 0.5f};
+        }
+    }
+    return samples;
+}
+
+template<int N>
+constexpr std::array<vec2f, N> MSAA_SAMPLE_TABLE = make_msaa_samples<N>();
+
+// 패턴 펑터가 한 번에 받는 샘플 묶음.
+// u/v 는 샘플 uv 좌표(SoA), colors 에 샘플별 색을 쓴다.
+// values/indices 는 패턴이 중간 결과용으로 자유롭게 쓸 수 있는 count 크기의 임시 버퍼.
+struct SampleBatch
+{
+    const float* u;
+    const float* v;
+    int count;
+    vec3f* colors;
+    float* values;
+    int* indices;
+};
+
+// 샘플 묶음 하나를 만드는 데 쓰는 버퍼. 스레드 풀 워커마다 한 벌을 두고 타일과 렌더가 바뀌어도 다시 쓰므로
+// 렌더를 거듭해도 타일마다 새로 할당하지 않는다. 크기는 지금까지 가장 큰 묶음만큼만 늘어난다.
+struct SampleScratch
+{
+    std::vector<float> u;
+    std::vector<float> v;
+    std::vector<vec3f> colors;
+    std::vector<float> values;
+    std::vector<int> indices;
+    std::vector<vec3f> pixels;      // 픽셀별 누적 색
+    std::vector<int> columns;       // 대칭 렌더에서 한 행에 평가할 열
+    std::vector<vec3f> cornerRows[2];   // 적응형 렌더의 위/아래 모서리 샘플 행
+    std::vector<int> refinePixels;      // 적응형 렌더에서 세분할 픽셀
+
+    void Reserve(size_t sampleCount, size_t pixelCount)
+    {
+        if (u.size() < sampleCount) {
+            u.resize(sampleCount);
+            v.resize(sampleCount);
+            colors.resize(sampleCount);
+            values.resize(sampleCount);
+            indices.resize(sampleCount);
+        }
+        if (pixels.size() < pixelCount) {
+            pixels.resize(pixelCount);
+        }
+    }
+
+    SampleBatch MakeBatch(int count)
+    {
+        SampleBatch batch;
+        batch.u = u.data();
+        batch.v = v.data();
+        batch.count = count;
+        batch.colors = colors.data();
+        batch.values = values.data();
+        batch.indices = indices.data();
+        return batch;
+    }
+};
+
+static SampleScratch& get_sample_scratch()
+{
+    thread_local SampleScratch scratch;
+    return scratch;
+}
+
+// 렌더 한 번(또는 여러 영역을 합친) 동안 패턴을 평가한 횟수.
+struct RenderSampleStats
+{
+    int64_t pixelCount = 0;
+    int64_t sampleCount = 0;
+    int64_t refinedPixelCount = 0;  // ADAPTIVE 에서 세분한 픽셀 수
+
+    RenderSampleStats& operator+=(const RenderSampleStats& other)
+    {
+        pixelCount += other.pixelCount;
+        sampleCount += other.sampleCount;
+        refinedPixelCount += other.refinedPixelCount;
+        return *this;
+    }
+};
+
+// SSAA 격자에서 superSample 번째 서브 샘플의 uv 좌표(한 축).
+static float ssaa_sample_coord(int superSample, float invAALevel, int size)
+{
+    return (static_cast<float>(superSample) + 0.5f) * invAALevel / size;
+}
+
+// 렌더 드라이버가 쓰는 AA 설정을 컴파일 타임 상수로 묶는다.
+template<EAAType AA, int Level>
+struct SamplerTraits
+{
+    static constexpr bool IsSSAA = (AA == EAAType::SSAA);
+    static constexpr bool IsMSAA = (AA == EAAType::MSAA);
+    static constexpr int RowPasses = IsSSAA ? Level : 1;                        // 픽셀 행 하나당 샘플 행 수
+    static constexpr int SamplesPerPass = (IsSSAA || IsMSAA) ? Level : 1;     // 샘플 행에서 픽셀당 샘플 수
+    static constexpr int SampleCount = RowPasses * SamplesPerPass;
+};
+
+// 한 픽셀 행에서 샘플 uv 를 SoA 로 채운다. SSAA 는 서브 행(subY) 하나, MSAA/NONE 은 행 전체.
+// 픽셀 순서대로, 각 픽셀 안에서는 샘플 순서대로 채우며 채운 샘플 수를 반환한다.
+template<EAAType AA, int Level>
+static int fill_sample_row(const vec2i& outputSize, int y, int subY, int minX, int maxX, float* u, float* v)
+{
+    using Traits = SamplerTraits<AA, Level>;
+    const vec2f UVOffset = {0.5f, 0.5f};
+    int count = 0;
+
+    if constexpr (Traits::IsSSAA) {
+        const float InvAALevel = 1.0f / static_cast<float>(Level);
+        const float rowV = ssaa_sample_coord(y * Level + subY, InvAALevel, outputSize.y);
+        for (int x = minX; x < maxX; x++) {
+            for (int subX = 0; subX < Level; subX++) {
+                u[count] = ssaa_sample_coord(x * Level + subX, InvAALevel, outputSize.x);
+                v[count] = rowV;
+                count++;
+            }
+        }
+    } else if constexpr (Traits::IsMSAA) {
+        constexpr std::array<vec2f, Level> offsets = MSAA_SAMPLE_TABLE<Level>;
+        for (int x = minX; x < maxX; x++) {
+            for (int i = 0; i < Level; i++) {
+                u[count] = (static_cast<float>(x) + UVOffset.x + offsets[i].x) / outputSize.x;
+                v[count] = (static_cast<float>(y) + UVOffset.y + offsets[i].y) / outputSize.y;
+                count++;
+            }
+        }
+    } else { // NONE
+        const vec2f offset = vec2f();
+        const float rowV = (static_cast<float>(y) + UVOffset.y + offset.y) / outputSize.y;
+        for (int x = minX; x < maxX; x++) {
+            u[count] = (static_cast<float>(x) + UVOffset.x + offset.x) / outputSize.x;
+            v[count] = rowV;
+            count++;
+        }
+    }
+    return count;
+}
+
+// 타일을 샘플 행 단위로 pattern.EvaluateBatch 에 넘기고, 픽셀마다 샘플 순서대로 누적해 평균을 낸다.
+// AA 종류와 샘플 수가 템플릿 인자라서 픽셀 루프 안에 분기가 없고 누적 루프는 펼쳐진다.
+// target 은 region 의 왼쪽 위를 가리키고, 타일 좌표는 전체 이미지(outputSize) 기준이다.
+// 누적한 평균은 target 형식(float/8비트/16비트)으로 바로 쓴다.
+template<EAAType AA, int Level, typename Pattern>
+static void render_pattern_tile(const RenderTile& tile, const vec2i& outputSize, const RenderTile& region, const Pattern& pattern, const RenderTarget& target)
+{
+    using Traits = SamplerTraits<AA, Level>;
+    const int width = tile.max.x - tile.min.x;
+    const int rowSamples = width * Traits::SamplesPerPass;
+
+    SampleScratch& scratch = get_sample_scratch();
+    scratch.Reserve(rowSamples, width);
+    vec3f* accumulatedColors = scratch.pixels.data();
+
+    for (int y = tile.min.y; y < tile.max.y; y++) {
+        std::fill(accumulatedColors, accumulatedColors + width, vec3f::Zero);
+        for (int subY = 0; subY < Traits::RowPasses; subY++) {
+            const SampleBatch batch = scratch.MakeBatch(fill_sample_row<AA, Level>(outputSize, y, subY, tile.min.x, tile.max.x, scratch.u.data(), scratch.v.data()));
+            pattern.EvaluateBatch(batch);
+
+            for (int i = 0; i < width; i++) {
+                const vec3f* pixelSamples = batch.colors + i * Traits::SamplesPerPass;
+                for (int s = 0; s < Traits::SamplesPerPass; s++) {
+                    accumulatedColors[i] += pixelSamples[s];
+                }
+            }
+        }
+        for (int i = 0; i < width; i++) {
+            accumulatedColors[i] = accumulatedColors[i] / static_cast<float>(Traits::SampleCount);
+        }
+        target.StoreRow(tile.min.x - region.min.x, y - region.min.y, accumulatedColors, width);
+    }
+}
+
+template<EAAType AA, int Level, typename Pattern>
+static RenderSampleStats render_pattern_tiles(const vec2i& outputSize, const RenderTile& region, const Pattern& pattern, const RenderTarget& target)
+{
+    parallel_for_tiles(region, [&](const RenderTile& tile) {
+        render_pattern_tile<AA, Level>(tile, outputSize, region, pattern, target);
+    });
+
+    RenderSampleStats stats;
+    stats.pixelCount = static_cast<int64_t>(region.max.x - region.min.x) * (region.max.y - region.min.y);
+    stats.sampleCount = stats.pixelCount * SamplerTraits<AA, Level>::SampleCount;
+    return stats;
+}
+
+// 모서리 샘플끼리 채널 차이가 이보다 크면 픽셀 안에 경계가 있다고 본다(8비트 한 단계의 절반).
+constexpr float ADAPTIVE_EDGE_THRESHOLD = 1.0f / 512.0f;
+
+static bool adaptive_colors_differ(const vec3f& a, const vec3f& b)
+{
+    return std::abs(a.x - b.x) > ADAPTIVE_EDGE_THRESHOLD || std::abs(a.y - b.y) > ADAPTIVE_EDGE_THRESHOLD || std::abs(a.z - b.z) > ADAPTIVE_EDGE_THRESHOLD;
+}
+
+// 적응형 슈퍼샘플링. 먼저 픽셀 모서리 격자(이웃 픽셀과 공유하므로 픽셀당 약 1개)를 평가하고,
+// 네 모서리가 같으면 그 평균을 쓰고, 다르면 그 픽셀만 SSAA 와 같은 Level x Level 서브 샘플로 다시 평가한다.
+// 세분한 픽셀은 SSAA 와 같은 위치, 같은 순서로 누적한다. 모서리 사이에 완전히 들어가는 픽셀보다 작은 무늬는 놓칠 수 있다.
+template<int Level, typename Pattern>
+static void render_pattern_adaptive_tile(const RenderTile& tile, const vec2i& outputSize, const RenderTile& region, const Pattern& pattern, const RenderTarget& target, RenderSampleStats& stats)
+{
+    constexpr int SubSamples = Level * Level;
+    const float InvAALevel = 1.0f / static_cast<float>(Level);
+    const int width = tile.max.x - tile.min.x;
+    const int cornerCount = width + 1;
+    const int maxSamples = std::max(cornerCount, width * SubSamples);
+
+    SampleScratch& scratch = get_sample_scratch();
+    scratch.Reserve(maxSamples, width);
+    std::vector<float>& u = scratch.u;
+    std::vector<float>& v = scratch.v;
+    std::vector<vec3f>& colors = scratch.colors;
+    std::vector<vec3f>& pixelColors = scratch.pixels;
+    std::vector<vec3f>* cornerRows = scratch.cornerRows;
+    for (int r = 0; r < 2; r++) {
+        if (cornerRows[r].size() < static_cast<size_t>(cornerCount)) {
+            cornerRows[r].resize(cornerCount);
+        }
+    }
+    std::vector<int>& refinePixels = scratch.refinePixels;
+    refinePixels.reserve(width);
+
+    auto evaluate = [&](int count) {
+        pattern.EvaluateBatch(scratch.MakeBatch(count));
+        stats.sampleCount += count;
+    };
+
+    // 모서리 y 의 (width + 1) 개 샘플.
+    auto evaluateCornerRow = [&](int y, std::vector<vec3f>& out) {
+        const float rowV = static_cast<float>(y) / outputSize.y;
+        for (int i = 0; i < cornerCount; i++) {
+            u[i] = static_cast<float>(tile.min.x + i) / outputSize.x;
+            v[i] = rowV;
+        }
+        evaluate(cornerCount);
+        std::copy(colors.begin(), colors.begin() + cornerCount, out.begin());
+    };
+
+    evaluateCornerRow(tile.min.y, cornerRows[0]);
+    for (int y = tile.min.y; y < tile.max.y; y++) {
+        const std::vector<vec3f>& top = cornerRows[(y - tile.min.y) & 1];
+        std::vector<vec3f>& bottom = cornerRows[(y - tile.min.y + 1) & 1];
+        evaluateCornerRow(y + 1, bottom);
+
+        refinePixels.clear();
+        for (int i = 0; i < width; i++) {
+            const vec3f& c00 = top[i];
+            const vec3f& c10 = top[i + 1];
+            const vec3f& c01 = bottom[i];
+            const vec3f& c11 = bottom[i + 1];
+            if (adaptive_colors_differ(c00, c10) || adaptive_colors_differ(c00, c01) || adaptive_colors_differ(c00, c11)) {
+                refinePixels.push_back(i);
+            } else {
+                pixelColors[i] = (c00 + c10 + c01 + c11) * 0.25f;
+            }
+        }
+
+        if (!refinePixels.empty()) {
+            int count = 0;
+            for (const int i : refinePixels) {
+                const int x = tile.min.x + i;
+                for (int subY = 0; subY < Level; subY++) {
+                    const float sampleV = ssaa_sample_coord(y * Level + subY, InvAALevel, outputSize.y);
+                    for (int subX = 0; subX < Level; subX++) {
+                        u[count] = ssaa_sample_coord(x * Level + subX, InvAALevel, outputSize.x);
+                        v[count] = sampleV;
+                        count++;
+                    }
+                }
+            }
+            evaluate(count);
+
+            for (size_t k = 0; k < refinePixels.size(); k++) {
+                const vec3f* pixelSamples = colors.data() + k * SubSamples;
+                vec3f accumulated = vec3f::Zero;
+                for (int s = 0; s < SubSamples; s++) {
+                    accumulated += pixelSamples[s];
+                }
+                pixelColors[refinePixels[k]] = accumulated / static_cast<float>(SubSamples);
+            }
+            stats.refinedPixelCount += static_cast<int64_t>(refinePixels.size());
+        }
+
+        target.StoreRow(tile.min.x - region.min.x, y - region.min.y, pixelColors.data(), width);
+    }
+}
+
+template<EAAType AA, int Level, typename Pattern>
+static RenderSampleStats render_pattern_adaptive_tiles(const vec2i& outputSize, const RenderTile& region, const Pattern& pattern, const RenderTarget& target)
+{
+    std::atomic<int64_t> sampleCount{0};
+    std::atomic<int64_t> refinedPixelCount{0};
+    parallel_for_tiles(region, [&](const RenderTile& tile) {
+        RenderSampleStats tileStats;
+        render_pattern_adaptive_tile<Level>(tile, outputSize, region, pattern, target, tileStats);
+        sampleCount.fetch_add(tileStats.sampleCount, std::memory_order_relaxed);
+        refinedPixelCount.fetch_add(tileStats.refinedPixelCount, std::memory_order_relaxed);
+    });
+
+    RenderSampleStats stats;
+    stats.pixelCount = static_cast<int64_t>(region.max.x - region.min.x) * (region.max.y - region.min.y);
+    stats.sampleCount = sampleCount.load();
+    stats.refinedPixelCount = refinedPixelCount.load();
+    return stats;
+}
+
+// 패턴이 알려 주는 축 분리 성질(GetSymmetry). 해당하는 패턴은 GetAxisKey(axis, coord) 로 한 축 샘플 좌표의 키를 준다.
+// SEPARABLE: 샘플 값이 0 또는 1 이고, u 의 키와 v 의 키만으로 정해진다.
+// SYMMETRIC: 여기에 더해 u 키와 v 키를 맞바꿔도 값이 같다.
+enum class EPatternSymmetry {
+    NONE,
+    SEPARABLE,
+    SYMMETRIC
+};
+
+template<typename Pattern>
+concept AxisSeparablePattern = requires(const Pattern& pattern, int axis, float coord) {
+    { pattern.GetSymmetry() } -> std::same_as<EPatternSymmetry>;
+    { pattern.GetAxisKey(axis, coord) } -> std::same_as<float>;
+};
+
+inline bool& GetPatternSymmetryEnabledInstance()
+{
+    static bool enabled = true;
+    return enabled;
+}
+
+// 끄면 대칭/주기 패턴도 모든 픽셀을 평가한다(결과는 같다).
+inline void SetPatternSymmetryEnabled(bool enabled)
+{
+    GetPatternSymmetryEnabledInstance() = enabled;
+}
+
+template<size_t... LevelIndex>
+static std::vector<vec2f> get_msaa_sample_offsets(int level, std::index_sequence<LevelIndex...>)
+{
+    std::vector<vec2f> offsets;
+    ((level == static_cast<int>(LevelIndex) + 1 ? offsets.assign(MSAA_SAMPLE_TABLE<LevelIndex + 1>.begin(), MSAA_SAMPLE_TABLE<LevelIndex + 1>.end()) : void()), ...);
+    return offsets;
+}
+
+// 픽셀 열(axis 0) 또는 행(axis 1) index 의 샘플 좌표 키 목록을 signature 에 쓴다(get_axis_signature_length 개).
+// 좌표는 fill_sample_row 와 같은 식으로 만든다.
+// SSAA/NONE 은 픽셀 샘플이 열 키 x 행 키 격자이고 값이 0/1 이라 더하는 순서와 상관없으므로 정렬해서 비교하고,
+// MSAA 는 샘플마다 열 키와 행 키가 짝지어지므로 샘플 순서 그대로 비교한다.
+// MSAA 샘플 표는 좌우/상하 대칭이 아니라서 거울 위치의 픽셀은 실제로 다른 점을 샘플한다. 그래서 원은 MSAA 에서
+// 거울로 접히지 않고(열 키 목록이 같은 열이 없다), 분류만 하고 모든 픽셀을 평가하는 경로로 돌아간다.
+static int get_axis_signature_length(EAAType AAType, int level)
+{
+    return (AAType == EAAType::SSAA || AAType == EAAType::MSAA) ? level : 1;
+}
+
+template<typename Pattern>
+static void make_axis_signature(const Pattern& pattern, EAAType AAType, int level, const std::vector<vec2f>& msaaOffsets, int axis, int index, int size, float* signature)
+{
+    if (AAType == EAAType::SSAA) {
+        const float InvAALevel = 1.0f / static_cast<float>(level);
+        for (int sub = 0; sub < level; sub++) {
+            signature[sub] = pattern.GetAxisKey(axis, ssaa_sample_coord(index * level + sub, InvAALevel, size));
+        }
+        std::sort(signature, signature + level);
+    } else if (AAType == EAAType::MSAA) {
+        for (int i = 0; i < level; i++) {
+            signature[i] = pattern.GetAxisKey(axis, (static_cast<float>(index) + 0.5f + (axis == 0 ? msaaOffsets[i].x : msaaOffsets[i].y)) / size);
+        }
+    } else {
+        signature[0] = pattern.GetAxisKey(axis, (static_cast<float>(index) + 0.5f + 0.0f) / size);
+    }
+}
+
+// region 의 열과 행에 키 목록별 id 를 붙인 결과. columnClass/rowClass 는 region 기준 index 로 찾는다.
+// SYMMETRIC 이면 열과 행이 같은 id 공간을 쓰고, 아니면 행 id 는 열 id 다음부터 붙는다.
+struct PatternAxisClasses
+{
+    EPatternSymmetry symmetry = EPatternSymmetry::NONE;
+    RenderTile region;
+    std::vector<int> columnClass;
+    std::vector<int> rowClass;
+    int classCount = 0;
+};
+
+// 열과 행의 키 목록을 한 배열에 이어 쓰고, 목록 순서로 정렬한 index 에서 같은 목록끼리 같은 id 를 붙인다.
+template<typename Pattern>
+static void classify_pattern_axes(const vec2i& outputSize, const EAAType AAType, const int level, const Pattern& pattern, const RenderTile& region, PatternAxisClasses& classes)
+{
+    const vec2i size = region.max - region.min;
+    const int length = get_axis_signature_length(AAType, level);
+    const int total = size.x + size.y;
+    const std::vector<vec2f> msaaOffsets = (AAType == EAAType::MSAA) ? get_msaa_sample_offsets(level, std::make_index_sequence<MAX_AA_LEVEL>()) : std::vector<vec2f>();
+
+    std::vector<float> signatures(static_cast<size_t>(total) * length);
+    for (int x = 0; x < size.x; x++) {
+        make_axis_signature(pattern, AAType, level, msaaOffsets, 0, region.min.x + x, outputSize.x, signatures.data() + static_cast<size_t>(x) * length);
+    }
+    for (int y = 0; y < size.y; y++) {
+        make_axis_signature(pattern, AAType, level, msaaOffsets, 1, region.min.y + y, outputSize.y, signatures.data() + static_cast<size_t>(size.x + y) * length);
+    }
+
+    std::vector<int> ids(total);
+    std::vector<int> order(total);
+    std::iota(order.begin(), order.end(), 0);
+    auto signatureOf = [&](int index) { return signatures.data() + static_cast<size_t>(index) * length; };
+    int classCount = 0;
+    auto assignIds = [&](int begin, int end) {
+        std::sort(order.begin() + begin, order.begin() + end, [&](int a, int b) {
+            return std::lexicographical_compare(signatureOf(a), signatureOf(a) + length, signatureOf(b), signatureOf(b) + length);
+        });
+        for (int i = begin; i < end; i++) {
+            if (i > begin && !std::equal(signatureOf(order[i - 1]), signatureOf(order[i - 1]) + length, signatureOf(order[i]))) {
+                classCount++;
+            }
+            ids[order[i]] = classCount;
+        }
+        classCount += (end > begin) ? 1 : 0;
+    };
+    classes.symmetry = pattern.GetSymmetry();
+    if (classes.symmetry == EPatternSymmetry::SYMMETRIC) {
+        assignIds(0, total);
+    } else {
+        assignIds(0, size.x);
+        assignIds(size.x, total);
+    }
+
+    classes.region = region;
+    classes.columnClass.assign(ids.begin(), ids.begin() + size.x);
+    classes.rowClass.assign(ids.begin() + size.x, ids.end());
+    classes.classCount = classCount;
+}
+
+template<EAAType AA, int Level, typename Pattern>
+static void render_pattern_row_pixels(const vec2i& outputSize, const RenderTile& region, const Pattern& pattern, const RenderTarget& target, int y, const std::vector<int>& columns)
+{
+    using Traits = SamplerTraits<AA, Level>;
+    const int width = static_cast<int>(columns.size());
+    const int rowSamples = width * Traits::SamplesPerPass;
+
+    SampleScratch& scratch = get_sample_scratch();
+    scratch.Reserve(rowSamples, width);
+    vec3f* accumulatedColors = scratch.pixels.data();
+    std::fill(accumulatedColors, accumulatedColors + width, vec3f::Zero);
+
+    for (int subY = 0; subY < Traits::RowPasses; subY++) {
+        int count = 0;
+        for (const int x : columns) {
+            count += fill_sample_row<AA, Level>(outputSize, y, subY, x, x + 1, scratch.u.data() + count, scratch.v.data() + count);
+        }
+        const SampleBatch batch = scratch.MakeBatch(count);
+        pattern.EvaluateBatch(batch);
+
+        for (int i = 0; i < width; i++) {
+            const vec3f* pixelSamples = batch.colors + i * Traits::SamplesPerPass;
+            for (int s = 0; s < Traits::SamplesPerPass; s++) {
+                accumulatedColors[i] += pixelSamples[s];
+            }
+        }
+    }
+    for (int i = 0; i < width; i++) {
+        accumulatedColors[i] = accumulatedColors[i] / static_cast<float>(Traits::SampleCount);
+    }
+
+    // 이어지는 열은 한 번에 쓴다.
+    for (int start = 0; start < width;) {
+        int end = start + 1;
+        while (end < width && columns[end] == columns[end - 1] + 1) {
+            end++;
+        }
+        target.StoreRow(columns[start] - region.min.x, y - region.min.y, accumulatedColors + start, end - start);
+        start = end;
+    }
+}
+
+template<typename Pattern>
+using RenderRowPixelsFunc = void (*)(const vec2i&, const RenderTile&, const Pattern&, const RenderTarget&, int, const std::vector<int>&);
+
+template<EAAType AA, typename Pattern, size_t... LevelIndex>
+constexpr std::array<RenderRowPixelsFunc<Pattern>, sizeof...(LevelIndex)> make_render_row_pixels_table(std::index_sequence<LevelIndex...>)
+{
+    return {&render_pattern_row_pixels<AA, static_cast<int>(LevelIndex) + 1, Pattern>...};
+}
+
+template<typename Pattern>
+using RenderPatternFunc = RenderSampleStats (*)(const vec2i&, const RenderTile&, const Pattern&, const RenderTarget&);
+
+template<EAAType AA, typename Pattern, size_t... LevelIndex>
+constexpr std::array<RenderPatternFunc<Pattern>, sizeof...(LevelIndex)> make_render_pattern_table(std::index_sequence<LevelIndex...>)
+{
+    if constexpr (AA == EAAType::ADAPTIVE) {
+        return {&render_pattern_adaptive_tiles<AA, static_cast<int>(LevelIndex) + 1, Pattern>...};
+    } else {
+        return {&render_pattern_tiles<AA, static_cast<int>(LevelIndex) + 1, Pattern>...};
+    }
+}
+
+// 밴드 단위 렌더가 뒤 밴드에 복사해 줄 행을 들고 있는 캐시의 기본 최대 크기.
+constexpr size_t DEFAULT_BAND_ROW_CACHE_BYTES = size_t(64) << 20;
+
+// roi 를 위에서 아래로 가로 밴드 단위로 렌더한다. 밴드는 roi 전체 폭이고 위에서부터 차례로 요청해야 한다.
+// AA 종류/레벨 조합마다 인스턴스화된 드라이버 중 하나를 렌더 시작 시 한 번만 고른다.
+// 밴드 안의 픽셀만 계산해서 target 에 쓰며, 값은 전체 렌더의 같은 위치와 같다.
+// FXAA 와 ANALYTIC 은 샘플링 단계에서는 NONE 과 같다(후처리는 apply_fxaa, 픽셀 적분은 패턴 펑터가 한다).
+//
+// 축 분리 패턴(AxisSeparablePattern)은 ADAPTIVE/ANALYTIC 이 아니면 샘플 키 목록이 같은 열(행)끼리 픽셀 값도 같다.
+// 열/행 분류는 생성할 때 roi 전체로 한 번만 구하고, 목록마다 처음 나오는 열과 행이 만나는 픽셀만 평가한다
+// (SYMMETRIC 이면 열/행 목록을 맞바꾼 쌍 중 하나만). 나머지는 같은 값을 가진 평가한 픽셀을 복사한다.
+// 목록을 직접 비교하므로 float 반올림으로 대칭이 깨진 열은 따로 평가되어 결과는 모든 픽셀을 평가한 것과 비트 단위로 같다.
+// 밴드에서 줄어드는 픽셀이 1/4 도 안 되면 그 밴드는 모든 픽셀을 평가한다.
+// cacheBytes 를 주면 뒤 밴드에서 다시 쓰는 행(같은 id 의 행, 맞바꾼 쌍의 원본 행)을 그 크기까지 복사해 두고,
+// 뒤 밴드는 다시 평가하지 않고 복사한다. 캐시에 넣지 못한 행은 다음에 나오는 밴드에서 다시 평가한다.
+template<typename Pattern>
+class PatternBandRenderer
+{
+public:
+    PatternBandRenderer(const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const RenderTile& roi, size_t cacheBytes = 0)
+        : outputSize(outputSize)
+        , AAType(AAType)
+        , level(clamp(AALevel, 1, MAX_AA_LEVEL))
+        , pattern(pattern)
+        , roi(roi)
+        , cacheBytes(cacheBytes)
+    {
+    }
+
+    ~PatternBandRenderer()
+    {
+        profile_release_buffer(static_cast<int64_t>(cachedBytes));
+    }
+
+    PatternBandRenderer(const PatternBandRenderer&) = delete;
+    PatternBandRenderer& operator=(const PatternBandRenderer&) = delete;
+
+    // 행 [bandMinY, bandMaxY) 를 target 에 쓴다(target 은 (roi.min.x, bandMinY) 픽셀을 가리킨다).
+    // stats 가 있으면 이번 밴드의 샘플 수를 더한다.
+    void RenderBand(int bandMinY, int bandMaxY, const RenderTarget& target, RenderSampleStats* stats = nullptr)
+    {
+        static constexpr auto SSAATable = make_render_pattern_table<EAAType::SSAA, Pattern>(std::make_index_sequence<MAX_AA_LEVEL>());
+        static constexpr auto MSAATable = make_render_pattern_table<EAAType::MSAA, Pattern>(std::make_index_sequence<MAX_AA_LEVEL>());
+        static constexpr auto AdaptiveTable = make_render_pattern_table<EAAType::ADAPTIVE, Pattern>(std::make_index_sequence<MAX_AA_LEVEL>());
+
+        ProfileStage profileStage("render");
+        if (!classified) {
+            ClassifyAxes();
+        }
+        const RenderTile band = {{roi.min.x, bandMinY}, {roi.max.x, bandMaxY}};
+        RenderSampleStats bandStats;
+        if (!RenderBandSymmetric(band, target, bandStats)) {
+            switch (AAType) {
+                case EAAType::SSAA: bandStats = SSAATable[level - 1](outputSize, band, pattern, target); break;
+                case EAAType::MSAA: bandStats = MSAATable[level - 1](outputSize, band, pattern, target); break;
+                case EAAType::ADAPTIVE: bandStats = AdaptiveTable[level - 1](outputSize, band, pattern, target); break;
+                default: bandStats = render_pattern_tiles<EAAType::NONE, 1>(outputSize, band, pattern, target); break;
+            }
+        }
+        CacheBandRows(band, target);
+        profile_add_counter(EProfileCounter::SAMPLES, bandStats.sampleCount);
+        if (stats) {
+            *stats += bandStats;
+        }
+    }
+
+private:
+    // 첫 밴드에서 roi 전체의 열/행 분류와, id 마다 처음 나오는 열, 캐시를 쓰면 그 id 의 행이 마지막으로 필요한 행(roi 기준)을 구한다.
+    void ClassifyAxes()
+    {
+        classified = true;
+        if constexpr (AxisSeparablePattern<Pattern>) {
+            const vec2i size = roi.max - roi.min;
+            if (!GetPatternSymmetryEnabledInstance() || AAType == EAAType::ADAPTIVE || AAType == EAAType::ANALYTIC
+                || pattern.GetSymmetry() == EPatternSymmetry::NONE || size.x <= 0 || size.y <= 0) {
+                return;
+            }
+            classify_pattern_axes(outputSize, AAType, level, pattern, roi, classes);
+        } else {
+            return;
+        }
+
+        const int width = roi.max.x - roi.min.x;
+        const int height = roi.max.y - roi.min.y;
+        firstColumn.assign(classes.classCount, -1);
+        for (int x = 0; x < width; x++) {
+            if (firstColumn[classes.columnClass[x]] < 0) {
+                firstColumn[classes.columnClass[x]] = x;
+                uniqueColumns.push_back(x);
+            }
+        }
+        if (cacheBytes == 0) {
+            return;
+        }
+
+        // 같은 id 의 행은 마지막으로 나오는 행까지, 맞바꾼 쌍의 원본 행은 더 큰 id 의 행이 마지막으로 나오는 행까지 필요하다.
+        std::vector<int> lastRow(classes.classCount, -1);
+        for (int y = 0; y < height; y++) {
+            lastRow[classes.rowClass[y]] = y;
+        }
+        neededUntilRow = lastRow;
+        if (classes.symmetry == EPatternSymmetry::SYMMETRIC) {
+            int laterLastRow = -1;
+            for (int c = classes.classCount - 1; c >= 0; c--) {
+                if (firstColumn[c] >= 0) {
+                    neededUntilRow[c] = std::max(neededUntilRow[c], laterLastRow);
+                }
+                laterLastRow = std::max(laterLastRow, lastRow[c]);
+            }
+        }
+        cachedRows.resize(classes.classCount);
+    }
+
+    // id 가 r 인 행의 값이 이미 있으면 그 행을 돌려준다(캐시 또는 이번 밴드에서 처음 나오는 행).
+    const unsigned char* FindClassRow(int r, const RenderTarget& target) const
+    {
+        if (!cachedRows.empty() && !cachedRows[r].empty()) {
+            return cachedRows[r].data();
+        }
+        return (bandFirstRow[r] >= 0) ? target.GetRow(bandFirstRow[r]) : nullptr;
+    }
+
+    bool RenderBandSymmetric(const RenderTile& band, const RenderTarget& target, RenderSampleStats& bandStats)
+    {
+        static constexpr auto SSAATable = make_render_row_pixels_table<EAAType::SSAA, Pattern>(std::make_index_sequence<MAX_AA_LEVEL>());
+        static constexpr auto MSAATable = make_render_row_pixels_table<EAAType::MSAA, Pattern>(std::make_index_sequence<MAX_AA_LEVEL>());
+
+        if (classes.classCount == 0) {
+            return false;
+        }
+        const int width = roi.max.x - roi.min.x;
+        const int bandRows = band.max.y - band.min.y;
+        const std::vector<int>& columnClass = classes.columnClass;
+        const int* rowClass = classes.rowClass.data() + (band.min.y - roi.min.y);
+
+        // 캐시에 없는 id 마다 밴드에서 처음 나오는 행(밴드 기준).
+        bandFirstRow.assign(classes.classCount, -1);
+        uniqueRows.clear();
+        for (int y = 0; y < bandRows; y++) {
+            const int r = rowClass[y];
+            if (bandFirstRow[r] < 0 && (cachedRows.empty() || cachedRows[r].empty())) {
+                bandFirstRow[r] = y;
+                uniqueRows.push_back(y);
+            }
+        }
+
+        // 열 id c, 행 id r 의 픽셀을 평가하는지. 맞바꾼 쌍의 값을 구할 수 있으면 c >= r 인 쪽만 평가한다.
+        const bool symmetric = classes.symmetry == EPatternSymmetry::SYMMETRIC;
+        auto evaluatesPair = [&](int c, int r) {
+            return !symmetric || c >= r || firstColumn[r] < 0 || FindClassRow(c, target) == nullptr;
+        };
+
+        int64_t evaluatedPixels = 0;
+        for (const int y : uniqueRows) {
+            for (const int x : uniqueColumns) {
+                evaluatedPixels += evaluatesPair(columnClass[x], rowClass[y]) ? 1 : 0;
+            }
+        }
+        const int64_t pixelCount = static_cast<int64_t>(width) * bandRows;
+        if (evaluatedPixels * 4 > pixelCount * 3) {
+            return false;
+        }
+
+        RenderRowPixelsFunc<Pattern> renderRowPixels = &render_pattern_row_pixels<EAAType::NONE, 1, Pattern>;
+        int sampleCount = 1;
+        if (AAType == EAAType::SSAA) {
+            renderRowPixels = SSAATable[level - 1];
+            sampleCount = level * level;
+        } else if (AAType == EAAType::MSAA) {
+            renderRowPixels = MSAATable[level - 1];
+            sampleCount = level;
+        }
+
+        GetThreadPool().ParallelFor(static_cast<int>(uniqueRows.size()), [&](int rowIndex) {
+            const int y = uniqueRows[rowIndex];
+            std::vector<int>& columns = get_sample_scratch().columns;
+            columns.clear();
+            for (const int x : uniqueColumns) {
+                if (evaluatesPair(columnClass[x], rowClass[y])) {
+                    columns.push_back(roi.min.x + x);
+                }
+            }
+            if (!columns.empty()) {
+                renderRowPixels(outputSize, band, pattern, target, band.min.y + y, columns);
+            }
+        });
+
+        // 처음 나오는 행의 나머지 픽셀은 평가한 픽셀에서, 그 밖의 행은 완성된 같은 id 의 행이나 캐시에서 복사한다.
+        const size_t bytesPerPixel = target.GetBytesPerPixel();
+        GetThreadPool().ParallelFor(static_cast<int>(uniqueRows.size()), [&](int rowIndex) {
+            const int y = uniqueRows[rowIndex];
+            const int r = rowClass[y];
+            unsigned char* row = target.GetRow(y);
+            for (int x = 0; x < width; x++) {
+                const int c = columnClass[x];
+                const unsigned char* source = row + firstColumn[c] * bytesPerPixel;
+                if (!evaluatesPair(c, r)) {
+                    source = FindClassRow(c, target) + firstColumn[r] * bytesPerPixel;
+                } else if (firstColumn[c] == x) {
+                    continue;
+                }
+                std::memcpy(row + x * bytesPerPixel, source, bytesPerPixel);
+            }
+        });
+        GetThreadPool().ParallelFor(bandRows, [&](int y) {
+            const int r = rowClass[y];
+            if (bandFirstRow[r] != y) {
+                std::memcpy(target.GetRow(y), FindClassRow(r, target), width * bytesPerPixel);
+            }
+        });
+
+        bandStats.pixelCount = pixelCount;
+        bandStats.sampleCount = evaluatedPixels * sampleCount;
+        return true;
+    }
+
+    // 뒤 밴드가 더 이상 쓰지 않는 행은 캐시에서 지우고, 뒤 밴드가 쓸 이번 밴드의 행은 cacheBytes 까지 복사해 둔다.
+    void CacheBandRows(const RenderTile& band, const RenderTarget& target)
+    {
+        if (cachedRows.empty()) {
+            return;
+        }
+        const int bandEnd = band.max.y - roi.min.y;
+        for (int r = 0; r < classes.classCount; r++) {
+            if (!cachedRows[r].empty() && neededUntilRow[r] < bandEnd) {
+                profile_release_buffer(static_cast<int64_t>(cachedRows[r].size()));
+                cachedBytes -= cachedRows[r].size();
+                std::vector<unsigned char>().swap(cachedRows[r]);
+            }
+        }
+        const size_t rowBytes = static_cast<size_t>(roi.max.x - roi.min.x) * target.GetBytesPerPixel();
+        for (int y = band.min.y; y < band.max.y; y++) {
+            const int r = classes.rowClass[y - roi.min.y];
+            if (!cachedRows[r].empty() || neededUntilRow[r] < bandEnd || cachedBytes + rowBytes > cacheBytes) {
+                continue;
+            }
+            const unsigned char* row = target.GetRow(y - band.min.y);
+            cachedRows[r].assign(row, row + rowBytes);
+            cachedBytes += rowBytes;
+            profile_track_buffer(static_cast<int64_t>(rowBytes));
+        }
+    }
+
+    vec2i outputSize;
+    EAAType AAType;
+    int level;
+    const Pattern& pattern;
+    RenderTile roi;
+    size_t cacheBytes;
+    size_t cachedBytes = 0;
+    bool classified = false;
+    PatternAxisClasses classes;
+    std::vector<int> firstColumn;
+    std::vector<int> uniqueColumns;
+    std::vector<int> neededUntilRow;
+    std::vector<std::vector<unsigned char>> cachedRows;
+    std::vector<int> bandFirstRow;
+    std::vector<int> uniqueRows;
+};
+
+// region 안의 픽셀만 계산해서 target 에 쓰며, 값은 전체 렌더의 같은 위치와 같다(PatternBandRenderer 참고).
+// stats 가 있으면 이번 렌더의 샘플 수를 더한다.
+template<typename Pattern>
+static void render_pattern_region(const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const RenderTile& region, const RenderTarget& target, RenderSampleStats* stats = nullptr)
+{
+    PatternBandRenderer<Pattern> renderer(outputSize, AAType, AALevel, pattern, region);
+    renderer.RenderBand(region.min.y, region.max.y, target, stats);
+}
+
+// region 크기의 float 버퍼에 렌더한다.
+template<typename Pattern>
+static void render_pattern_region(const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const RenderTile& region, vec3f* pixels, RenderSampleStats* stats = nullptr)
+{
+    render_pattern_region(outputSize, AAType, AALevel, pattern, region, make_float_target(pixels, region.max.x - region.min.x), stats);
+}
+
+// 전체 이미지 중 roi 만 렌더한 roi 크기의 float 이미지.
+template<typename Pattern>
+static std::vector<vec3f> render_pattern(const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const RenderTile& roi, RenderSampleStats* stats = nullptr)
+{
+    std::vector<vec3f> pixels(static_cast<size_t>(roi.max.x - roi.min.x) * (roi.max.y - roi.min.y));
+    render_pattern_region(outputSize, AAType, AALevel, pattern, roi, pixels.data(), stats);
+    return pixels;
+}
+
+template<typename Pattern>
+static std::vector<vec3f> render_pattern(const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, RenderSampleStats* stats = nullptr)
+{
+    return render_pattern(outputSize, AAType, AALevel, pattern, RenderTile{{0, 0}, outputSize}, stats);
+}
+
+// float 이미지를 거치지 않고 샘플 누적 결과를 encoder 형식(8/16비트)의 픽셀로 바로 만든다.
+// 프로파일링 중이면 반환한 버퍼는 살아 있는 버퍼로 잡히므로, 다 쓰고 나서 profile_release_buffer 로 알린다.
+// roi 를 주면 roi 크기의 이미지를 만든다.
+template<typename Pattern>
+static std::vector<unsigned char> render_pattern_encoded(const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const RenderTile& roi, const PixelEncoder& encoder, RenderSampleStats* stats = nullptr)
+{
+    const int width = roi.max.x - roi.min.x;
+    std::vector<unsigned char> data(static_cast<size_t>(width) * (roi.max.y - roi.min.y) * encoder.GetBytesPerPixel());
+    profile_track_buffer(static_cast<int64_t>(data.size()));
+    render_pattern_region(outputSize, AAType, AALevel, pattern, roi, make_encoded_target(data.data(), width, encoder), stats);
+    return data;
+}
+
+template<typename Pattern>
+static std::vector<unsigned char> render_pattern_encoded(const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const PixelEncoder& encoder, RenderSampleStats* stats = nullptr)
+{
+    return render_pattern_encoded(outputSize, AAType, AALevel, pattern, RenderTile{{0, 0}, outputSize}, encoder, stats);
+}
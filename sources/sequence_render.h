@@ -0,0 +1,237 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "pattern.h"
+#include "profiler.h"
+#include "quantize.h"
+#include "stream_render.h"
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// 여러 프레임을 파라미터를 보간하며 렌더해 하나의 스트림(파일 또는 표준 출력)으로 내보내는 애니메이션 모드.
+// 프레임 k 를 작성 스레드가 변환해 쓰는 동안 프레임 k+1 을 렌더하므로, 처리량은 렌더 속도로 정해진다.
+
+enum class ESequenceFormat {
+    PPM,    // P6 파일을 이어 붙인 스트림(ffmpeg -f image2pipe)
+    RAW,    // 헤더 없는 RGB 프레임(rgb24, 16비트면 rgb48be)
+    Y4M     // YUV4MPEG2, 4:4:4 8비트 BT.601
+};
+
+// 첫 프레임 값 start 에서 마지막 프레임 값 end 까지 선형으로 움직이는 파라미터.
+struct ParamRange
+{
+    float start = 0.0f;
+    float end = 0.0f;
+
+    float At(float t) const { return start + (end - start) * t; }
+};
+
+// "A" 또는 "A:B" 를 읽는다. 값 하나면 모든 프레임에서 같다.
+static ParamRange parse_param_range(const std::string& text)
+{
+    const size_t colon = text.find(':');
+    ParamRange range;
+    range.start = static_cast<float>(std::atof(text.substr(0, colon).c_str()));
+    range.end = (colon == std::string::npos) ? range.start : static_cast<float>(std::atof(text.substr(colon + 1).c_str()));
+    return range;
+}
+
+struct SequenceSettings
+{
+    int frameCount = 1;
+    int framesPerSecond = 30;
+    ESequenceFormat format = ESequenceFormat::PPM;
+    ParamRange checkerboardAngle = {40.0f, 40.0f};
+    float checkerboardTileSize = 50.0f;
+    ParamRange circleThickness = {12.0f, 12.0f};
+    ParamRange circleGap = {7.0f, 7.0f};
+    int voronoiSiteCount = 100;
+    EVoronoiLookup voronoiLookup = EVoronoiLookup::GRID;
+    float voronoiDrift = 0.0f;  // 사이트가 프레임마다 움직이는 거리(출력 픽셀)
+};
+
+// 8비트 RGB 행을 BT.601 제한 범위 YCbCr 4:4:4 평면에 쓴다.
+static void rgb8_to_yuv444(const unsigned char* rgb, size_t pixelCount, unsigned char* y, unsigned char* u, unsigned char* v)
+{
+    for (size_t i = 0; i < pixelCount; ++i) {
+        const int r = rgb[i * 3 + 0];
+        const int g = rgb[i * 3 + 1];
+        const int b = rgb[i * 3 + 2];
+        y[i] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        u[i] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[i] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+// 프레임 하나를 받아 형식에 맞게 file 에 쓴다. 작성 스레드에서만 불린다.
+class SequenceFrameSink
+{
+public:
+    SequenceFrameSink(FILE* file, ESequenceFormat format, const vec2i& outputSize, const PixelEncoder& encoder)
+        : file(file)
+        , format(format)
+        , outputSize(outputSize)
+        , maxValue(encoder.GetMaxValue())
+        , frameBytes(static_cast<size_t>(outputSize.x) * outputSize.y * encoder.GetBytesPerPixel())
+    {
+        if (format == ESequenceFormat::Y4M) {
+            planes.resize(static_cast<size_t>(outputSize.x) * outputSize.y * 3);
+        }
+    }
+
+    bool WriteStreamHeader(int framesPerSecond)
+    {
+        if (format != ESequenceFormat::Y4M) {
+            return true;
+        }
+        return Print("YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", outputSize.x, outputSize.y, framesPerSecond);
+    }
+
+    bool WriteFrame(const unsigned char* data)
+    {
+        switch (format) {
+            case ESequenceFormat::PPM:
+                return Print("P6\n%d %d\n%d\n", outputSize.x, outputSize.y, maxValue) && Write(data, frameBytes);
+            case ESequenceFormat::RAW:
+                return Write(data, frameBytes);
+            case ESequenceFormat::Y4M: {
+                const size_t pixelCount = static_cast<size_t>(outputSize.x) * outputSize.y;
+                rgb8_to_yuv444(data, pixelCount, planes.data(), planes.data() + pixelCount, planes.data() + pixelCount * 2);
+                return Print("FRAME\n") && Write(planes.data(), planes.size());
+            }
+        }
+        return false;
+    }
+
+private:
+    template<typename... Args>
+    bool Print(const char* text, Args... args)
+    {
+        const int written = std::fprintf(file, text, args...);
+        profile_add_counter(EProfileCounter::BYTES_WRITTEN, std::max(written, 0));
+        return written >= 0;
+    }
+
+    bool Write(const unsigned char* data, size_t size)
+    {
+        ProfileStage profileStage("write");
+        const size_t written = std::fwrite(data, 1, size, file);
+        profile_add_counter(EProfileCounter::BYTES_WRITTEN, static_cast<int64_t>(written));
+        return written == size;
+    }
+
+    FILE* file;
+    ESequenceFormat format;
+    vec2i outputSize;
+    int maxValue;
+    size_t frameBytes;
+    std::vector<unsigned char> planes;
+};
+
+// 프레임 frameIndex 의 패턴을 만들어 target 에 렌더한다.
+// voronoiSites/voronoiVelocities 는 패턴 해상도 기준 첫 프레임 위치와 프레임당 이동량.
+static void render_sequence_frame(const SequenceSettings& settings, int frameIndex, const vec2i& outputSize, const EAAType AAType, const int AALevel, const EPatternType patternType,
+    const std::vector<vec2f>& voronoiSites, const std::vector<vec2f>& voronoiVelocities, const RenderTarget& target, RenderSampleStats* stats)
+{
+    const float t = (settings.frameCount > 1) ? static_cast<float>(frameIndex) / (settings.frameCount - 1) : 0.0f;
+
+    auto render = [&](const auto& pattern) {
+        if (AAType == EAAType::FXAA) {
+            render_pattern_fxaa_to_target(outputSize, pattern, target, stats);
+        } else {
+            render_pattern_region(outputSize, AAType, AALevel, pattern, RenderTile{{0, 0}, outputSize}, target, stats);
+        }
+    };
+
+    switch (patternType) {
+        case EPatternType::UV:
+            render(UVPattern(outputSize));
+            break;
+        case EPatternType::CHECKERBOARD:
+            render(CheckerboardPattern(outputSize, AAType, AALevel, settings.checkerboardAngle.At(t), {0.5f, 0.5f}, settings.checkerboardTileSize));
+            break;
+        case EPatternType::CIRCLE:
+            render(CirclePattern(outputSize, AAType, AALevel, settings.circleThickness.At(t), settings.circleGap.At(t)));
+            break;
+        case EPatternType::VORONOI: {
+            // 사이트는 패턴 영역 안에서 감싸 돌며 움직인다.
+            const vec2i patternSize = get_voronoi_pattern_size(outputSize, AAType, AALevel);
+            std::vector<vec2f> sites(voronoiSites.size());
+            for (size_t i = 0; i < sites.size(); ++i) {
+                const vec2f moved = voronoiSites[i] + voronoiVelocities[i] * static_cast<float>(frameIndex);
+                sites[i].x = moved.x - std::floor(moved.x / patternSize.x) * patternSize.x;
+                sites[i].y = moved.y - std::floor(moved.y / patternSize.y) * patternSize.y;
+            }
+            const VoronoiPattern pattern(outputSize, AAType, AALevel, std::move(sites), settings.voronoiLookup);
+            render(pattern);
+            break;
+        }
+    }
+}
+
+// settings.frameCount 개의 프레임을 filename 에 스트림으로 쓴다. filename 이 "-" 면 표준 출력.
+// 프레임 버퍼 두 개를 번갈아 쓰며, 작성 스레드가 앞 프레임을 변환하고 쓰는 동안 다음 프레임을 렌더한다.
+// Y4M 은 8비트만 지원하므로 encoder 는 RGB8 이어야 한다.
+static bool render_sequence(const char* filename, const SequenceSettings& settings, const vec2i& outputSize, const EAAType AAType, const int AALevel, const EPatternType patternType,
+    const PixelEncoder& encoder, RenderSampleStats* stats = nullptr)
+{
+    if (settings.frameCount <= 0 || outputSize.x <= 0 || outputSize.y <= 0) {
+        return false;
+    }
+    if (settings.format == ESequenceFormat::Y4M && encoder.GetFormat() != EPixelFormat::RGB8) {
+        return false;
+    }
+
+    const bool toStdout = std::string(filename) == "-";
+    FILE* file = nullptr;
+    if (toStdout) {
+#if defined(_WIN32)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        file = stdout;
+    } else if ((file = open_file_stream(filename, "wb")) == nullptr) {
+        return false;
+    }
+
+    // 첫 프레임 사이트는 한 장짜리 렌더와 같고, 속도는 그 뒤에 뽑는다.
+    std::vector<vec2f> voronoiSites;
+    std::vector<vec2f> voronoiVelocities;
+    if (patternType == EPatternType::VORONOI) {
+        const vec2i patternSize = get_voronoi_pattern_size(outputSize, AAType, AALevel);
+        const float speed = settings.voronoiDrift * (static_cast<float>(patternSize.x) / outputSize.x);
+        VoronoiSiteRandom siteRandom;
+        voronoiSites = generate_voronoi_sites(patternSize, settings.voronoiSiteCount, siteRandom);
+        for (size_t i = 0; i < voronoiSites.size(); ++i) {
+            const float angle = DegreeToRadian(static_cast<float>(siteRandom.Next() % 360));
+            voronoiVelocities.push_back({std::cos(angle) * speed, std::sin(angle) * speed});
+        }
+    }
+
+    SequenceFrameSink frameSink(file, settings.format, outputSize, encoder);
+    bool written = frameSink.WriteStreamHeader(settings.framesPerSecond);
+    {
+        const size_t frameBytes = static_cast<size_t>(outputSize.x) * outputSize.y * encoder.GetBytesPerPixel();
+        StreamBandWriter frameWriter([&frameSink](const unsigned char* data, int) { return frameSink.WriteFrame(data); }, frameBytes);
+        for (int frameIndex = 0; frameIndex < settings.frameCount && written; ++frameIndex) {
+            unsigned char* data = frameWriter.AcquireBuffer();
+            render_sequence_frame(settings, frameIndex, outputSize, AAType, AALevel, patternType, voronoiSites, voronoiVelocities,
+                make_encoded_target(data, outputSize.x, encoder), stats);
+            frameWriter.SubmitBuffer(outputSize.y);
+        }
+        written = frameWriter.Finish() && written;
+    }
+
+    if (toStdout) {
+        return (std::fflush(stdout) == 0) && written;
+    }
+    const bool closed = std::fclose(file) == 0;
+    return closed && written;
+}
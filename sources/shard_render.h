@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "math.h"
+#include "ppm.h"
+#include "profiler.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/wait.h>
+#include <unistd.h>
+#define RENDER_SHARDS_SUPPORTED 1
+#else
+#define RENDER_SHARDS_SUPPORTED 0
+#endif
+
+// 큰 렌더를 가로 밴드로 나눠 여러 프로세스가 나눠 그리고, 끝나면 밴드 파일을 한 PPM 으로 잇는다.
+// 밴드는 render_pattern_region 처럼 전체 이미지 좌표로 렌더하므로 이음매 없이 전체 렌더와 같은 결과가 된다.
+// Voronoi 사이트는 모든 프로세스에서 같은 시드로 전체 크기 기준으로 뽑으므로 같은 사이트 집합을 쓴다.
+// 자식의 샘플 통계와 프로파일 카운터는 파이프로 부모에게 보내 부모가 전체 렌더의 값을 보고한다.
+
+// roi 를 shardCount 개의 가로 밴드로 나눈다. 행 수는 최대 1 차이.
+static std::vector<RenderTile> split_render_bands(const RenderTile& roi, int shardCount)
+{
+    const int rows = roi.max.y - roi.min.y;
+    shardCount = clamp(shardCount, 1, std::max(rows, 1));
+    std::vector<RenderTile> bands;
+    for (int i = 0; i < shardCount; ++i) {
+        const int minY = roi.min.y + static_cast<int>(static_cast<int64_t>(rows) * i / shardCount);
+        const int maxY = roi.min.y + static_cast<int>(static_cast<int64_t>(rows) * (i + 1) / shardCount);
+        bands.push_back({{roi.min.x, minY}, {roi.max.x, maxY}});
+    }
+    return bands;
+}
+
+// 폭과 최댓값이 같은 P6 밴드 파일들을 위에서부터 순서대로 이어 outputFile 하나로 만든다.
+static bool merge_ppm_bands(const std::string& outputFile, const std::vector<std::string>& bandFiles)
+{
+    std::vector<FILE*> inputs;
+    auto closeInputs = [&]() {
+        for (FILE* input : inputs) {
+            std::fclose(input);
+        }
+    };
+
+    int width = 0;
+    int totalHeight = 0;
+    int maxValue = 0;
+    for (const std::string& bandFile : bandFiles) {
+        FILE* input = open_file_stream(bandFile.c_str(), "rb");
+        if (input == nullptr) {
+            closeInputs();
+            return false;
+        }
+        inputs.push_back(input);
+        int bandWidth = 0;
+        int bandHeight = 0;
+        int bandMaxValue = 0;
+        if (!read_ppm_header(input, bandWidth, bandHeight, bandMaxValue) || (width != 0 && (bandWidth != width || bandMaxValue != maxValue))) {
+            closeInputs();
+            return false;
+        }
+        width = bandWidth;
+        maxValue = bandMaxValue;
+        totalHeight += bandHeight;
+    }
+
+    FILE* output = inputs.empty() ? nullptr : open_file_stream(outputFile.c_str(), "wb");
+    if (output == nullptr) {
+        closeInputs();
+        return false;
+    }
+
+    bool ok = std::fprintf(output, "P6\n%d %d\n%d\n", width, totalHeight, maxValue) >= 0;
+    std::vector<char> buffer(1 << 20);
+    for (FILE* input : inputs) {
+        size_t count = 0;
+        while (ok && (count = std::fread(buffer.data(), 1, buffer.size(), input)) > 0) {
+            ok = std::fwrite(buffer.data(), 1, count, output) == count;
+        }
+        ok = ok && !std::ferror(input);
+    }
+    closeInputs();
+    const bool closed = std::fclose(output) == 0;
+    return ok && closed;
+}
+
+enum class EShardRole {
+    CHILD,      // 이 프로세스는 받은 밴드를 렌더해야 한다
+    MERGED,     // 부모: 모든 밴드를 렌더하고 outputFile 로 합쳤다
+    FAILED      // 부모: 자식이 실패했거나 합치지 못했다
+};
+
+// 밴드 하나를 맡은 자식 프로세스가 렌더할 영역과 결과 파일.
+struct RenderShard
+{
+    RenderTile roi;
+    std::string partFile;
+    int reportFd = -1;  // 부모에게 ShardReport 를 보낼 파이프. 없으면 -1
+};
+
+// 자식이 렌더를 마치고 부모에게 보내는 통계. 부모는 모든 자식의 값을 더한다.
+struct ShardReport
+{
+    RenderSampleStats samples;
+    int64_t counters[PROFILE_COUNTER_COUNT] = {};
+
+    ShardReport& operator+=(const ShardReport& other)
+    {
+        samples += other.samples;
+        for (int i = 0; i < PROFILE_COUNTER_COUNT; ++i) {
+            counters[i] += other.counters[i];
+        }
+        return *this;
+    }
+};
+
+// 자식에서 렌더가 끝난 뒤 부른다. 보고서는 PIPE_BUF 보다 작으므로 부모가 읽기 전에도 막히지 않는다.
+static void send_shard_report(RenderShard& shard, const ShardReport& report)
+{
+#if RENDER_SHARDS_SUPPORTED
+    if (shard.reportFd < 0) {
+        return;
+    }
+    const char* bytes = reinterpret_cast<const char*>(&report);
+    size_t remaining = sizeof(report);
+    while (remaining > 0) {
+        const ssize_t count = write(shard.reportFd, bytes, remaining);
+        if (count <= 0) {
+            break;
+        }
+        bytes += count;
+        remaining -= static_cast<size_t>(count);
+    }
+    close(shard.reportFd);
+    shard.reportFd = -1;
+#else
+    (void)shard;
+    (void)report;
+#endif
+}
+
+#if RENDER_SHARDS_SUPPORTED
+// 자식 하나의 보고서를 읽는다. 자식이 보내지 못했으면 false.
+static bool receive_shard_report(int fd, ShardReport& report)
+{
+    char* bytes = reinterpret_cast<char*>(&report);
+    size_t remaining = sizeof(report);
+    while (remaining > 0) {
+        const ssize_t count = read(fd, bytes, remaining);
+        if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        remaining -= static_cast<size_t>(count);
+    }
+    return true;
+}
+#endif
+
+// roi 를 shardCount 개 밴드로 나눠 밴드마다 자식 프로세스를 fork 한다.
+// 자식에서는 shard 를 채우고 CHILD 를 돌려준다. 자식은 shard.roi 를 shard.partFile 에 렌더하고 성공하면 0 으로 끝나야 한다.
+// 자식은 끝내기 전에 send_shard_report 로 통계를 보내야 한다.
+// 부모는 자식을 모두 기다렸다가 밴드 파일을 outputFile 로 합치고 지우며, 자식들의 보고서 합을 total 에 넣는다.
+// fork 는 호출한 스레드만 복제하므로 스레드 풀을 만들기 전에 불러야 한다.
+static EShardRole fork_render_shards(const RenderTile& roi, int shardCount, const std::string& outputFile, RenderShard& shard, ShardReport& total)
+{
+#if RENDER_SHARDS_SUPPORTED
+    const std::vector<RenderTile> bands = split_render_bands(roi, shardCount);
+    std::vector<std::string> partFiles;
+    std::vector<pid_t> children;
+    std::vector<int> reportFds;
+    bool ok = true;
+    std::fflush(nullptr);
+    for (size_t i = 0; i < bands.size(); ++i) {
+        partFiles.push_back(outputFile + ".part" + std::to_string(i));
+        int fds[2];
+        if (pipe(fds) != 0) {
+            ok = false;
+            break;
+        }
+        const pid_t pid = fork();
+        if (pid == 0) {
+            for (const int fd : reportFds) {
+                close(fd);
+            }
+            close(fds[0]);
+            shard.roi = bands[i];
+            shard.partFile = partFiles.back();
+            shard.reportFd = fds[1];
+            return EShardRole::CHILD;
+        }
+        close(fds[1]);
+        if (pid < 0) {
+            close(fds[0]);
+            ok = false;
+            break;
+        }
+        children.push_back(pid);
+        reportFds.push_back(fds[0]);
+    }
+
+    total = {};
+    for (size_t i = 0; i < children.size(); ++i) {
+        int status = 0;
+        if (waitpid(children[i], &status, 0) != children[i] || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ok = false;
+        }
+        ShardReport report;
+        if (receive_shard_report(reportFds[i], report)) {
+            total += report;
+        }
+        close(reportFds[i]);
+    }
+
+    ok = ok && merge_ppm_bands(outputFile, partFiles);
+    for (const std::string& partFile : partFiles) {
+        std::remove(partFile.c_str());
+    }
+    return ok ? EShardRole::MERGED : EShardRole::FAILED;
+#else
+    // 프로세스를 나눌 수 없으면 이 프로세스가 전체를 렌더한다.
+    (void)shardCount;
+    total = {};
+    shard.roi = roi;
+    shard.partFile = outputFile;
+    return EShardRole::CHILD;
+#endif
+}
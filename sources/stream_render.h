@@ -0,0 +1,182 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pattern.h"
+#include "ppm.h"
+#include "profiler.h"
+#include "quantize.h"
+
+constexpr int DEFAULT_STREAM_BAND_ROWS = 128;
+
+// 양자화된 밴드를 받아 별도 스레드에서 파일로 쓰는 작성 단계.
+// 바이트 버퍼 두 개를 번갈아 쓰므로, 한 밴드를 쓰는 동안 다음 밴드를 렌더할 수 있다.
+// 밴드는 sink(data, rowCount) 로 넘기며, sink 가 false 를 돌려주면 이후 밴드는 버린다.
+class StreamBandWriter
+{
+public:
+    using Sink = std::function<bool(const unsigned char* data, int rowCount)>;
+
+    StreamBandWriter(PPMWriter& writer, size_t bandBytes)
+        : StreamBandWriter([&writer](const unsigned char* data, int rowCount) { return writer.WriteRows(data, rowCount); }, bandBytes)
+    {
+    }
+
+    StreamBandWriter(Sink sink, size_t bandBytes)
+        : sink(std::move(sink))
+    {
+        for (std::vector<unsigned char>& buffer : buffers) {
+            buffer.resize(bandBytes);
+            profile_track_buffer(static_cast<int64_t>(bandBytes));
+        }
+        thread = std::thread([this]() { WriterMain(); });
+    }
+
+    ~StreamBandWriter()
+    {
+        Finish();
+        for (const std::vector<unsigned char>& buffer : buffers) {
+            profile_release_buffer(static_cast<int64_t>(buffer.size()));
+        }
+    }
+
+    // 다음에 채울 버퍼. 작성 스레드가 아직 쓰고 있으면 끝날 때까지 기다린다.
+    unsigned char* AcquireBuffer()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&]() { return busy[nextBuffer] == false; });
+        return buffers[nextBuffer].data();
+    }
+
+    // AcquireBuffer 로 받은 버퍼의 rowCount 행을 작성 대기열에 넣는다.
+    void SubmitBuffer(int rowCount)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy[nextBuffer] = true;
+            pending.push_back({nextBuffer, rowCount});
+            nextBuffer = (nextBuffer + 1) % BUFFER_COUNT;
+        }
+        condition.notify_all();
+    }
+
+    // 남은 밴드를 모두 쓰고 작성 스레드를 끝낸다. 쓰기 오류가 없었으면 true.
+    bool Finish()
+    {
+        if (thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finishing = true;
+            }
+            condition.notify_all();
+            thread.join();
+        }
+        return ok;
+    }
+
+private:
+    static constexpr int BUFFER_COUNT = 2;
+
+    struct PendingBand
+    {
+        int buffer;
+        int rowCount;
+    };
+
+    void WriterMain()
+    {
+        for (;;) {
+            PendingBand band;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]() { return finishing || !pending.empty(); });
+                if (pending.empty()) {
+                    return;
+                }
+                band = pending.front();
+                pending.pop_front();
+            }
+
+            if (ok) {
+                ok = sink(buffers[band.buffer].data(), band.rowCount);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy[band.buffer] = false;
+            }
+            condition.notify_all();
+        }
+    }
+
+    Sink sink;
+    std::vector<unsigned char> buffers[BUFFER_COUNT];
+    bool busy[BUFFER_COUNT] = {};
+    int nextBuffer = 0;
+    std::deque<PendingBand> pending;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+    bool finishing = false;
+    bool ok = true;
+};
+
+// 이미지를 bandRows 행짜리 가로 밴드로 나눠 렌더 → (FXAA) → 양자화 → 파일 쓰기를 밴드마다 진행한다.
+// 메모리는 이미지 크기가 아니라 밴드 크기에 비례하고, 파일 쓰기는 다음 밴드 렌더와 겹쳐 돈다.
+// 샘플 누적 결과(FXAA 면 FXAA 결과)를 작성 버퍼에 바로 인코딩한다.
+// FXAA 는 FXAABandRenderer 가 밴드 위아래 FXAA_HALO_ROWS 행을 겹쳐 들고 있다.
+// 모든 행은 한 번씩만 렌더되며 결과 파일은 전체 렌더 후 ExportPPM 한 것과 같다.
+// 대칭 패턴은 PatternBandRenderer 가 roi 전체의 열/행 분류를 모든 밴드에 같이 쓰고, 뒤 밴드에서 다시 나오는 행은
+// DEFAULT_BAND_ROW_CACHE_BYTES 까지 복사해 두므로 한 번에 렌더할 때만큼 픽셀 평가를 줄인다.
+// roi 를 주면 전체 이미지 중 roi 영역만 roi 크기의 파일로 쓴다.
+template<typename Pattern>
+static bool render_pattern_to_ppm(const char* filename, EPPMFormat format, const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const RenderTile& roi, const PixelEncoder& encoder, int bandRows = DEFAULT_STREAM_BAND_ROWS, RenderSampleStats* stats = nullptr)
+{
+    const vec2i roiSize = roi.max - roi.min;
+    PPMWriter writer;
+    if (!writer.Open(filename, format, roiSize.x, roiSize.y, encoder.GetMaxValue())) {
+        return false;
+    }
+
+    bandRows = clamp(bandRows, 1, roiSize.y);
+    const bool useFXAA = (AAType == EAAType::FXAA);
+    const size_t rowPixels = static_cast<size_t>(roiSize.x);
+
+    std::unique_ptr<FXAABandRenderer<Pattern>> fxaaBands;
+    std::unique_ptr<PatternBandRenderer<Pattern>> patternBands;
+    if (useFXAA) {
+        fxaaBands = std::make_unique<FXAABandRenderer<Pattern>>(outputSize, pattern, bandRows, stats, roi.min.x, roi.max.x, DEFAULT_BAND_ROW_CACHE_BYTES);
+    } else {
+        patternBands = std::make_unique<PatternBandRenderer<Pattern>>(outputSize, AAType, AALevel, pattern, roi, DEFAULT_BAND_ROW_CACHE_BYTES);
+    }
+
+    StreamBandWriter bandWriter(writer, bandRows * rowPixels * encoder.GetBytesPerPixel());
+
+    for (int bandMinY = roi.min.y; bandMinY < roi.max.y; bandMinY += bandRows) {
+        const int bandMaxY = std::min(bandMinY + bandRows, roi.max.y);
+
+        unsigned char* data = bandWriter.AcquireBuffer();
+        const RenderTarget target = make_encoded_target(data, roiSize.x, encoder);
+        if (useFXAA) {
+            fxaaBands->RenderBand(bandMinY, bandMaxY, target);
+        } else {
+            patternBands->RenderBand(bandMinY, bandMaxY, target, stats);
+        }
+        bandWriter.SubmitBuffer(bandMaxY - bandMinY);
+    }
+
+    const bool written = bandWriter.Finish();
+    return writer.Close() && written;
+}
+
+template<typename Pattern>
+static bool render_pattern_to_ppm(const char* filename, EPPMFormat format, const vec2i& outputSize, const EAAType AAType, const int AALevel, const Pattern& pattern, const PixelEncoder& encoder, int bandRows = DEFAULT_STREAM_BAND_ROWS, RenderSampleStats* stats = nullptr)
+{
+    return render_pattern_to_ppm(filename, format, outputSize, AAType, AALevel, pattern, RenderTile{{0, 0}, outputSize}, encoder, bandRows, stats);
+}
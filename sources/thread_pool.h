@@ -0,0 +1,297 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "math.h"
+#include "profiler.h"
+
+// 작업 훔치기(work-stealing) 스레드 풀.
+// ParallelFor 는 [0, taskCount) 를 워커 수만큼 연속 구간으로 나눠 나눠주고,
+// 자기 구간을 다 끝낸 워커는 다른 워커 구간의 뒤쪽에서 작업을 훔쳐 온다.
+// 각 작업은 서로 독립적으로 계산되므로 결과는 스레드 수와 무관하게 동일하다.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threadCount)
+    {
+        if (threadCount <= 0) {
+            threadCount = static_cast<int>(std::thread::hardware_concurrency());
+        }
+        threadCount = std::max(threadCount, 1);
+
+        queues = std::make_unique<WorkQueue[]>(threadCount);
+        queueCount = threadCount;
+
+        // 호출한 스레드가 0번 워커 역할을 하므로 threadCount - 1 개만 생성한다.
+        for (int i = 1; i < threadCount; ++i) {
+            workers.emplace_back([this, i]() { WorkerMain(i); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int GetThreadCount() const { return queueCount; }
+
+    // task(taskIndex) 를 모든 taskIndex 에 대해 한 번씩 실행하고, 전부 끝나면 반환한다.
+    // 작업이 예외를 던지면 남은 작업은 건너뛰고, 모든 워커가 손을 뗀 뒤 첫 예외를 호출한 스레드에서 다시 던진다.
+    void ParallelFor(int taskCount, const std::function<void(int)>& task)
+    {
+        if (taskCount <= 0) {
+            return;
+        }
+
+        // 워커 안에서 다시 호출되거나 스레드가 하나뿐이면 그냥 직렬로 돈다.
+        if (IsWorkerThread() || queueCount == 1 || taskCount == 1) {
+            for (int i = 0; i < taskCount; ++i) {
+                task(i);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> submitLock(submitMutex);
+
+        Job job;
+        job.task = &task;
+        job.pendingTasks.store(taskCount, std::memory_order_relaxed);
+
+        for (int i = 0; i < queueCount; ++i) {
+            const int begin = static_cast<int>(static_cast<int64_t>(taskCount) * i / queueCount);
+            const int end = static_cast<int>(static_cast<int64_t>(taskCount) * (i + 1) / queueCount);
+            queues[i].range.store(PackRange(begin, end), std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentJob = &job;
+            ++generation;
+        }
+        wakeCondition.notify_all();
+
+        IsWorkerThread() = true;
+        RunJob(job, 0);
+        IsWorkerThread() = false;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [&]() {
+            return job.pendingTasks.load(std::memory_order_acquire) == 0 && activeWorkers == 0;
+        });
+        currentJob = nullptr;
+        lock.unlock();
+        if (job.error) {
+            std::rethrow_exception(job.error);
+        }
+    }
+
+private:
+    struct alignas(64) WorkQueue
+    {
+        // 상위 32비트: begin, 하위 32비트: end. 주인은 앞에서, 도둑은 뒤에서 꺼낸다.
+        std::atomic<uint64_t> range{0};
+    };
+
+    struct Job
+    {
+        const std::function<void(int)>* task = nullptr;
+        std::atomic<int> pendingTasks{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;  // failed 를 처음 세운 작업만 쓴다
+    };
+
+    static uint64_t PackRange(int begin, int end)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(begin)) << 32) | static_cast<uint32_t>(end);
+    }
+
+    static bool& IsWorkerThread()
+    {
+        thread_local bool isWorker = false;
+        return isWorker;
+    }
+
+    bool PopFront(WorkQueue& queue, int& taskIndex)
+    {
+        uint64_t packed = queue.range.load(std::memory_order_acquire);
+        for (;;) {
+            const int begin = static_cast<int>(packed >> 32);
+            const int end = static_cast<int>(packed & 0xffffffffu);
+            if (begin >= end) {
+                return false;
+            }
+            if (queue.range.compare_exchange_weak(packed, PackRange(begin + 1, end), std::memory_order_acq_rel)) {
+                taskIndex = begin;
+                return true;
+            }
+        }
+    }
+
+    bool StealBack(WorkQueue& queue, int& taskIndex)
+    {
+        uint64_t packed = queue.range.load(std::memory_order_acquire);
+        for (;;) {
+            const int begin = static_cast<int>(packed >> 32);
+            const int end = static_cast<int>(packed & 0xffffffffu);
+            if (begin >= end) {
+                return false;
+            }
+            if (queue.range.compare_exchange_weak(packed, PackRange(begin, end - 1), std::memory_order_acq_rel)) {
+                taskIndex = end - 1;
+                return true;
+            }
+        }
+    }
+
+    void RunJob(Job& job, int workerIndex)
+    {
+        int taskIndex = 0;
+        for (;;) {
+            bool found = PopFront(queues[workerIndex], taskIndex);
+            for (int i = 1; !found && i < queueCount; ++i) {
+                found = StealBack(queues[(workerIndex + i) % queueCount], taskIndex);
+            }
+            if (!found) {
+                return;
+            }
+
+            if (!job.failed.load(std::memory_order_relaxed)) {
+                try {
+                    (*job.task)(taskIndex);
+                } catch (...) {
+                    if (!job.failed.exchange(true, std::memory_order_acq_rel)) {
+                        job.error = std::current_exception();
+                    }
+                }
+            }
+
+            if (job.pendingTasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                doneCondition.notify_all();
+            }
+        }
+    }
+
+    void WorkerMain(int workerIndex)
+    {
+        IsWorkerThread() = true;
+        uint64_t seenGeneration = 0;
+        for (;;) {
+            Job* job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeCondition.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+                job = currentJob;
+                if (job == nullptr) {
+                    continue;
+                }
+                ++activeWorkers;
+            }
+
+            RunJob(*job, workerIndex);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --activeWorkers;
+            }
+            doneCondition.notify_all();
+        }
+    }
+
+    std::unique_ptr<WorkQueue[]> queues;
+    int queueCount = 1;
+    std::vector<std::thread> workers;
+
+    std::mutex submitMutex;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+    Job* currentJob = nullptr;
+    uint64_t generation = 0;
+    int activeWorkers = 0;
+    bool stopping = false;
+};
+
+inline std::unique_ptr<ThreadPool>& GetThreadPoolInstance()
+{
+    static std::unique_ptr<ThreadPool> instance;
+    return instance;
+}
+
+// 0 이하이면 하드웨어 스레드 수를 사용한다.
+inline void SetThreadCount(int threadCount)
+{
+    GetThreadPoolInstance() = std::make_unique<ThreadPool>(threadCount);
+}
+
+inline ThreadPool& GetThreadPool()
+{
+    std::unique_ptr<ThreadPool>& instance = GetThreadPoolInstance();
+    if (!instance) {
+        instance = std::make_unique<ThreadPool>(0);
+    }
+    return *instance;
+}
+
+// 이미지를 나누는 직사각형 타일. [min, max) 범위.
+struct RenderTile
+{
+    vec2i min;
+    vec2i max;
+};
+
+constexpr int RENDER_TILE_SIZE = 64;
+
+// region 을 RENDER_TILE_SIZE 타일로 쪼개 스레드 풀에서 처리한다.
+static void parallel_for_tiles(const RenderTile& region, const std::function<void(const RenderTile&)>& func, int tileSize = RENDER_TILE_SIZE)
+{
+    const vec2i size = region.max - region.min;
+    if (size.x <= 0 || size.y <= 0) {
+        return;
+    }
+    const int tilesX = (size.x + tileSize - 1) / tileSize;
+    const int tilesY = (size.y + tileSize - 1) / tileSize;
+
+    // 프로파일링 중이면 타일마다 걸린 시간을 호출한 쪽의 단계 이름으로 기록한다.
+    const bool profiling = IsProfilingEnabled();
+    const char* stageName = profiling ? Profiler::CurrentStageName() : nullptr;
+
+    GetThreadPool().ParallelFor(tilesX * tilesY, [&](int tileIndex) {
+        const int tileX = tileIndex % tilesX;
+        const int tileY = tileIndex / tilesX;
+        RenderTile tile;
+        tile.min = {region.min.x + tileX * tileSize, region.min.y + tileY * tileSize};
+        tile.max = {std::min(tile.min.x + tileSize, region.max.x), std::min(tile.min.y + tileSize, region.max.y)};
+        if (!profiling) {
+            func(tile);
+            return;
+        }
+        Profiler& profiler = GetProfiler();
+        const int64_t startNs = profiler.Now();
+        func(tile);
+        profiler.Record({stageName, startNs, profiler.Now() - startNs, tile.min.x, tile.min.y});
+    });
+}
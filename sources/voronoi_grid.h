@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "math.h"
+#include "thread_pool.h"
+
+enum class EVoronoiLookup {
+    BRUTE_FORCE,
+    GRID
+};
+
+// 균일 격자 사이트 인덱스.
+// 사이트들의 바운딩 박스를 셀 하나당 평균 2개 정도가 들어가도록 나누고,
+// 질의 지점의 셀에서부터 링 단위로 넓혀가며 가장 가까운 사이트를 찾는다.
+// 거리 계산과 동거리 처리(더 작은 인덱스 우선)는 전수 탐색과 완전히 같다.
+struct VoronoiSiteGrid
+{
+    const std::vector<vec2f>* sites = nullptr;
+    double originX = 0.0;
+    double originY = 0.0;
+    double cellSize = 1.0;
+    vec2i cellCount = {1, 1};
+    std::vector<int> cellStart;    // 셀 c 의 사이트는 siteIndices[cellStart[c] .. cellStart[c + 1])
+    std::vector<int> siteIndices;  // 셀 안에서는 사이트 인덱스 오름차순
+
+    void Build(const std::vector<vec2f>& points)
+    {
+        sites = &points;
+        cellStart.clear();
+        siteIndices.clear();
+        if (points.empty()) {
+            return;
+        }
+
+        float minX = points[0].x, maxX = points[0].x;
+        float minY = points[0].y, maxY = points[0].y;
+        for (const vec2f& point : points) {
+            minX = std::min(minX, point.x);
+            maxX = std::max(maxX, point.x);
+            minY = std::min(minY, point.y);
+            maxY = std::max(maxY, point.y);
+        }
+
+        const double extentX = std::max(static_cast<double>(maxX) - minX, 1.0);
+        const double extentY = std::max(static_cast<double>(maxY) - minY, 1.0);
+        const double targetCells = std::max(static_cast<double>(points.size()) / 2.0, 1.0);
+
+        originX = minX;
+        originY = minY;
+        cellSize = std::sqrt(extentX * extentY / targetCells);
+        cellCount.x = clamp(static_cast<int>(std::ceil(extentX / cellSize)), 1, 1 << 15);
+        cellCount.y = clamp(static_cast<int>(std::ceil(extentY / cellSize)), 1, 1 << 15);
+        cellSize = std::max(extentX / cellCount.x, extentY / cellCount.y);
+
+        // 카운팅 정렬: 사이트를 인덱스 순서대로 넣으므로 셀 안의 순서도 오름차순이 된다.
+        std::vector<int> siteCell(points.size());
+        cellStart.assign(static_cast<size_t>(cellCount.x) * cellCount.y + 1, 0);
+        for (size_t i = 0; i < points.size(); ++i) {
+            const int cx = CellX(points[i].x);
+            const int cy = CellY(points[i].y);
+            siteCell[i] = cy * cellCount.x + cx;
+            cellStart[siteCell[i] + 1]++;
+        }
+        for (size_t c = 1; c < cellStart.size(); ++c) {
+            cellStart[c] += cellStart[c - 1];
+        }
+        std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+        siteIndices.resize(points.size());
+        for (size_t i = 0; i < points.size(); ++i) {
+            siteIndices[cursor[siteCell[i]]++] = static_cast<int>(i);
+        }
+    }
+
+    int CellX(float x) const
+    {
+        return clamp(static_cast<int>(std::floor((x - originX) / cellSize)), 0, cellCount.x - 1);
+    }
+
+    int CellY(float y) const
+    {
+        return clamp(static_cast<int>(std::floor((y - originY) / cellSize)), 0, cellCount.y - 1);
+    }
+
+    // pos 에서 가장 가까운 사이트의 인덱스. 사이트가 없으면 -1.
+    int FindClosest(const vec2f& pos) const
+    {
+        if (siteIndices.empty()) {
+            return -1;
+        }
+
+        const std::vector<vec2f>& points = *sites;
+        const int cx = CellX(pos.x);
+        const int cy = CellY(pos.y);
+
+        int closest = -1;
+        float minDist = std::numeric_limits<float>::max();
+
+        auto visitCell = [&](int x, int y) {
+            const int cell = y * cellCount.x + x;
+            for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+                const int siteIndex = siteIndices[i];
+                const float dist = length(pos - points[siteIndex]);
+                if (dist < minDist || (dist == minDist && siteIndex < closest)) {
+                    minDist = dist;
+                    closest = siteIndex;
+                }
+            }
+        };
+
+        for (int ring = 0;; ++ring) {
+            const int x0 = cx - ring, x1 = cx + ring;
+            const int y0 = cy - ring, y1 = cy + ring;
+
+            for (int y = std::max(y0, 0); y <= std::min(y1, cellCount.y - 1); ++y) {
+                if (y == y0 || y == y1) {
+                    for (int x = std::max(x0, 0); x <= std::min(x1, cellCount.x - 1); ++x) {
+                        visitCell(x, y);
+                    }
+                } else {
+                    if (x0 >= 0) visitCell(x0, y);
+                    if (x1 < cellCount.x) visitCell(x1, y);
+                }
+            }
+
+            // 링 바깥에 남은 사이트까지의 최소 거리. 격자 경계에 닿은 방향은 더 볼 셀이 없다.
+            double bound = std::numeric_limits<double>::infinity();
+            if (x0 > 0) bound = std::min(bound, pos.x - (originX + x0 * cellSize));
+            if (x1 < cellCount.x - 1) bound = std::min(bound, originX + (x1 + 1) * cellSize - pos.x);
+            if (y0 > 0) bound = std::min(bound, pos.y - (originY + y0 * cellSize));
+            if (y1 < cellCount.y - 1) bound = std::min(bound, originY + (y1 + 1) * cellSize - pos.y);
+
+            if (bound == std::numeric_limits<double>::infinity()) {
+                break;
+            }
+            // float 거리의 반올림 오차보다 넉넉한 여유를 두고, 동거리 후보가 남을 수 있으면 계속 본다.
+            if (closest >= 0 && bound > static_cast<double>(minDist) * (1.0 + 1e-5) + 1e-5) {
+                break;
+            }
+        }
+        return closest;
+    }
+};